@@ -0,0 +1,489 @@
+// scriptcombiner-bench: times each stage of the engine on its own (scan,
+// ignore matching, filtering, sniffing, reading, normalizing, token counting,
+// rendering the tree, writing) and the whole export, on a generated project or
+// an existing one. Every stage runs several times and the fastest run counts,
+// so the numbers are stable enough to compare across commits.
+
+#include "SyntheticRepo.h"
+
+#include "CombinedExport.h"
+#include "ContentSniffer.h"
+#include "DirectoryScanner.h"
+#include "EntryRules.h"
+#include "ExportWriter.h"
+#include "FileTypeRegistry.h"
+#include "ProjectFilter.h"
+#include "ProjectPresets.h"
+#include "TextNormalizer.h"
+#include "TokenCounter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    const char* const kUsage =
+        "Usage: scriptcombiner-bench [options]\n"
+        "\n"
+        "Generates a synthetic project in a temporary folder, times every stage of the\n"
+        "export engine on it and prints items/s and MB/s per stage.\n"
+        "\n"
+        "Synthetic project:\n"
+        "      --depth N           folder levels (default 4)\n"
+        "      --fan-out N         subfolders per folder (default 4)\n"
+        "      --files N           files per folder (default 8)\n"
+        "      --file-size N       mean file size in bytes (default 4096)\n"
+        "      --binary-percent N  share of binary files (default 2)\n"
+        "      --crlf-percent N    share of text files with CRLF line endings (default 10)\n"
+        "      --duplicate-percent N  share of text files that copy another one (default 0)\n"
+        "      --node-modules N    packages in an ignored node_modules folder (default 0)\n"
+        "      --no-gitignore      no .gitignore and no ignored build/ folder\n"
+        "      --seed N            (default 1)\n"
+        "      --generate PATH     only write the project to PATH, and keep it\n"
+        "\n"
+        "Benchmark:\n"
+        "      --project PATH      measure an existing project instead of a generated one\n"
+        "      --repeat N          runs per stage; the fastest counts (default 5)\n"
+        "      --vocabulary PATH   cl100k_base.tiktoken, to also time exact token counts\n"
+        "      --csv               machine-readable output\n"
+        "  -h, --help              show this help\n";
+
+    struct Options
+    {
+        SyntheticRepo::Options repo;
+        std::string generatePath;
+        std::string projectPath;
+        unsigned repeat = 5;
+        std::string vocabularyPath;
+        bool csv = false;
+    };
+
+    struct StageResult
+    {
+        std::string stage;
+        uint64_t items;
+        uint64_t bytes; // 0 for stages that are not about volume
+        double seconds;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    // Runs setup (untimed) and body `repeat` times and returns the fastest body
+    template <typename Setup, typename Body>
+    double TimeBest(unsigned repeat, Setup setup, Body body)
+    {
+        double best = 0;
+        for (unsigned run = 0; run < repeat; ++run)
+        {
+            setup();
+            Clock::time_point start = Clock::now();
+            body();
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            if (run == 0 || seconds < best)
+                best = seconds;
+        }
+        return best;
+    }
+
+    template <typename Body>
+    double TimeBest(unsigned repeat, Body body)
+    {
+        return TimeBest(repeat, [] {}, body);
+    }
+
+    bool ParseNumber(const char* text, uint64_t& value)
+    {
+        if (!*text)
+            return false;
+        value = 0;
+        for (; *text; ++text)
+        {
+            if (*text < '0' || *text > '9')
+                return false;
+            value = value * 10 + (uint64_t)(*text - '0');
+        }
+        return true;
+    }
+
+    // Returns -1 when the options are complete, otherwise the exit code
+    int ParseArguments(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help")
+            {
+                std::fputs(kUsage, stdout);
+                return 0;
+            }
+            if (arg == "--csv")
+            {
+                options.csv = true;
+                continue;
+            }
+            if (arg == "--no-gitignore")
+            {
+                options.repo.gitignore = false;
+                continue;
+            }
+            if (i + 1 >= argc)
+            {
+                std::fprintf(stderr, "scriptcombiner-bench: unknown option or missing value: %s\n", arg.c_str());
+                return 2;
+            }
+
+            const char* value = argv[++i];
+            uint64_t number = 0;
+            bool numeric = ParseNumber(value, number);
+            if (arg == "--project")
+                options.projectPath = value;
+            else if (arg == "--generate")
+                options.generatePath = value;
+            else if (arg == "--vocabulary")
+                options.vocabularyPath = value;
+            else if (numeric && arg == "--depth")
+                options.repo.depth = (unsigned)number;
+            else if (numeric && arg == "--fan-out")
+                options.repo.fanOut = (unsigned)number;
+            else if (numeric && arg == "--files")
+                options.repo.filesPerDir = (unsigned)number;
+            else if (numeric && arg == "--file-size")
+                options.repo.meanFileSize = (size_t)number;
+            else if (numeric && arg == "--binary-percent")
+                options.repo.binaryPercent = (unsigned)number;
+            else if (numeric && arg == "--crlf-percent")
+                options.repo.crlfPercent = (unsigned)number;
+            else if (numeric && arg == "--duplicate-percent")
+                options.repo.duplicatePercent = (unsigned)number;
+            else if (numeric && arg == "--node-modules")
+                options.repo.nodeModules = (unsigned)number;
+            else if (numeric && arg == "--seed")
+                options.repo.seed = number;
+            else if (numeric && number > 0 && arg == "--repeat")
+                options.repeat = (unsigned)number;
+            else
+            {
+                std::fprintf(stderr, "scriptcombiner-bench: invalid option %s %s\n", arg.c_str(), value);
+                return 2;
+            }
+        }
+        return -1;
+    }
+
+    void PrintResults(const std::vector<StageResult>& results, bool csv)
+    {
+        if (csv)
+            std::printf("stage,items,bytes,seconds,items_per_second,mb_per_second\n");
+        else
+            std::printf("%-18s %10s %10s %10s %14s %10s\n", "stage", "items", "MB", "best ms", "items/s", "MB/s");
+
+        for (const StageResult& result : results)
+        {
+            double seconds = std::max(result.seconds, 1e-9);
+            double megabytes = result.bytes / 1e6;
+            if (csv)
+            {
+                std::printf("%s,%llu,%llu,%.6f,%.0f,%.1f\n", result.stage.c_str(), (unsigned long long)result.items,
+                            (unsigned long long)result.bytes, result.seconds, result.items / seconds, megabytes / seconds);
+                continue;
+            }
+            if (result.bytes > 0)
+                std::printf("%-18s %10llu %10.1f %10.2f %14.0f %10.1f\n", result.stage.c_str(), (unsigned long long)result.items,
+                            megabytes, result.seconds * 1000, result.items / seconds, megabytes / seconds);
+            else
+                std::printf("%-18s %10llu %10s %10.2f %14.0f %10s\n", result.stage.c_str(), (unsigned long long)result.items,
+                            "-", result.seconds * 1000, result.items / seconds, "-");
+        }
+    }
+
+    std::string ReadFile(const std::string& path)
+    {
+        std::ifstream file(std::filesystem::u8path(path), std::ios::binary);
+        std::string content;
+        char chunk[64 * 1024];
+        while (file.read(chunk, sizeof(chunk)) || file.gcount() > 0)
+            content.append(chunk, (size_t)file.gcount());
+        return content;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    int exitCode = ParseArguments(argc, argv, options);
+    if (exitCode >= 0)
+        return exitCode;
+
+    // --- Project ---
+    std::filesystem::path workDir;
+    std::string root = options.projectPath;
+    if (root.empty())
+    {
+        if (options.generatePath.empty())
+        {
+            workDir = std::filesystem::temp_directory_path() / ("scriptcombiner-bench-" + std::to_string(Clock::now().time_since_epoch().count()));
+            root = (workDir / "project").u8string();
+        }
+        else
+        {
+            root = options.generatePath;
+        }
+
+        SyntheticRepo::Stats stats;
+        Clock::time_point start = Clock::now();
+        if (!SyntheticRepo::Generate(root, options.repo, stats))
+        {
+            std::fprintf(stderr, "scriptcombiner-bench: cannot write the project to %s\n", root.c_str());
+            return 1;
+        }
+        std::fprintf(stderr, "Generated %zu files in %zu folders, %.1f MB, in %.0f ms: %s\n", stats.files, stats.directories,
+                     stats.bytes / 1e6, std::chrono::duration<double, std::milli>(Clock::now() - start).count(), root.c_str());
+        if (!options.generatePath.empty())
+            return 0;
+    }
+    else
+    {
+        workDir = std::filesystem::temp_directory_path() / ("scriptcombiner-bench-" + std::to_string(Clock::now().time_since_epoch().count()));
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(workDir, ec);
+    std::string outputPath = (workDir / "export.txt").u8string();
+
+    // --- Settings: the preset the app would pick ---
+    ProjectType type = ProjectPresets::Detect(root);
+    FileTypeRegistry fileTypes = FileTypeRegistry::CreateDefault();
+    std::vector<bool> enabledTypes(fileTypes.GetTypes().size(), false);
+    for (size_t i = 0; i < enabledTypes.size(); ++i)
+        enabledTypes[i] = fileTypes.GetTypes()[i].filter && fileTypes.IsInPreset(i, ProjectPresets::GetName(type));
+
+    EntryRules rules;
+    rules.SetIgnorePatterns(ProjectPresets::GetIgnorePatterns(type));
+    rules.SetEnabledExtensions(fileTypes.BuildExtensionTable(enabledTypes));
+
+    std::vector<StageResult> results;
+    const unsigned repeat = options.repeat;
+
+    // --- Scan: the directory walk, ignored folders recorded but not read ---
+    DirectoryScanner scanner;
+    scanner.SetDescendFilter(rules.GetDescendFilter());
+    ProjectModel model;
+    double seconds = TimeBest(repeat, [&] { model = scanner.Scan(root); });
+    results.push_back({ "scan", model.GetNodeCount(), 0, seconds });
+
+    // --- Ignore matching: typed patterns plus .gitignore scopes, for every entry ---
+    struct Entry
+    {
+        std::string relativePath;
+        uint32_t index;
+    };
+    std::vector<Entry> entries;
+    for (uint32_t i = 1; i < model.GetNodeCount(); ++i)
+        entries.push_back({ model.GetRelativePath(i), i });
+    size_t ignored = 0;
+    seconds = TimeBest(repeat, [&] { ignored = 0; }, [&] {
+        for (const Entry& entry : entries)
+        {
+            const ProjectNode& node = model.GetNode(entry.index);
+            const IgnoreScope* scope = model.GetNode(node.parent).ignoreScope.get();
+            ignored += rules.ShouldIgnore(entry.relativePath, node.name, node.isDir, scope);
+        }
+    });
+    results.push_back({ "ignore match", entries.size(), 0, seconds });
+
+    // --- Filter: visibility of the whole model, as after every settings change ---
+    ProjectFilter filter;
+    EntryFilter visibility = rules.GetVisibilityFilter();
+    filter.ApplyAndScan(model, scanner, visibility); // reads nothing new; sniffing is timed below
+    seconds = TimeBest(repeat, [&] { filter.Apply(model, visibility); });
+    results.push_back({ "filter", model.GetNodeCount(), 0, seconds });
+
+    std::vector<uint32_t> files;
+    uint64_t sniffBytes = 0;
+    for (uint32_t i = 0; i < model.GetNodeCount(); ++i)
+    {
+        if (model.GetNode(i).isDir || !filter.IsVisible(i))
+            continue;
+        files.push_back(i);
+        uint64_t size = std::filesystem::file_size(std::filesystem::u8path(model.GetFullPath(i)), ec);
+        sniffBytes += ec ? 0 : std::min<uint64_t>(size, ContentSniffer::kBlockSize);
+    }
+
+    // --- Sniff: first block of every visible file, in parallel ---
+    seconds = TimeBest(repeat, [&] {
+        for (uint32_t index : files)
+            model.SetContentKind(index, ContentKind::Unknown);
+    }, [&] { scanner.DetectContentKinds(model, files); });
+    results.push_back({ "sniff", files.size(), sniffBytes, seconds });
+
+    // --- Read: every visible text file, sequentially, into memory ---
+    std::vector<std::string> contents;
+    uint64_t textBytes = 0;
+    seconds = TimeBest(repeat, [&] { contents.clear(); textBytes = 0; }, [&] {
+        for (uint32_t index : files)
+        {
+            if (model.GetNode(index).content == ContentKind::Binary)
+                continue;
+            contents.push_back(ReadFile(model.GetFullPath(index)));
+            textBytes += contents.back().size();
+        }
+    });
+    results.push_back({ "read", contents.size(), textBytes, seconds });
+
+    // --- Normalize: UTF-8 validation and line endings, one thread ---
+    std::string normalized;
+    seconds = TimeBest(repeat, [&] {
+        for (const std::string& content : contents)
+        {
+            normalized.clear();
+            TextNormalizer normalizer;
+            normalizer.Feed(content.data(), content.size(), normalized);
+            normalizer.Finish(normalized);
+        }
+    });
+    results.push_back({ "normalize", contents.size(), textBytes, seconds });
+
+    // --- Tokens: one thread, so the number does not depend on the core count ---
+    TokenCounter tokenCounter;
+    size_t tokens = 0;
+    seconds = TimeBest(repeat, [&] { tokens = 0; }, [&] {
+        for (const std::string& content : contents)
+            tokens += tokenCounter.Count(content, TokenCounter::Mode::Approximate);
+    });
+    results.push_back({ "tokens (estimate)", contents.size(), textBytes, seconds });
+
+    if (!options.vocabularyPath.empty())
+    {
+        if (!tokenCounter.LoadVocabulary(options.vocabularyPath))
+        {
+            std::fprintf(stderr, "scriptcombiner-bench: cannot load vocabulary %s\n", options.vocabularyPath.c_str());
+            return 1;
+        }
+        seconds = TimeBest(repeat, [&] { tokens = 0; }, [&] {
+            for (const std::string& content : contents)
+                tokens += tokenCounter.Count(content, TokenCounter::Mode::Exact);
+        });
+        results.push_back({ "tokens (exact)", contents.size(), textBytes, seconds });
+    }
+
+    // --- Render: the project tree at the top of the export ---
+    std::string tree;
+    seconds = TimeBest(repeat, [&] { tree = CombinedExport::FormatTree(model, filter); });
+    results.push_back({ "render tree", filter.GetVisibleFileCount(), tree.size(), seconds });
+
+    // --- The same with a depth limit and big folders summarized: items are the lines written ---
+    CombinedExport::TreeOptions treeLimits;
+    treeLimits.maxDepth = 2;
+    treeLimits.collapseOver = 100;
+    seconds = TimeBest(repeat, [&] { tree = CombinedExport::FormatTree(model, filter, treeLimits); });
+    results.push_back({ "render tree (limits)", (uint64_t)std::count(tree.begin(), tree.end(), '\n'), tree.size(), seconds });
+
+    // --- Write: the buffered writer alone, contents already in memory ---
+    seconds = TimeBest(repeat, [&] {
+        ExportWriter writer;
+        writer.Open(outputPath);
+        for (const std::string& content : contents)
+            writer.Write(content);
+        writer.Commit();
+    });
+    results.push_back({ "write", contents.size(), textBytes, seconds });
+
+    // --- Export: everything after the scan, as Save Combined File runs it ---
+    size_t written = 0;
+    uint64_t exportBytes = 0;
+    seconds = TimeBest(repeat, [&] {
+        ExportWriter writer;
+        writer.Open(outputPath);
+        written = CombinedExport::Write(model, filter, writer).files;
+        exportBytes = writer.GetBytesWritten();
+        writer.Commit();
+    });
+    results.push_back({ "export", written, exportBytes, seconds });
+
+    // --- Export with duplicates replaced: the hashing should hide behind the reads ---
+    ExportPipeline::Options dedupOptions;
+    dedupOptions.deduplicate = true;
+    seconds = TimeBest(repeat, [&] {
+        ExportWriter writer;
+        writer.Open(outputPath);
+        written = CombinedExport::Write(model, filter, writer, dedupOptions).files;
+        exportBytes = writer.GetBytesWritten();
+        writer.Commit();
+    });
+    results.push_back({ "export (dedup)", written, exportBytes, seconds });
+
+    // --- Export with comments stripped: MB/s of text going out, which is less than for the plain export ---
+    ExportPipeline::Options stripOptions;
+    stripOptions.stripComments = true;
+    stripOptions.fileTypes = &fileTypes;
+    std::string savings;
+    seconds = TimeBest(repeat, [&] {
+        ExportWriter writer;
+        writer.Open(outputPath);
+        CombinedExport::Summary summary = CombinedExport::Write(model, filter, writer, stripOptions);
+        written = summary.files;
+        exportBytes = writer.GetBytesWritten();
+        writer.Commit();
+        savings = CombinedExport::FormatSavings(fileTypes, summary.savings);
+    });
+    results.push_back({ "export (strip)", written, exportBytes, seconds });
+
+    // --- Compressed export: MB/s of text going in, so it compares with the plain export ---
+    std::string ratios;
+    for (BlockCompressor::Format format : { BlockCompressor::Format::Gzip, BlockCompressor::Format::Zstd })
+    {
+        if (!BlockCompressor::IsAvailable(format))
+            continue;
+        uint64_t storedBytes = 0;
+        seconds = TimeBest(repeat, [&] {
+            ExportWriter writer;
+            writer.SetCompression(format);
+            writer.Open(outputPath + BlockCompressor::GetExtension(format));
+            written = CombinedExport::Write(model, filter, writer).files;
+            exportBytes = writer.GetBytesWritten();
+            writer.Commit();
+            storedBytes = writer.GetBytesStored();
+        });
+        std::string stage = std::string("export (") + BlockCompressor::GetName(format) + ")";
+        results.push_back({ stage, written, exportBytes, seconds });
+
+        char line[128];
+        std::snprintf(line, sizeof(line), "%s: %.1f MB -> %.1f MB (%.1f%%)\n", stage.c_str(), exportBytes / 1e6,
+                      storedBytes / 1e6, exportBytes > 0 ? 100.0 * storedBytes / exportBytes : 0.0);
+        ratios += line;
+    }
+
+    // --- Delta export with nothing changed: one stat per file against the manifest, no contents read ---
+    ExportManifest manifest;
+    {
+        ExportWriter writer;
+        writer.Open(outputPath);
+        CombinedExport::Write(model, filter, writer, ExportPipeline::Options(), &manifest);
+        writer.Commit();
+    }
+    size_t compared = 0;
+    seconds = TimeBest(repeat, [&] {
+        ExportManifest current;
+        ExportWriter writer;
+        writer.Open(outputPath);
+        compared = CombinedExport::WriteChanges(model, filter, writer, manifest, current).unchanged;
+        exportBytes = writer.GetBytesWritten();
+        writer.Commit();
+    });
+    results.push_back({ "export (delta)", compared, exportBytes, seconds });
+
+    PrintResults(results, options.csv);
+    std::fputs(ratios.c_str(), stderr);
+    std::fprintf(stderr, "export (strip):\n%s", savings.c_str());
+    std::fprintf(stderr, "%zu of %zu entries ignored, %zu visible files, %zu tokens (estimate)\n", ignored, entries.size(),
+                 files.size(), tokens);
+
+    // A generated project is only kept when it was asked for; the export always goes
+    std::filesystem::remove_all(workDir, ec);
+    return 0;
+}
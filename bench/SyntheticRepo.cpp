@@ -0,0 +1,222 @@
+#include "SyntheticRepo.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <system_error>
+
+namespace
+{
+    const char* const kWords[] = {
+        "value", "index", "count", "result", "buffer", "node", "parent", "child", "item", "state",
+        "update", "render", "load", "save", "scan", "filter", "path", "name", "size", "offset",
+        "player", "enemy", "health", "speed", "position", "velocity", "signal", "timer", "scene", "texture",
+    };
+    const unsigned kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+    const char* const kKeywords[] = { "if", "for", "while", "return", "const", "auto", "var", "func", "let", "def" };
+
+    struct SourceKind
+    {
+        const char* extension;
+        const char* comment;
+    };
+
+    const SourceKind kSourceKinds[] = {
+        { "cpp", "//" }, { "h", "//" }, { "py", "#" }, { "js", "//" }, { "ts", "//" },
+        { "gd", "#" }, { "cs", "//" }, { "json", "" }, { "md", "" },
+    };
+
+    class Generator
+    {
+    public:
+        Generator(const SyntheticRepo::Options& options, SyntheticRepo::Stats& stats)
+            : m_options(options), m_stats(stats), m_random(options.seed)
+        {
+        }
+
+        bool Run(const std::filesystem::path& root)
+        {
+            if (!MakeDirectory(root))
+                return false;
+
+            FillDirectory(root, 0);
+
+            if (m_options.gitignore)
+            {
+                WriteFile(root / ".gitignore", "build/\n*.tmp\ncoverage/\n");
+                std::filesystem::path build = root / "build";
+                MakeDirectory(build);
+                for (unsigned i = 0; i < m_options.filesPerDir * 4; ++i)
+                    WriteFile(build / ("out" + std::to_string(i) + ".o"), MakeBinary(m_options.meanFileSize));
+            }
+
+            if (m_options.nodeModules > 0)
+            {
+                std::filesystem::path modules = root / "node_modules";
+                MakeDirectory(modules);
+                for (unsigned i = 0; i < m_options.nodeModules; ++i)
+                    WritePackage(modules / ("package-" + std::to_string(i)), true);
+            }
+            return !m_failed;
+        }
+
+    private:
+        void FillDirectory(const std::filesystem::path& dir, unsigned level)
+        {
+            for (unsigned i = 0; i < m_options.filesPerDir; ++i)
+            {
+                if (Roll(m_options.binaryPercent))
+                {
+                    WriteFile(dir / ("image" + std::to_string(i) + ".png"), MakeBinary(PickSize()));
+                    continue;
+                }
+                if (m_options.duplicatePercent > 0 && !m_lastText.empty() && Roll(m_options.duplicatePercent))
+                {
+                    WriteFile(dir / ("copy_" + std::to_string(i) + "." + m_lastExtension), m_lastText);
+                    continue;
+                }
+                const SourceKind& kind = kSourceKinds[Pick(sizeof(kSourceKinds) / sizeof(kSourceKinds[0]))];
+                std::string name = std::string(kWords[Pick(kWordCount)]) + "_" + std::to_string(i) + "." + kind.extension;
+                std::string text = MakeText(kind, PickSize(), Roll(m_options.crlfPercent));
+                WriteFile(dir / name, text);
+                if (m_options.duplicatePercent > 0)
+                {
+                    m_lastText = std::move(text);
+                    m_lastExtension = kind.extension;
+                }
+            }
+
+            if (level >= m_options.depth)
+                return;
+            for (unsigned i = 0; i < m_options.fanOut; ++i)
+            {
+                std::filesystem::path child = dir / (std::string(kWords[Pick(kWordCount)]) + std::to_string(i));
+                if (MakeDirectory(child))
+                    FillDirectory(child, level + 1);
+            }
+        }
+
+        // Many small files in a few levels, like a real dependency
+        void WritePackage(const std::filesystem::path& dir, bool withDependency)
+        {
+            if (!MakeDirectory(dir))
+                return;
+            const SourceKind javascript = { "js", "//" };
+            WriteFile(dir / "package.json", "{\n  \"name\": \"" + dir.filename().string() + "\",\n  \"version\": \"1.0.0\"\n}\n");
+            WriteFile(dir / "index.js", MakeText(javascript, 1024, false));
+            std::filesystem::path lib = dir / "lib";
+            MakeDirectory(lib);
+            for (unsigned i = 0; i < 5; ++i)
+                WriteFile(lib / ("module" + std::to_string(i) + ".js"), MakeText(javascript, 1536, false));
+            if (withDependency && MakeDirectory(dir / "node_modules"))
+                WritePackage(dir / "node_modules" / "dependency", false);
+        }
+
+        std::string MakeText(const SourceKind& kind, size_t size, bool crlf)
+        {
+            const char* newline = crlf ? "\r\n" : "\n";
+            std::string text;
+            text.reserve(size + 128);
+            unsigned depth = 0;
+            while (text.size() < size)
+            {
+                unsigned roll = Pick(100);
+                text.append(depth * 4, ' ');
+                if (roll < 8 && kind.comment[0])
+                {
+                    // Some non-ASCII, so the normalizer leaves its fast path now and then
+                    text += kind.comment;
+                    text += roll < 2 ? " Gr\xC3\xB6\xC3\x9F" "e \xE2\x80\x93 na\xC3\xAFve" : " TODO: handle the empty case";
+                    text += newline;
+                    continue;
+                }
+                if (roll < 20 && depth < 4)
+                {
+                    text += kKeywords[Pick(10)];
+                    text += " (";
+                    text += kWords[Pick(kWordCount)];
+                    text += " < ";
+                    text += std::to_string(Pick(1000));
+                    text += ") {";
+                    text += newline;
+                    ++depth;
+                    continue;
+                }
+                if (roll < 30 && depth > 0)
+                {
+                    --depth;
+                    text.resize(text.size() - 4);
+                    text += "}";
+                    text += newline;
+                    continue;
+                }
+                text += kWords[Pick(kWordCount)];
+                text += " = ";
+                text += kWords[Pick(kWordCount)];
+                text += "(";
+                text += kWords[Pick(kWordCount)];
+                text += ", ";
+                text += std::to_string(Pick(100000));
+                text += ");";
+                text += newline;
+            }
+            return text;
+        }
+
+        std::string MakeBinary(size_t size)
+        {
+            std::string data = "\x89PNG\r\n\x1a\n";
+            data.reserve(size);
+            while (data.size() < size)
+                data += (char)Pick(256);
+            return data;
+        }
+
+        size_t PickSize()
+        {
+            size_t mean = m_options.meanFileSize;
+            return mean / 2 + (mean > 0 ? (size_t)(m_random() % (mean + 1)) : 0);
+        }
+
+        unsigned Pick(unsigned range) { return (unsigned)(m_random() % range); }
+        bool Roll(unsigned percent) { return Pick(100) < percent; }
+
+        bool MakeDirectory(const std::filesystem::path& dir)
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(dir, ec);
+            if (ec)
+            {
+                m_failed = true;
+                return false;
+            }
+            ++m_stats.directories;
+            return true;
+        }
+
+        void WriteFile(const std::filesystem::path& path, const std::string& content)
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            if (!file.write(content.data(), (std::streamsize)content.size()))
+            {
+                m_failed = true;
+                return;
+            }
+            ++m_stats.files;
+            m_stats.bytes += content.size();
+        }
+
+        const SyntheticRepo::Options& m_options;
+        SyntheticRepo::Stats& m_stats;
+        std::mt19937_64 m_random;
+        std::string m_lastText; // kept only when duplicates are asked for
+        std::string m_lastExtension;
+        bool m_failed = false;
+    };
+}
+
+bool SyntheticRepo::Generate(const std::string& rootPath, const Options& options, Stats& stats)
+{
+    stats = Stats();
+    return Generator(options, stats).Run(std::filesystem::u8path(rootPath));
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Writes a fake project for the benchmarks: a tree of source folders with
+// code-like files and, optionally, the kind of bulk that the ignore rules are
+// there for (a node_modules folder, build output named in a .gitignore). The
+// same options and seed always produce the same tree, byte for byte.
+class SyntheticRepo
+{
+public:
+    struct Options
+    {
+        unsigned depth = 4;          // folder levels below the root
+        unsigned fanOut = 4;         // subfolders per folder
+        unsigned filesPerDir = 8;
+        size_t meanFileSize = 4096;  // bytes; sizes vary between half and one and a half times this
+        unsigned binaryPercent = 2;  // files with binary content
+        unsigned crlfPercent = 10;   // text files with Windows line endings
+        unsigned duplicatePercent = 0; // text files that repeat the one written before them
+        unsigned nodeModules = 0;    // packages in a node_modules folder, each with a nested dependency
+        bool gitignore = true;       // a .gitignore plus a build/ folder it ignores
+        uint64_t seed = 1;
+    };
+
+    struct Stats
+    {
+        size_t files = 0;
+        size_t directories = 0;
+        uint64_t bytes = 0;
+    };
+
+    // rootPath must not exist yet, or be an empty folder
+    static bool Generate(const std::string& rootPath, const Options& options, Stats& stats);
+};
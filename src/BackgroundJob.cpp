@@ -0,0 +1,24 @@
+#include "BackgroundJob.h"
+
+void BackgroundJob::Start(Work work)
+{
+    Cancel();
+    m_progress.Reset();
+    m_running = true;
+    m_thread = std::thread([this, work = std::move(work)] {
+        work(m_progress);
+        m_running = false;
+    });
+}
+
+void BackgroundJob::Cancel()
+{
+    m_progress.Cancel();
+    Join();
+}
+
+void BackgroundJob::Join()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
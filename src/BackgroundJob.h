@@ -0,0 +1,42 @@
+#pragma once
+
+#include "JobProgress.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+// Runs one piece of work at a time on a thread of its own, with a JobProgress
+// for the work to report to and to check for cancellation. Starting new work
+// cancels the running one and waits for it, so a job can be replaced without
+// the two ever overlapping.
+//
+// The work usually ends by handing its result to the UI thread, which then
+// calls Join(); the thread is finished by then or about to be.
+class BackgroundJob
+{
+public:
+    using Work = std::function<void(JobProgress& progress)>;
+
+    BackgroundJob() = default;
+    ~BackgroundJob() { Cancel(); }
+
+    BackgroundJob(const BackgroundJob&) = delete;
+    BackgroundJob& operator=(const BackgroundJob&) = delete;
+
+    void Start(Work work);
+    // Asks the work to stop and returns at once
+    void RequestCancel() { m_progress.Cancel(); }
+    // Asks the work to stop and waits until it has
+    void Cancel();
+    void Join();
+
+    // Until the work returns, not until it is joined
+    bool IsRunning() const { return m_running; }
+    const JobProgress& GetProgress() const { return m_progress; }
+
+private:
+    std::thread m_thread;
+    JobProgress m_progress;
+    std::atomic<bool> m_running{ false };
+};
@@ -0,0 +1,193 @@
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#ifdef SCRIPTCOMBINER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SCRIPTCOMBINER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+bool BlockCompressor::IsAvailable(Format format)
+{
+    switch (format)
+    {
+        case Format::None: return true;
+#ifdef SCRIPTCOMBINER_HAVE_ZLIB
+        case Format::Gzip: return true;
+#endif
+#ifdef SCRIPTCOMBINER_HAVE_ZSTD
+        case Format::Zstd: return true;
+#endif
+        default:
+            break;
+    }
+    return false;
+}
+
+bool BlockCompressor::FromName(std::string_view name, Format& format)
+{
+    if (name == "gzip" || name == "gz")
+        format = Format::Gzip;
+    else if (name == "zstd" || name == "zst")
+        format = Format::Zstd;
+    else if (name == "none")
+        format = Format::None;
+    else
+        return false;
+    return true;
+}
+
+const char* BlockCompressor::GetName(Format format)
+{
+    switch (format)
+    {
+        case Format::Gzip: return "gzip";
+        case Format::Zstd: return "zstd";
+        case Format::None: break;
+    }
+    return "none";
+}
+
+const char* BlockCompressor::GetExtension(Format format)
+{
+    switch (format)
+    {
+        case Format::Gzip: return ".gz";
+        case Format::Zstd: return ".zst";
+        case Format::None: break;
+    }
+    return "";
+}
+
+BlockCompressor::BlockCompressor(std::ostream& out, Format format, int level, unsigned threadCount, size_t blockSize)
+    : m_out(out), m_format(format), m_level(level), m_blockSize(blockSize), m_pool(threadCount)
+{
+    if (m_level == 0)
+        m_level = format == Format::Zstd ? 3 : 6;
+    m_maxInFlight = (size_t)m_pool.GetThreadCount() * 2;
+    m_current.reserve(m_blockSize);
+    if (!IsAvailable(format) || format == Format::None)
+        m_failed = true;
+}
+
+BlockCompressor::~BlockCompressor()
+{
+    m_pool.Wait();
+}
+
+void BlockCompressor::Write(const char* data, size_t size)
+{
+    while (size > 0 && !m_failed)
+    {
+        size_t piece = std::min(size, m_blockSize - m_current.size());
+        m_current.append(data, piece);
+        data += piece;
+        size -= piece;
+        if (m_current.size() == m_blockSize)
+            SubmitBlock();
+    }
+}
+
+bool BlockCompressor::Finish()
+{
+    // An empty input still needs one member/frame to be a valid file
+    if (!m_current.empty() || !m_wroteBlock)
+        SubmitBlock();
+    WriteBlocks(0);
+    if (!m_out.flush())
+        m_failed = true;
+    return !m_failed;
+}
+
+void BlockCompressor::SubmitBlock()
+{
+    WriteBlocks(m_maxInFlight - 1);
+
+    auto block = std::make_unique<Block>();
+    block->input.swap(m_current);
+    m_current.reserve(m_blockSize);
+    Block* pending = block.get();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_blocks.push_back(std::move(block));
+    }
+    m_wroteBlock = true;
+
+    m_pool.Submit([this, pending] {
+        Compress(*pending);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            pending->done = true;
+        }
+        m_blockDone.notify_all();
+    });
+
+    // Whatever finished meanwhile goes out now, so the queue seldom fills up
+    WriteBlocks(SIZE_MAX);
+}
+
+// Writes finished blocks in order, waiting for the oldest while more than maxWaiting are queued
+void BlockCompressor::WriteBlocks(size_t maxWaiting)
+{
+    for (;;)
+    {
+        std::unique_ptr<Block> block;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_blocks.empty())
+                return;
+            if (m_blocks.size() > maxWaiting)
+                m_blockDone.wait(lock, [this] { return m_blocks.front()->done; });
+            else if (!m_blocks.front()->done)
+                return;
+            block = std::move(m_blocks.front());
+            m_blocks.pop_front();
+        }
+
+        if (block->failed || !m_out.write(block->output.data(), (std::streamsize)block->output.size()))
+            m_failed = true;
+        m_bytesOut += block->output.size();
+    }
+}
+
+void BlockCompressor::Compress(Block& block) const
+{
+    const std::string& input = block.input;
+    std::string& output = block.output;
+
+    if (m_format == Format::Gzip)
+    {
+#ifdef SCRIPTCOMBINER_HAVE_ZLIB
+        // windowBits 15 + 16: a gzip header and trailer around each block
+        z_stream stream = {};
+        if (deflateInit2(&stream, m_level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            block.failed = true;
+            return;
+        }
+        output.resize(deflateBound(&stream, (uLong)input.size()));
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream.avail_in = (uInt)input.size();
+        stream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+        stream.avail_out = (uInt)output.size();
+        block.failed = deflate(&stream, Z_FINISH) != Z_STREAM_END;
+        output.resize(stream.total_out);
+        deflateEnd(&stream);
+        return;
+#endif
+    }
+    else if (m_format == Format::Zstd)
+    {
+#ifdef SCRIPTCOMBINER_HAVE_ZSTD
+        output.resize(ZSTD_compressBound(input.size()));
+        size_t size = ZSTD_compress(&output[0], output.size(), input.data(), input.size(), m_level);
+        block.failed = ZSTD_isError(size) != 0;
+        output.resize(block.failed ? 0 : size);
+        return;
+#endif
+    }
+    block.failed = true;
+}
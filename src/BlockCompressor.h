@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Compresses a stream of bytes on several threads, pigz/pzstd style: the input
+// is cut into blocks that are compressed independently and written out in
+// order, as consecutive gzip members or zstd frames. Both formats define a
+// file of concatenated members/frames as one stream, so gunzip, zstd -d and
+// the libraries read the result like any other .gz or .zst file.
+//
+// Memory use is bounded: once twice as many blocks as there are threads are
+// waiting, Write() waits for the oldest to be written. Writing to the output
+// stream happens on the caller's thread only.
+class BlockCompressor
+{
+public:
+    enum class Format { None, Gzip, Zstd };
+
+    // Whether this build was linked with the library for a format
+    static bool IsAvailable(Format format);
+    // "gzip"/"gz", "zstd"/"zst" or "none"
+    static bool FromName(std::string_view name, Format& format);
+    static const char* GetName(Format format);
+    static const char* GetExtension(Format format); // ".gz", ".zst", "" for None
+
+    // level 0 picks the format's default; threadCount 0 one per core
+    BlockCompressor(std::ostream& out, Format format, int level = 0, unsigned threadCount = 0,
+                    size_t blockSize = 1024 * 1024);
+    ~BlockCompressor(); // waits for blocks still being compressed, without writing them
+
+    BlockCompressor(const BlockCompressor&) = delete;
+    BlockCompressor& operator=(const BlockCompressor&) = delete;
+
+    void Write(const char* data, size_t size);
+    // Compresses what is left and writes every block; false if compression or the stream failed
+    bool Finish();
+
+    bool HasFailed() const { return m_failed; }
+    uint64_t GetBytesOut() const { return m_bytesOut; }
+
+private:
+    struct Block
+    {
+        std::string input;
+        std::string output;
+        bool done = false;
+        bool failed = false;
+    };
+
+    void SubmitBlock();
+    void WriteBlocks(size_t maxWaiting);
+    void Compress(Block& block) const;
+
+    std::ostream& m_out;
+    Format m_format;
+    int m_level;
+    size_t m_blockSize;
+    size_t m_maxInFlight;
+    std::string m_current; // filling up
+    bool m_wroteBlock = false;
+    bool m_failed = false;
+    uint64_t m_bytesOut = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_blockDone;
+    std::deque<std::unique_ptr<Block>> m_blocks; // submitted, in output order
+    ThreadPool m_pool;                           // last, so it stops before the blocks go away
+};
@@ -0,0 +1,415 @@
+// scriptcombiner-cli: the export of the app without the app, for scripts, CI
+// and build servers. Uses the same scanner, filters and export code as the
+// GUI and links nothing of wxWidgets.
+
+#include "CombinedExport.h"
+#include "DirectoryScanner.h"
+#include "EntryRules.h"
+#include "FileTypeRegistry.h"
+#include "ProjectPresets.h"
+#include "TokenCounter.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    const char* const kUsage =
+        "Usage: scriptcombiner-cli [options] <project-folder>\n"
+        "\n"
+        "Combines the files of a project into one text file, as the Script Combiner app does.\n"
+        "\n"
+        "Options:\n"
+        "  -o, --output PATH       where to write (default: the app's file name, in the current folder)\n"
+        "  -p, --preset NAME       godot, unity, node or default (default: detected from the project)\n"
+        "  -e, --ext LIST          export only these extensions, comma separated (\"gd,tscn\"),\n"
+        "                          instead of the file types of the preset\n"
+        "  -i, --ignore PATTERN    add an ignore pattern (.gitignore syntax); repeatable\n"
+        "  -I, --ignore-file PATH  add the patterns of a file; repeatable\n"
+        "      --no-preset-ignores start from no ignore patterns instead of the preset's\n"
+        "      --no-gitignore      do not apply the project's .gitignore files\n"
+        "      --hidden            include hidden files and folders\n"
+        "      --languages PATH    file type table to use instead of the built-in one\n"
+        "      --split-tokens N    split into parts of at most N tokens (k and M suffixes allowed)\n"
+        "      --split-bytes N     split into parts of at most N bytes (k and M suffixes allowed)\n"
+        "      --vocabulary PATH   cl100k_base.tiktoken, for exact token counts when splitting\n"
+        "  -z, --compress FORMAT   gzip or zstd, compressed on all cores while writing (default: from\n"
+        "                          the output name, .gz or .zst)\n"
+        "      --dedup             write files with identical contents once, later copies as a reference\n"
+        "      --strip-comments    drop comments, trailing blanks and empty lines from source files,\n"
+        "                          keeping string literals and indentation\n"
+        "      --manifest          also write a manifest of the export next to it (name.manifest)\n"
+        "      --since PATH        write only what changed since the export of this manifest, and an\n"
+        "                          updated manifest next to the output\n"
+        "      --tree-depth N      show folders N levels down with a file count instead of their contents\n"
+        "      --tree-collapse N   in the tree, replace the files of folders with more than N entries by\n"
+        "                          one line counting them by extension\n"
+        "      --list              print the files that would be exported, and write nothing\n"
+        "  -q, --quiet             print nothing but errors\n"
+        "  -h, --help              show this help\n";
+
+    struct Options
+    {
+        std::string root;
+        std::string output;
+        std::string preset;               // empty: detect
+        std::vector<std::string> extensions; // empty: the preset's file types
+        std::string extraPatterns;        // from --ignore and --ignore-file, after the preset's
+        bool presetIgnores = true;
+        bool useGitignore = true;
+        bool showHidden = false;
+        std::string languagesPath;
+        uint64_t splitTokens = 0;
+        uint64_t splitBytes = 0;
+        std::string compression;          // empty: from the output name
+        std::string vocabularyPath;
+        bool deduplicate = false;
+        bool stripComments = false;
+        bool manifest = false;
+        std::string sincePath;            // manifest of the export to compare with
+        uint64_t treeDepth = 0;           // 0: the whole tree
+        uint64_t treeCollapse = 0;        // 0: every entry listed
+        bool list = false;
+        bool quiet = false;
+    };
+
+    int Fail(const std::string& message)
+    {
+        std::fprintf(stderr, "scriptcombiner-cli: %s\n", message.c_str());
+        return 1;
+    }
+
+    int UsageError(const std::string& message)
+    {
+        std::fprintf(stderr, "scriptcombiner-cli: %s\nTry 'scriptcombiner-cli --help'.\n", message.c_str());
+        return 2;
+    }
+
+    bool ReadFile(const std::string& path, std::string& text)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        std::ostringstream stream;
+        stream << file.rdbuf();
+        text = stream.str();
+        return true;
+    }
+
+    // "250000", "250k", "1M"
+    bool ParseCount(std::string_view text, uint64_t& count)
+    {
+        uint64_t multiplier = 1;
+        if (!text.empty() && (text.back() == 'k' || text.back() == 'K'))
+            multiplier = 1000, text.remove_suffix(1);
+        else if (!text.empty() && (text.back() == 'm' || text.back() == 'M'))
+            multiplier = 1000000, text.remove_suffix(1);
+        if (text.empty())
+            return false;
+
+        count = 0;
+        for (char c : text)
+        {
+            if (c < '0' || c > '9' || count > UINT64_MAX / 100)
+                return false;
+            count = count * 10 + (uint64_t)(c - '0');
+        }
+        count *= multiplier;
+        return count > 0;
+    }
+
+    std::vector<std::string> SplitList(std::string_view text)
+    {
+        std::vector<std::string> items;
+        size_t start = 0;
+        while (start <= text.size())
+        {
+            size_t comma = text.find(',', start);
+            if (comma == std::string_view::npos)
+                comma = text.size();
+            std::string_view item = text.substr(start, comma - start);
+            if (!item.empty() && item[0] == '.')
+                item.remove_prefix(1);
+            if (!item.empty())
+                items.emplace_back(item);
+            start = comma + 1;
+        }
+        return items;
+    }
+
+    std::string GetDate()
+    {
+        std::time_t now = std::time(nullptr);
+        char date[16];
+        std::strftime(date, sizeof(date), "%Y-%m-%d", std::localtime(&now));
+        return date;
+    }
+
+    // Returns -1 when the options are complete, otherwise the exit code
+    int ParseArguments(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            std::string value;
+            bool hasValue = false;
+
+            // --name=value as well as --name value
+            size_t equals = arg.find('=');
+            if (arg.compare(0, 2, "--") == 0 && equals != std::string::npos)
+            {
+                value = arg.substr(equals + 1);
+                arg.resize(equals);
+                hasValue = true;
+            }
+            auto takeValue = [&]() {
+                if (!hasValue && i + 1 < argc)
+                {
+                    value = argv[++i];
+                    hasValue = true;
+                }
+                return hasValue;
+            };
+
+            if (arg == "-h" || arg == "--help")
+            {
+                std::fputs(kUsage, stdout);
+                return 0;
+            }
+            else if (arg == "-q" || arg == "--quiet")
+                options.quiet = true;
+            else if (arg == "--list")
+                options.list = true;
+            else if (arg == "--dedup")
+                options.deduplicate = true;
+            else if (arg == "--strip-comments")
+                options.stripComments = true;
+            else if (arg == "--manifest")
+                options.manifest = true;
+            else if (arg == "--hidden")
+                options.showHidden = true;
+            else if (arg == "--no-gitignore")
+                options.useGitignore = false;
+            else if (arg == "--no-preset-ignores")
+                options.presetIgnores = false;
+            else if (arg == "-o" || arg == "--output" || arg == "-p" || arg == "--preset" || arg == "-e" || arg == "--ext" ||
+                     arg == "-i" || arg == "--ignore" || arg == "-I" || arg == "--ignore-file" || arg == "--languages" ||
+                     arg == "--split-tokens" || arg == "--split-bytes" || arg == "--vocabulary" || arg == "--since" ||
+                     arg == "-z" || arg == "--compress" || arg == "--tree-depth" || arg == "--tree-collapse")
+            {
+                if (!takeValue())
+                    return UsageError("option " + arg + " needs a value");
+
+                if (arg == "-o" || arg == "--output")
+                    options.output = value;
+                else if (arg == "-p" || arg == "--preset")
+                    options.preset = value;
+                else if (arg == "-e" || arg == "--ext")
+                {
+                    std::vector<std::string> extensions = SplitList(value);
+                    options.extensions.insert(options.extensions.end(), extensions.begin(), extensions.end());
+                }
+                else if (arg == "-i" || arg == "--ignore")
+                    options.extraPatterns += value + "\n";
+                else if (arg == "-I" || arg == "--ignore-file")
+                {
+                    std::string patterns;
+                    if (!ReadFile(value, patterns))
+                        return Fail("cannot read ignore file " + value);
+                    options.extraPatterns += patterns + "\n";
+                }
+                else if (arg == "--languages")
+                    options.languagesPath = value;
+                else if (arg == "--vocabulary")
+                    options.vocabularyPath = value;
+                else if (arg == "-z" || arg == "--compress")
+                    options.compression = value;
+                else if (arg == "--since")
+                {
+                    options.sincePath = value;
+                    options.manifest = true;
+                }
+                else if (arg == "--tree-depth" || arg == "--tree-collapse")
+                {
+                    if (!ParseCount(value, arg == "--tree-depth" ? options.treeDepth : options.treeCollapse) || options.treeDepth > UINT32_MAX)
+                        return UsageError("invalid count '" + value + "'");
+                }
+                else if (!ParseCount(value, arg == "--split-tokens" ? options.splitTokens : options.splitBytes))
+                    return UsageError("invalid part size '" + value + "'");
+            }
+            else if (!arg.empty() && arg[0] == '-' && arg != "-")
+                return UsageError("unknown option " + arg);
+            else if (options.root.empty())
+                options.root = arg;
+            else
+                return UsageError("more than one project folder given");
+        }
+
+        if (options.root.empty())
+            return UsageError("no project folder given");
+        if (options.splitTokens > 0 && options.splitBytes > 0)
+            return UsageError("--split-tokens and --split-bytes cannot be combined");
+        return -1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    int exitCode = ParseArguments(argc, argv, options);
+    if (exitCode >= 0)
+        return exitCode;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // --- Settings, as the app's presets and checkboxes would set them ---
+    ProjectType type = ProjectPresets::Detect(options.root);
+    if (!options.preset.empty() && !ProjectPresets::FromName(options.preset, type))
+        return UsageError("unknown preset '" + options.preset + "'");
+
+    FileTypeRegistry fileTypes = FileTypeRegistry::CreateDefault();
+    if (!options.languagesPath.empty() && !fileTypes.LoadFile(options.languagesPath))
+        return Fail("cannot read file types from " + options.languagesPath);
+
+    ExtensionTable extensions;
+    if (options.extensions.empty())
+    {
+        std::vector<bool> enabledTypes(fileTypes.GetTypes().size(), false);
+        for (size_t i = 0; i < enabledTypes.size(); ++i)
+            enabledTypes[i] = fileTypes.GetTypes()[i].filter && fileTypes.IsInPreset(i, ProjectPresets::GetName(type));
+        extensions = fileTypes.BuildExtensionTable(enabledTypes);
+    }
+    else
+    {
+        for (const std::string& extension : options.extensions)
+            extensions.Add(extension, 0);
+    }
+
+    EntryRules rules;
+    std::string patterns = options.presetIgnores ? ProjectPresets::GetIgnorePatterns(type) : "";
+    rules.SetIgnorePatterns(patterns + options.extraPatterns);
+    rules.SetShowHidden(options.showHidden);
+    rules.SetUseGitignore(options.useGitignore);
+    rules.SetEnabledExtensions(std::move(extensions));
+
+    // --- Scan ---
+    std::error_code ec;
+    if (!std::filesystem::is_directory(std::filesystem::u8path(options.root), ec))
+        return Fail("not a folder: " + options.root);
+
+    DirectoryScanner scanner;
+    scanner.SetDescendFilter(rules.GetDescendFilter());
+    ProjectModel model = scanner.Scan(options.root);
+
+    ProjectFilter filter;
+    filter.ApplyAndScan(model, scanner, rules.GetVisibilityFilter());
+
+    if (options.list)
+    {
+        for (const ExportPipeline::Item& item : CombinedExport::CollectItems(model, filter))
+            std::printf("%s\n", item.label.c_str());
+        return 0;
+    }
+
+    // --- Export ---
+    ExportWriter::SplitOptions split;
+    std::unique_ptr<TokenCounter> tokenCounter;
+    if (options.splitTokens > 0)
+    {
+        tokenCounter = std::make_unique<TokenCounter>();
+        if (!options.vocabularyPath.empty() && !tokenCounter->LoadVocabulary(options.vocabularyPath))
+            return Fail("cannot load vocabulary " + options.vocabularyPath);
+        TokenCounter::Mode mode = tokenCounter->HasVocabulary() ? TokenCounter::Mode::Exact : TokenCounter::Mode::Approximate;
+        split.partBudget = options.splitTokens;
+        split.measure = [counter = tokenCounter.get(), mode](std::string_view text) { return (uint64_t)counter->Count(text, mode); };
+    }
+    else if (options.splitBytes > 0)
+    {
+        split.partBudget = options.splitBytes;
+    }
+
+    BlockCompressor::Format compression = BlockCompressor::Format::None;
+    if (!options.compression.empty() && !BlockCompressor::FromName(options.compression, compression))
+        return UsageError("unknown compression '" + options.compression + "'");
+    if (options.compression.empty())
+    {
+        for (BlockCompressor::Format format : { BlockCompressor::Format::Gzip, BlockCompressor::Format::Zstd })
+        {
+            std::string extension = BlockCompressor::GetExtension(format);
+            if (options.output.size() > extension.size() &&
+                options.output.compare(options.output.size() - extension.size(), extension.size(), extension) == 0)
+                compression = format;
+        }
+    }
+    if (!BlockCompressor::IsAvailable(compression))
+        return Fail(std::string("this build has no ") + BlockCompressor::GetName(compression) + " support");
+
+    std::string output = options.output;
+    if (output.empty())
+        output = ProjectPresets::GetExportFileName(type, model.GetNode(model.GetRoot()).name, GetDate()) +
+                 BlockCompressor::GetExtension(compression);
+
+    ExportManifest previous;
+    if (!options.sincePath.empty() && !previous.Load(options.sincePath))
+        return Fail("cannot read manifest " + options.sincePath);
+
+    ExportWriter writer;
+    writer.SetCompression(compression);
+    if (!writer.Open(output, split))
+        return Fail("cannot write " + output);
+    ExportPipeline::Options exportOptions;
+    exportOptions.deduplicate = options.deduplicate;
+    exportOptions.stripComments = options.stripComments;
+    exportOptions.fileTypes = &fileTypes;
+    CombinedExport::TreeOptions tree;
+    tree.maxDepth = (unsigned)options.treeDepth;
+    tree.collapseOver = (size_t)options.treeCollapse;
+    ExportManifest manifest;
+    CombinedExport::Summary summary;
+    if (!options.sincePath.empty())
+        summary = CombinedExport::WriteChanges(model, filter, writer, previous, manifest, exportOptions, tree);
+    else
+        summary = CombinedExport::Write(model, filter, writer, exportOptions, options.manifest ? &manifest : nullptr, tree);
+    uint64_t bytes = writer.GetBytesWritten();
+    if (!writer.Commit())
+        return Fail("cannot write " + output);
+    if (options.manifest && !manifest.Save(ExportManifest::GetPathFor(output)))
+        return Fail("cannot write " + ExportManifest::GetPathFor(output));
+
+    if (!options.quiet)
+    {
+        long long milliseconds = (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        // A split export is numbered even when it fits in one part, so the names written are the ones reported
+        std::string written = writer.GetPartPath(1);
+        std::string parts;
+        if (writer.GetPartCount() > 1)
+        {
+            written += " ... " + writer.GetPartPath(writer.GetPartCount());
+            parts = " in " + std::to_string(writer.GetPartCount()) + " parts";
+        }
+        std::string details;
+        if (summary.duplicates > 0)
+            details += ", " + std::to_string(summary.duplicates) + " as duplicates";
+        if (!options.sincePath.empty())
+            details += ", " + std::to_string(summary.unchanged) + " unchanged, " + std::to_string(summary.deleted) + " deleted";
+        if (!details.empty())
+            details = " (" + details.substr(2) + ")";
+        if (compression != BlockCompressor::Format::None)
+            parts += ", " + std::to_string(writer.GetBytesStored()) + " compressed";
+        std::fprintf(stderr, "%zu files%s, %llu bytes written to %s%s (%lld ms)\n", summary.files, details.c_str(),
+                     (unsigned long long)bytes, written.c_str(), parts.c_str(), milliseconds);
+        if (options.stripComments)
+            std::fputs(CombinedExport::FormatSavings(fileTypes, summary.savings).c_str(), stderr);
+    }
+    return 0;
+}
@@ -0,0 +1,500 @@
+#include "CombinedExport.h"
+#include "ContentHash.h"
+#include "FileStamp.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <unordered_map>
+
+namespace
+{
+    const char* const kSectionRule = "# -------------------------------------------------------------------------\n";
+
+    // Box-drawing characters, spelled out as UTF-8 so the source encoding does not matter
+    const char* const kBranch = "\xE2\x94\x9C\xE2\x94\x80\xE2\x94\x80 ";     // "├── "
+    const char* const kLastBranch = "\xE2\x94\x94\xE2\x94\x80\xE2\x94\x80 "; // "└── "
+    const char* const kPipe = "\xE2\x94\x82   ";                              // "│   "
+    const char* const kSpace = "    ";
+    const char* const kEllipsis = "\xE2\x80\xA6 ";                            // "… "
+
+    // "1,204,388"
+    std::string FormatThousands(uint64_t value)
+    {
+        std::string digits = std::to_string(value);
+        std::string text;
+        for (size_t i = 0; i < digits.size(); ++i)
+        {
+            if (i > 0 && (digits.size() - i) % 3 == 0)
+                text += ',';
+            text += digits[i];
+        }
+        return text;
+    }
+
+    std::string FormatSavingsLine(const std::string& label, const CommentStripper::Savings& savings)
+    {
+        double percent = savings.bytesIn > 0 ? 100.0 * (double)(savings.bytesIn - savings.bytesOut) / (double)savings.bytesIn : 0.0;
+        char line[256];
+        std::snprintf(line, sizeof(line), "  %-14s %6zu files  %s -> %s bytes  (-%.1f%%)\n", label.c_str(), savings.files,
+                      FormatThousands(savings.bytesIn).c_str(), FormatThousands(savings.bytesOut).c_str(), percent);
+        return line;
+    }
+
+    // "(*.png 3,900, *.json 313)": the three most common extensions, then the rest together
+    std::string FormatExtensionCounts(const std::unordered_map<std::string_view, size_t>& extensions, size_t files)
+    {
+        std::vector<std::pair<std::string_view, size_t>> counts;
+        for (const auto& extension : extensions)
+        {
+            if (!extension.first.empty())
+                counts.push_back(extension);
+        }
+        std::sort(counts.begin(), counts.end(), [](const auto& a, const auto& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+
+        std::string text = " (";
+        size_t listed = 0;
+        for (size_t i = 0; i < counts.size() && i < 3; ++i)
+        {
+            if (i > 0)
+                text += ", ";
+            text += "*.";
+            text += counts[i].first;
+            text += ' ';
+            text += FormatThousands(counts[i].second);
+            listed += counts[i].second;
+        }
+        if (listed < files)
+        {
+            if (listed > 0)
+                text += ", ";
+            text += FormatThousands(files - listed) + " other";
+        }
+        text += ')';
+        return text;
+    }
+
+    // Writes the tree a line at a time into text. With a sink, text is handed over and cleared
+    // whenever it fills up, so the caller never holds more than a block of it.
+    class TreeRenderer
+    {
+    public:
+        using Sink = std::function<void(std::string_view)>;
+
+        TreeRenderer(const ProjectModel& model, const ProjectFilter& filter, const CombinedExport::TreeOptions& options,
+                     std::string& text, Sink sink = Sink())
+            : m_model(model), m_filter(filter), m_options(options), m_text(text), m_sink(std::move(sink))
+        {
+        }
+
+        void Render()
+        {
+            if (m_model.IsEmpty())
+                return;
+
+            m_text += m_model.GetNode(m_model.GetRoot()).name;
+            m_text += "/\n";
+            m_indent = kSpace;
+            RenderFolder(m_model.GetRoot(), 1);
+            if (m_sink && !m_text.empty())
+            {
+                m_sink(m_text);
+                m_text.clear();
+            }
+        }
+
+    private:
+        static constexpr size_t kBlockSize = 64 * 1024;
+
+        void RenderFolder(uint32_t folder, unsigned depth)
+        {
+            // Walks the model rather than the control, so collapsed folders are included
+            const std::vector<uint32_t>& children = m_model.GetNode(folder).children;
+            if (m_options.collapseOver > 0 && children.size() > m_options.collapseOver)
+            {
+                size_t visible = 0;
+                for (uint32_t child : children)
+                    visible += m_filter.IsVisible(child) ? 1 : 0;
+                if (visible > m_options.collapseOver)
+                {
+                    RenderSummary(children, depth);
+                    return;
+                }
+            }
+
+            size_t last = children.size();
+            while (last > 0 && !m_filter.IsVisible(children[last - 1]))
+                --last;
+            for (size_t i = 0; i < last; ++i)
+            {
+                if (m_filter.IsVisible(children[i]))
+                    RenderEntry(children[i], i + 1 == last, depth);
+            }
+        }
+
+        void RenderEntry(uint32_t index, bool isLast, unsigned depth)
+        {
+            const ProjectNode& node = m_model.GetNode(index);
+            BeginLine(isLast);
+            m_text += node.name;
+            if (!node.isDir)
+            {
+                EndLine();
+                return;
+            }
+
+            m_text += '/';
+            if (m_options.maxDepth > 0 && depth >= m_options.maxDepth)
+            {
+                // Past the depth limit a folder only says how much it holds
+                AppendFileCount(m_filter.GetVisibleFileCount(index), " (", ")");
+                EndLine();
+                return;
+            }
+            EndLine();
+
+            size_t indentLength = m_indent.size();
+            m_indent += isLast ? kSpace : kPipe;
+            RenderFolder(index, depth + 1);
+            m_indent.resize(indentLength);
+        }
+
+        // A folder over the entry limit: its files become one line, counted by extension. Its folders are
+        // listed as usual unless there are too many of them as well, in which case they become a line too.
+        void RenderSummary(const std::vector<uint32_t>& children, unsigned depth)
+        {
+            std::vector<uint32_t> folders;
+            size_t files = 0;
+            std::unordered_map<std::string_view, size_t> extensions;
+            for (uint32_t child : children)
+            {
+                if (!m_filter.IsVisible(child))
+                    continue;
+                const ProjectNode& node = m_model.GetNode(child);
+                if (node.isDir)
+                {
+                    folders.push_back(child);
+                    continue;
+                }
+                ++files;
+                ++extensions[ExtensionTable::GetExtension(node.name)];
+            }
+
+            if (folders.size() <= m_options.collapseOver)
+            {
+                for (size_t i = 0; i < folders.size(); ++i)
+                    RenderEntry(folders[i], files == 0 && i + 1 == folders.size(), depth);
+            }
+            else
+            {
+                size_t nestedFiles = 0;
+                for (uint32_t folder : folders)
+                    nestedFiles += m_filter.GetVisibleFileCount(folder);
+                BeginLine(files == 0);
+                m_text += kEllipsis;
+                m_text += FormatThousands(folders.size());
+                m_text += " folders";
+                AppendFileCount(nestedFiles, " (", ")");
+                EndLine();
+            }
+
+            if (files > 0)
+            {
+                BeginLine(true);
+                m_text += kEllipsis;
+                AppendFileCount(files, "", FormatExtensionCounts(extensions, files));
+                EndLine();
+            }
+        }
+
+        void AppendFileCount(size_t files, std::string_view prefix, std::string_view suffix)
+        {
+            if (files == 0)
+                return;
+            m_text += prefix;
+            m_text += FormatThousands(files);
+            m_text += files == 1 ? " file" : " files";
+            m_text += suffix;
+        }
+
+        void BeginLine(bool isLast)
+        {
+            m_text += m_indent;
+            m_text += isLast ? kLastBranch : kBranch;
+        }
+
+        void EndLine()
+        {
+            m_text += '\n';
+            if (m_sink && m_text.size() >= kBlockSize)
+            {
+                m_sink(m_text);
+                m_text.clear();
+            }
+        }
+
+        const ProjectModel& m_model;
+        const ProjectFilter& m_filter;
+        const CombinedExport::TreeOptions& m_options;
+        std::string& m_text;
+        Sink m_sink;
+        std::string m_indent;
+    };
+}
+
+std::string CombinedExport::FormatTree(const ProjectModel& model, const ProjectFilter& filter, const TreeOptions& tree)
+{
+    std::string text;
+    TreeRenderer(model, filter, tree, text).Render();
+    return text;
+}
+
+std::string CombinedExport::FormatSectionHeader(std::string_view title)
+{
+    std::string header = kSectionRule;
+    header += "# ";
+    header += title;
+    header += '\n';
+    header += kSectionRule;
+    return header;
+}
+
+std::string CombinedExport::FormatSavings(const FileTypeRegistry& fileTypes, const std::vector<CommentStripper::Savings>& savings)
+{
+    std::vector<size_t> order;
+    CommentStripper::Savings total;
+    for (size_t i = 0; i < savings.size() && i < fileTypes.GetTypes().size(); ++i)
+    {
+        if (savings[i].files == 0)
+            continue;
+        order.push_back(i);
+        total.files += savings[i].files;
+        total.bytesIn += savings[i].bytesIn;
+        total.bytesOut += savings[i].bytesOut;
+    }
+    std::stable_sort(order.begin(), order.end(), [&savings](size_t a, size_t b) {
+        return savings[a].bytesIn - savings[a].bytesOut > savings[b].bytesIn - savings[b].bytesOut;
+    });
+
+    std::string report;
+    for (size_t i : order)
+        report += FormatSavingsLine(fileTypes.GetTypes()[i].label, savings[i]);
+    if (order.size() > 1)
+        report += FormatSavingsLine("total", total);
+    return report;
+}
+
+std::vector<ExportPipeline::Item> CombinedExport::CollectItems(const ProjectModel& model, const ProjectFilter& filter)
+{
+    std::vector<ExportPipeline::Item> items;
+    if (model.IsEmpty())
+        return items;
+
+    items.reserve(filter.GetVisibleFileCount());
+    std::string relativeDir;
+    CollectItemsRecursive(model, filter, model.GetRoot(), items, relativeDir);
+    return items;
+}
+
+// The relative path is carried down the recursion instead of walking up the parents for every file
+void CombinedExport::CollectItemsRecursive(const ProjectModel& model, const ProjectFilter& filter, uint32_t parent,
+                                           std::vector<ExportPipeline::Item>& items, std::string& relativeDir)
+{
+    for (uint32_t child : model.GetNode(parent).children)
+    {
+        if (!filter.IsVisible(child))
+            continue;
+
+        const ProjectNode& node = model.GetNode(child);
+        size_t dirLength = relativeDir.size();
+        relativeDir += node.name;
+        if (node.isDir)
+        {
+            relativeDir += '/';
+            CollectItemsRecursive(model, filter, child, items, relativeDir);
+        }
+        else
+        {
+            ExportPipeline::Item item;
+            item.fullPath.reserve(model.GetRootPath().size() + 1 + relativeDir.size());
+            item.fullPath = model.GetRootPath();
+            item.fullPath += '/';
+            item.fullPath += relativeDir;
+            item.header = "\n" + FormatSectionHeader(relativeDir);
+            item.label = relativeDir;
+            item.binary = node.content == ContentKind::Binary;
+            items.push_back(std::move(item));
+        }
+        relativeDir.resize(dirLength);
+    }
+}
+
+void CombinedExport::WriteTree(const ProjectModel& model, const ProjectFilter& filter, const TreeOptions& tree, ExportWriter& writer)
+{
+    writer.BeginStreamedSection("Project Structure", FormatSectionHeader("Project Structure"));
+    std::string text;
+    TreeRenderer(model, filter, tree, text, [&writer](std::string_view block) { writer.WriteStreamedText(block); }).Render();
+    writer.WriteStreamedText("\n");
+}
+
+CombinedExport::Summary CombinedExport::Write(const ProjectModel& model, const ProjectFilter& filter, ExportWriter& writer,
+                                              const ExportPipeline::Options& options, ExportManifest* manifest,
+                                              const TreeOptions& tree)
+{
+    WriteTree(model, filter, tree, writer);
+
+    std::vector<ExportPipeline::Item> items = CollectItems(model, filter);
+    std::vector<ExportManifest::Entry> entries;
+    std::vector<FileChange> changes;
+    if (manifest)
+        ReadStamps(items, nullptr, entries, changes, options.progress);
+
+    // Files are read in parallel but written in tree order; the readers hash them for the manifest on the way
+    ExportPipeline::Options pipelineOptions = options;
+    pipelineOptions.recordHashes = manifest != nullptr;
+    ExportPipeline::Summary written = ExportPipeline(pipelineOptions).Run(items, writer);
+
+    if (manifest)
+    {
+        manifest->Clear();
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            entries[i].hash = written.hashes[i];
+            manifest->Add(std::move(entries[i]));
+        }
+    }
+
+    Summary summary;
+    summary.files = written.files;
+    summary.duplicates = written.duplicates;
+    summary.savings = std::move(written.savings);
+    return summary;
+}
+
+CombinedExport::Summary CombinedExport::WriteChanges(const ProjectModel& model, const ProjectFilter& filter,
+                                                     ExportWriter& writer, const ExportManifest& previous,
+                                                     ExportManifest& current, const ExportPipeline::Options& options,
+                                                     const TreeOptions& tree)
+{
+    WriteTree(model, filter, tree, writer);
+
+    std::vector<ExportPipeline::Item> items = CollectItems(model, filter);
+    std::vector<ExportManifest::Entry> entries;
+    std::vector<FileChange> changes;
+    ReadStamps(items, &previous, entries, changes, options.progress);
+    if (options.progress && options.progress->IsCancelled())
+        return Summary();
+
+    // --- The list of changes, in tree order, deleted files last ---
+    Summary summary;
+    std::string list;
+    std::vector<ExportPipeline::Item> changedItems;
+    std::vector<size_t> changedIndices;
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        if (changes[i] == FileChange::Unchanged)
+        {
+            ++summary.unchanged;
+            continue;
+        }
+        list += changes[i] == FileChange::Added ? "added     " : "modified  ";
+        list += items[i].label + "\n";
+        changedItems.push_back(items[i]);
+        changedIndices.push_back(i);
+    }
+
+    current.Clear();
+    for (ExportManifest::Entry& entry : entries)
+        current.Add(std::move(entry));
+    for (const ExportManifest::Entry& entry : previous.GetEntries())
+    {
+        if (!current.Find(entry.path))
+        {
+            list += "deleted   " + entry.path + "\n";
+            ++summary.deleted;
+        }
+    }
+
+    if (list.empty())
+        list = "No files changed.\n";
+    if (summary.unchanged > 0)
+        list += std::to_string(summary.unchanged) + " unchanged files are left out.\n";
+    std::string title = "Changes since " + (previous.GetCreated().empty() ? std::string("the last export") : previous.GetCreated());
+    writer.WriteSection(title, "\n" + FormatSectionHeader(title), list, writer.Measure(list));
+
+    // --- The added and modified files ---
+    ExportPipeline::Options pipelineOptions = options;
+    pipelineOptions.recordHashes = true;
+    ExportPipeline::Summary written = ExportPipeline(pipelineOptions).Run(changedItems, writer);
+
+    // Added files get their hash from the readers; modified ones were hashed to tell them from touched ones
+    std::vector<ExportManifest::Entry> updated;
+    for (size_t i = 0; i < changedIndices.size(); ++i)
+    {
+        if (written.hashes[i] == 0)
+            continue;
+        ExportManifest::Entry entry = *current.Find(items[changedIndices[i]].label);
+        entry.hash = written.hashes[i];
+        current.Add(std::move(entry));
+    }
+
+    summary.files = written.files;
+    summary.duplicates = written.duplicates;
+    summary.savings = std::move(written.savings);
+    return summary;
+}
+
+void CombinedExport::ReadStamps(const std::vector<ExportPipeline::Item>& items, const ExportManifest* previous,
+                                std::vector<ExportManifest::Entry>& entries, std::vector<FileChange>& changes,
+                                JobProgress* progress)
+{
+    entries.assign(items.size(), ExportManifest::Entry());
+    changes.assign(items.size(), FileChange::Added);
+
+    // One stat per file, spread over a pool: a mostly unchanged project reads no contents at all
+    ThreadPool pool;
+    if (progress)
+        progress->StartPhase(previous ? "Comparing" : "Reading file stamps", items.size());
+    const size_t batchSize = 256;
+    for (size_t begin = 0; begin < items.size(); begin += batchSize)
+    {
+        size_t end = std::min(begin + batchSize, items.size());
+        pool.Submit([&items, previous, &entries, &changes, progress, begin, end] {
+            if (progress && progress->IsCancelled())
+                return;
+            for (size_t i = begin; i < end; ++i)
+            {
+                ExportManifest::Entry& entry = entries[i];
+                entry.path = items[i].label;
+                FileStamp stamp;
+                FileStamp::Read(items[i].fullPath, stamp);
+                entry.size = stamp.size;
+                entry.mtime = stamp.mtime;
+
+                const ExportManifest::Entry* old = previous ? previous->Find(entry.path) : nullptr;
+                if (!old)
+                    continue;
+                if (old->size == entry.size && old->mtime == entry.mtime)
+                {
+                    entry.hash = old->hash;
+                    changes[i] = FileChange::Unchanged;
+                    continue;
+                }
+
+                // Touched but not edited (a checkout, a save without changes) still counts as unchanged
+                uint64_t hash = 0;
+                uint64_t size = 0;
+                bool hashed = old->size == entry.size && old->hash != 0 &&
+                              ContentHash::HashFile(items[i].fullPath, hash, size);
+                entry.hash = hashed ? hash : 0;
+                changes[i] = hashed && hash == old->hash && size == old->size ? FileChange::Unchanged : FileChange::Modified;
+            }
+            if (progress)
+                progress->Add(end - begin);
+        });
+    }
+    pool.Wait();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ExportManifest.h"
+#include "ExportPipeline.h"
+#include "ExportWriter.h"
+#include "ProjectFilter.h"
+#include "ProjectModel.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The layout of a combined file: the tree of the visible entries, then every
+// visible file in tree order under a header with its relative path. Shared by
+// the app and the command line tool, so both produce the same output.
+//
+// A delta export (WriteChanges) has the same tree, then a list of the files
+// added, modified and deleted since an earlier export, then only the added and
+// modified files. What the earlier export contained comes from its manifest.
+//
+// A cancel through ExportPipeline::Options::progress stops either one early;
+// the writer then holds an incomplete export that must not be committed.
+class CombinedExport
+{
+public:
+    struct Summary
+    {
+        size_t files = 0;      // files written
+        size_t duplicates = 0; // of those, written as a reference to an identical file
+        size_t unchanged = 0;  // delta export: files left out
+        size_t deleted = 0;    // delta export: files of the earlier export that are gone
+        std::vector<CommentStripper::Savings> savings; // per file type, when comments were stripped
+    };
+
+    // How much of the tree goes into the export. Either limit replaces entries by a count, so rendering
+    // takes time in proportion to the lines written rather than to the size of the project.
+    struct TreeOptions
+    {
+        TreeOptions() {} // lets GCC take TreeOptions() as a default argument inside this class
+
+        size_t collapseOver = 0; // a folder with more visible entries than this gets "… 4,213 files (*.png 3,900, ...)"
+                                 // for its files, and its folders too if there are more of them; 0 lists everything
+        unsigned maxDepth = 0;   // folders at this depth show their file count instead of their contents; 0 for no limit
+    };
+
+    // "MyGame/" followed by one "├── name" line per visible entry, collapsed folders included
+    static std::string FormatTree(const ProjectModel& model, const ProjectFilter& filter, const TreeOptions& tree = TreeOptions());
+    static std::string FormatSectionHeader(std::string_view title);
+    // One line per file type that comments were stripped from, most saved first, then the total:
+    // "  .gd            812 files  1,204,388 -> 1,003,120 bytes  (-16.7%)"
+    static std::string FormatSavings(const FileTypeRegistry& fileTypes, const std::vector<CommentStripper::Savings>& savings);
+    static std::vector<ExportPipeline::Item> CollectItems(const ProjectModel& model, const ProjectFilter& filter);
+
+    // Writes everything to an opened writer, which the caller commits. If manifest is given, it is filled with
+    // what was written, for a later WriteChanges.
+    static Summary Write(const ProjectModel& model, const ProjectFilter& filter, ExportWriter& writer,
+                         const ExportPipeline::Options& options = ExportPipeline::Options(), ExportManifest* manifest = nullptr,
+                         const TreeOptions& tree = TreeOptions());
+
+    // Writes what changed since the export that previous was saved with, and fills current for the next one.
+    // Files whose size and modification time match previous are taken as unchanged without being read.
+    static Summary WriteChanges(const ProjectModel& model, const ProjectFilter& filter, ExportWriter& writer,
+                                const ExportManifest& previous, ExportManifest& current,
+                                const ExportPipeline::Options& options = ExportPipeline::Options(),
+                                const TreeOptions& tree = TreeOptions());
+
+private:
+    enum class FileChange : uint8_t { Unchanged, Added, Modified };
+
+    // Size and modification time of every item; with previous, also whether it changed
+    static void ReadStamps(const std::vector<ExportPipeline::Item>& items, const ExportManifest* previous,
+                           std::vector<ExportManifest::Entry>& entries, std::vector<FileChange>& changes,
+                           JobProgress* progress);
+    // Streamed into the writer as it is rendered, so a huge tree is never held whole
+    static void WriteTree(const ProjectModel& model, const ProjectFilter& filter, const TreeOptions& tree, ExportWriter& writer);
+    static void CollectItemsRecursive(const ProjectModel& model, const ProjectFilter& filter, uint32_t parent,
+                                      std::vector<ExportPipeline::Item>& items, std::string& relativeDir);
+};
@@ -0,0 +1,595 @@
+#include "CommentStripper.h"
+
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STRIPPER_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define STRIPPER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    // Per Syntax, the bytes that can open a comment or a string
+    const char* const kOpeners[7] = { "", "/\"'", "/\"'`", "/\"'", "/\"", "#\"'", "<" };
+
+    struct OpenerTables
+    {
+        bool table[7][256] = {};
+
+        OpenerTables()
+        {
+            for (int syntax = 0; syntax < 7; ++syntax)
+            {
+                for (const char* c = kOpeners[syntax]; *c; ++c)
+                    table[syntax][(unsigned char)*c] = true;
+            }
+        }
+    };
+    const OpenerTables kOpenerTables;
+
+    bool IsBlank(char c)
+    {
+        return c == ' ' || c == '\t';
+    }
+
+    // Offset of the first byte in data that plain copying cannot get past: an opener, or a newline
+    // that ends a blank line or follows trailing blanks. data[-1] must be readable. Most of a file is
+    // lines of code between such bytes, so they are searched 16 bytes at a time where the CPU allows.
+    size_t FindStop(const char* data, size_t size, int syntax)
+    {
+        size_t i = 0;
+#if defined(STRIPPER_SSE2)
+        const __m128i newline = _mm_set1_epi8('\n');
+        for (; i + 16 <= size; i += 16)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i before = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i - 1));
+            __m128i bad = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(before, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(before, _mm_set1_epi8('\t'))),
+                                       _mm_cmpeq_epi8(before, newline));
+            __m128i hits = _mm_and_si128(_mm_cmpeq_epi8(block, newline), bad);
+            for (const char* c = kOpeners[syntax]; *c; ++c)
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(*c)));
+            if (int mask = _mm_movemask_epi8(hits))
+            {
+#if defined(_MSC_VER)
+                unsigned long first;
+                _BitScanForward(&first, (unsigned long)mask);
+                return i + first;
+#else
+                return i + (size_t)__builtin_ctz((unsigned)mask);
+#endif
+            }
+        }
+#elif defined(STRIPPER_NEON)
+        const uint8x16_t newline = vdupq_n_u8('\n');
+        for (; i + 16 <= size; i += 16)
+        {
+            uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+            uint8x16_t before = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i - 1));
+            uint8x16_t bad = vorrq_u8(vorrq_u8(vceqq_u8(before, vdupq_n_u8(' ')), vceqq_u8(before, vdupq_n_u8('\t'))),
+                                      vceqq_u8(before, newline));
+            uint8x16_t hits = vandq_u8(vceqq_u8(block, newline), bad);
+            for (const char* c = kOpeners[syntax]; *c; ++c)
+                hits = vorrq_u8(hits, vceqq_u8(block, vdupq_n_u8((uint8_t)*c)));
+            if (vmaxvq_u8(hits) != 0)
+                break;
+        }
+#endif
+        const bool* openers = kOpenerTables.table[syntax];
+        for (; i < size; ++i)
+        {
+            char c = data[i];
+            if (openers[(unsigned char)c] || (c == '\n' && (IsBlank(data[i - 1]) || data[i - 1] == '\n')))
+                break;
+        }
+        return i;
+    }
+
+    const char kMarkupOpen[] = "<!--";
+
+    bool IsIdentifierByte(unsigned char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+    }
+}
+
+CommentStripper::Syntax CommentStripper::FromLexer(std::string_view lexer)
+{
+    if (lexer == "cpp")
+        return Syntax::C;
+    if (lexer == "javascript")
+        return Syntax::JavaScript;
+    if (lexer == "css")
+        return Syntax::Css;
+    if (lexer == "json")
+        return Syntax::Json;
+    if (lexer == "python")
+        return Syntax::Hash;
+    if (lexer == "html" || lexer == "xml")
+        return Syntax::Markup;
+    return Syntax::None;
+}
+
+void CommentStripper::Feed(const char* data, size_t size, std::string& output)
+{
+    const size_t start = output.size();
+    const bool* openers = kOpenerTables.table[(int)m_syntax];
+
+    // Every state either consumes bytes or switches to a state that will; a byte that
+    // ends a state without belonging to it (the newline after a line comment) is read again
+    size_t i = 0;
+    while (i < size)
+    {
+        const char c = data[i];
+        switch (m_state)
+        {
+            case State::Code:
+            {
+                // A run of code, possibly over many lines, up to where a comment, a string or a blank line may start
+                if (c != '\n' && !openers[(unsigned char)c])
+                {
+                    size_t end = i + 1 + FindStop(data + i + 1, size - i - 1, (int)m_syntax);
+                    AppendCode(data + i, end - i, output);
+                    i = end;
+                    break;
+                }
+
+                ++i;
+                if (c == '\n')
+                {
+                    EndLine(output);
+                }
+                else if (c == '/')
+                {
+                    m_regexAllowed = m_syntax == Syntax::JavaScript && AllowsRegex();
+                    m_state = State::Slash;
+                }
+                else if (c == '#')
+                {
+                    m_state = State::LineComment;
+                }
+                else if (c == '<')
+                {
+                    m_count = 1;
+                    m_state = State::MarkupOpen;
+                }
+                else
+                {
+                    OpenQuote(c, output);
+                }
+                break;
+            }
+
+            case State::Slash:
+                if (c == '/' && m_syntax != Syntax::Css)
+                {
+                    ++i;
+                    m_state = State::LineComment;
+                }
+                else if (c == '*')
+                {
+                    ++i;
+                    m_star = false;
+                    m_state = State::BlockComment;
+                }
+                else
+                {
+                    AppendCode("/", 1, output);
+                    m_escape = false;
+                    m_regexClass = false;
+                    m_state = m_regexAllowed ? State::Regex : State::Code;
+                }
+                break;
+
+            case State::LineComment:
+            {
+                // The newline is left to Code, which decides whether the line is kept
+                const void* newline = std::memchr(data + i, '\n', size - i);
+                if (newline)
+                {
+                    i = (const char*)newline - data;
+                    m_state = State::Code;
+                }
+                else
+                {
+                    i = size;
+                }
+                break;
+            }
+
+            case State::BlockComment:
+                while (i < size)
+                {
+                    if (m_star && data[i] == '/')
+                    {
+                        ++i;
+                        // Stands in for the comment, so "a/**/b" does not become "ab"; trimmed if the line ends here
+                        if (m_lineHasContent && m_blanks.empty())
+                            m_blanks = " ";
+                        m_state = State::Code;
+                        break;
+                    }
+                    if (data[i] == '*')
+                    {
+                        m_star = true;
+                        ++i;
+                        continue;
+                    }
+                    m_star = false;
+                    const void* star = std::memchr(data + i, '*', size - i);
+                    i = star ? (size_t)((const char*)star - data) : size;
+                }
+                break;
+
+            case State::String:
+            {
+                size_t end = i;
+                for (; end < size; ++end)
+                {
+                    char b = data[end];
+                    if (m_escape)
+                        m_escape = false;
+                    else if (b == '\\')
+                        m_escape = true;
+                    else if (b == m_quote)
+                    {
+                        ++end;
+                        m_state = State::Code;
+                        break;
+                    }
+                    else if (b == '\n')
+                    {
+                        // Unterminated: the string ends with the line, so a misread quote costs one line at most
+                        m_state = State::Code;
+                        break;
+                    }
+                }
+                Append(data + i, end - i, output);
+                i = end;
+                break;
+            }
+
+            case State::Quotes:
+                if (c == m_quote)
+                {
+                    ++i;
+                    Put(c, output);
+                    if (++m_count == 3)
+                    {
+                        m_count = 0;
+                        m_state = State::TripleString;
+                    }
+                }
+                else
+                {
+                    // One quote opened a string; two were an empty one
+                    m_state = m_count == 1 ? State::String : State::Code;
+                }
+                break;
+
+            case State::TripleString:
+            {
+                size_t end = i;
+                for (; end < size; ++end)
+                {
+                    char b = data[end];
+                    if (m_escape)
+                    {
+                        m_escape = false;
+                        m_count = 0;
+                    }
+                    else if (b == '\\')
+                    {
+                        m_escape = true;
+                        m_count = 0;
+                    }
+                    else if (b != m_quote)
+                    {
+                        m_count = 0;
+                    }
+                    else if (++m_count == 3)
+                    {
+                        ++end;
+                        m_state = State::Code;
+                        break;
+                    }
+                }
+                Append(data + i, end - i, output);
+                i = end;
+                break;
+            }
+
+            case State::Template:
+            {
+                size_t end = i;
+                for (; end < size; ++end)
+                {
+                    char b = data[end];
+                    if (m_escape)
+                        m_escape = false;
+                    else if (b == '\\')
+                        m_escape = true;
+                    else if (b == '`')
+                    {
+                        ++end;
+                        m_state = State::Code;
+                        break;
+                    }
+                }
+                Append(data + i, end - i, output);
+                i = end;
+                break;
+            }
+
+            case State::Verbatim:
+            {
+                const void* quote = std::memchr(data + i, '"', size - i);
+                size_t end = quote ? (size_t)((const char*)quote - data) + 1 : size;
+                Append(data + i, end - i, output);
+                i = end;
+                if (quote)
+                    m_state = State::VerbatimQuote;
+                break;
+            }
+
+            case State::VerbatimQuote:
+                // "" is a quote inside the string; anything else follows the closing one
+                if (c == '"')
+                {
+                    ++i;
+                    Put(c, output);
+                    m_state = State::Verbatim;
+                }
+                else
+                {
+                    m_state = State::Code;
+                }
+                break;
+
+            case State::RawDelimiter:
+                if (c == '(')
+                {
+                    ++i;
+                    Put(c, output);
+                    m_count = 0;
+                    m_state = State::RawString;
+                }
+                else if (m_delimiter.size() < 16 && c != ')' && c != '\\' && c != '"' && !IsBlank(c) && c != '\n')
+                {
+                    ++i;
+                    Put(c, output);
+                    m_delimiter += c;
+                }
+                else
+                {
+                    // Not a raw string after all (R was the end of a macro name, say)
+                    m_escape = false;
+                    m_state = State::String;
+                }
+                break;
+
+            case State::RawString:
+            {
+                // m_count bytes of ')' + delimiter + '"' matched so far
+                const size_t closingSize = m_delimiter.size() + 2;
+                size_t end = i;
+                for (; end < size; ++end)
+                {
+                    char b = data[end];
+                    if (m_count > 0)
+                    {
+                        char expected = m_count <= m_delimiter.size() ? m_delimiter[m_count - 1] : '"';
+                        if (b == expected)
+                        {
+                            if (++m_count == closingSize)
+                            {
+                                ++end;
+                                m_state = State::Code;
+                                break;
+                            }
+                            continue;
+                        }
+                    }
+                    m_count = b == ')' ? 1 : 0;
+                }
+                Append(data + i, end - i, output);
+                i = end;
+                break;
+            }
+
+            case State::Regex:
+            {
+                size_t end = i;
+                for (; end < size; ++end)
+                {
+                    char b = data[end];
+                    if (m_escape)
+                        m_escape = false;
+                    else if (b == '\\')
+                        m_escape = true;
+                    else if (b == '\n')
+                    {
+                        m_state = State::Code;
+                        break;
+                    }
+                    else if (m_regexClass)
+                        m_regexClass = b != ']';
+                    else if (b == '[')
+                        m_regexClass = true;
+                    else if (b == '/')
+                    {
+                        ++end;
+                        m_state = State::Code;
+                        break;
+                    }
+                }
+                Append(data + i, end - i, output);
+                i = end;
+                break;
+            }
+
+            case State::MarkupOpen:
+                if (c == kMarkupOpen[m_count])
+                {
+                    ++i;
+                    if (++m_count == 4)
+                    {
+                        m_count = 0;
+                        m_state = State::MarkupComment;
+                    }
+                }
+                else
+                {
+                    AppendCode(kMarkupOpen, m_count, output);
+                    m_state = State::Code;
+                }
+                break;
+
+            case State::MarkupComment:
+                // m_count: dashes in a row so far
+                for (; i < size; ++i)
+                {
+                    char b = data[i];
+                    if (b == '>' && m_count >= 2)
+                    {
+                        ++i;
+                        m_state = State::Code;
+                        break;
+                    }
+                    m_count = b == '-' ? m_count + 1 : 0;
+                }
+                break;
+        }
+    }
+
+    m_bytesIn += size;
+    m_bytesOut += output.size() - start;
+}
+
+void CommentStripper::Finish(std::string& output)
+{
+    const size_t start = output.size();
+
+    // Held back in case they started a comment, and they did not
+    if (m_state == State::Slash)
+        AppendCode("/", 1, output);
+    else if (m_state == State::MarkupOpen)
+        AppendCode(kMarkupOpen, m_count, output);
+    EndLine(output);
+    m_state = State::Code;
+
+    m_bytesOut += output.size() - start;
+}
+
+void CommentStripper::AppendCode(const char* data, size_t size, std::string& output)
+{
+    // Trailing blanks wait for the rest of the line: dropped at its end, written before anything else
+    size_t kept = size;
+    while (kept > 0 && IsBlank(data[kept - 1]))
+        --kept;
+    if (kept > 0)
+    {
+        if (!m_blanks.empty())
+        {
+            Append(m_blanks.data(), m_blanks.size(), output);
+            m_blanks.clear();
+        }
+        Append(data, kept, output);
+        // Runs can span lines; only what follows their last newline is on the current one
+        m_lineHasContent = data[kept - 1] != '\n';
+    }
+    if (kept < size)
+        m_blanks.append(data + kept, size - kept);
+}
+
+void CommentStripper::Append(const char* data, size_t size, std::string& output)
+{
+    if (size == 0)
+        return;
+    output.append(data, size);
+    for (size_t k = size > 4 ? size - 4 : 0; k < size; ++k)
+        m_recent = m_recent << 8 | (unsigned char)data[k];
+    for (size_t k = size; k > 0; --k)
+    {
+        if (!IsBlank(data[k - 1]) && data[k - 1] != '\n')
+        {
+            m_lastCode = data[k - 1];
+            break;
+        }
+    }
+}
+
+void CommentStripper::EndLine(std::string& output)
+{
+    m_blanks.clear();
+    if (m_lineHasContent)
+    {
+        output += '\n';
+        m_lineHasContent = false;
+    }
+    m_recent = m_recent << 8 | '\n';
+}
+
+void CommentStripper::OpenQuote(char quote, std::string& output)
+{
+    // In C++14 a quote right after a digit separates digits (1'000'000)
+    if (quote == '\'' && m_syntax == Syntax::C && m_blanks.empty() && (m_recent & 0xFF) >= '0' && (m_recent & 0xFF) <= '9')
+    {
+        AppendCode(&quote, 1, output);
+        return;
+    }
+
+    // Prefixes are only prefixes when nothing separates them from the quote
+    bool adjacent = m_blanks.empty() && m_lineHasContent;
+    bool raw = quote == '"' && m_syntax == Syntax::C && adjacent && FollowsRawPrefix();
+    bool verbatim = quote == '"' && m_syntax == Syntax::C && adjacent &&
+                    ((m_recent & 0xFF) == '@' || (m_recent & 0xFFFF) == ('@' << 8 | '$'));
+
+    AppendCode(&quote, 1, output);
+    m_quote = quote;
+    m_escape = false;
+    if (m_syntax == Syntax::Hash)
+    {
+        m_count = 1;
+        m_state = State::Quotes;
+    }
+    else if (quote == '`')
+    {
+        m_state = State::Template;
+    }
+    else if (raw)
+    {
+        m_delimiter.clear();
+        m_state = State::RawDelimiter;
+    }
+    else
+    {
+        m_state = verbatim ? State::Verbatim : State::String;
+    }
+}
+
+bool CommentStripper::FollowsRawPrefix() const
+{
+    // R, LR, uR, UR or u8R, not preceded by more of an identifier
+    unsigned char b0 = m_recent & 0xFF, b1 = (m_recent >> 8) & 0xFF, b2 = (m_recent >> 16) & 0xFF, b3 = m_recent >> 24;
+    if (b0 != 'R')
+        return false;
+    if (!IsIdentifierByte(b1))
+        return true;
+    if ((b1 == 'L' || b1 == 'u' || b1 == 'U') && !IsIdentifierByte(b2))
+        return true;
+    return b1 == '8' && b2 == 'u' && !IsIdentifierByte(b3);
+}
+
+bool CommentStripper::AllowsRegex() const
+{
+    // After an operator or an opening bracket a '/' starts a regex; after a value it divides
+    return m_lastCode == 0 || std::strchr("(,=:[!&|?{};+-*%<>~^", m_lastCode) != nullptr;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Shrinks normalized source text (see TextNormalizer) for an export: comments
+// are dropped, trailing blanks are trimmed and lines left empty disappear.
+// Indentation stays, so Python and GDScript keep their meaning, and so does
+// everything inside string literals. One pass, usable on a whole file or chunk
+// by chunk with the same result wherever the chunks are split. Plain code is
+// copied in runs, many lines at a time, up to the next byte that can start a
+// comment or a string or that ends a blank line.
+//
+// The syntax comes from the file type's lexer:
+//   C        // and /* */; "..." and '...', C++ raw strings, C# verbatim strings
+//   JavaScript  as C, plus `...` templates and /regex/ literals
+//   Css      /* */ only (// is part of unquoted urls); "..." and '...'
+//   Json     // and /* */, as tolerated in tsconfig.json and friends; "..."
+//   Hash     # (Python, GDScript); '...', "..." and triple-quoted strings
+//   Markup   <!-- --> (HTML, XML); quotes are not tracked, they are text
+// It is a tokenizer, not a parser: a construct it misreads (a regex after
+// "return", a digit separator in a hex literal) can only keep a comment on
+// that line, since single-line strings always end at the line's end.
+class CommentStripper
+{
+public:
+    enum class Syntax : uint8_t { None, C, JavaScript, Css, Json, Hash, Markup };
+
+    // What stripping did to the files of one type, for the report
+    struct Savings
+    {
+        size_t files = 0;
+        uint64_t bytesIn = 0;
+        uint64_t bytesOut = 0;
+    };
+
+    // None for lexers without a known comment syntax (markdown, or none at all)
+    static Syntax FromLexer(std::string_view lexer);
+
+    explicit CommentStripper(Syntax syntax) : m_syntax(syntax) {}
+
+    // Appends the stripped form of the next piece of text to output
+    void Feed(const char* data, size_t size, std::string& output);
+    // Call once after the last piece
+    void Finish(std::string& output);
+
+    uint64_t GetBytesIn() const { return m_bytesIn; }
+    uint64_t GetBytesOut() const { return m_bytesOut; }
+
+private:
+    enum class State : uint8_t
+    {
+        Code,
+        Slash,        // a '/' that may start a comment
+        LineComment,
+        BlockComment,
+        String,       // ends at m_quote or at the end of the line
+        Quotes,       // Hash: m_count opening quotes so far, maybe a triple-quoted string
+        TripleString,
+        Template,
+        Verbatim,     // C# @"...", where "" is an escaped quote
+        VerbatimQuote,
+        RawDelimiter, // C++ R"delimiter(
+        RawString,
+        Regex,
+        MarkupOpen,   // m_count bytes of "<!--" so far
+        MarkupComment,
+    };
+
+    void AppendCode(const char* data, size_t size, std::string& output);
+    void Append(const char* data, size_t size, std::string& output);
+    void Put(char c, std::string& output) { Append(&c, 1, output); }
+    void EndLine(std::string& output);
+    void OpenQuote(char quote, std::string& output);
+    bool FollowsRawPrefix() const;
+    bool AllowsRegex() const;
+
+    Syntax m_syntax;
+    State m_state = State::Code;
+    char m_quote = 0;
+    bool m_escape = false;       // the last byte in a string was an unescaped backslash
+    bool m_star = false;         // BlockComment: the last byte was '*'
+    bool m_regexAllowed = false; // Slash: a '/' here would start a regex, not divide
+    bool m_regexClass = false;   // Regex: inside [...]
+    bool m_lineHasContent = false;
+    unsigned m_count = 0;
+    char m_lastCode = 0;         // the last non-blank byte of code, for telling a regex from a division
+    uint32_t m_recent = 0;       // the last four bytes written, newest in the low byte
+    std::string m_blanks;        // held back until something follows them on the line
+    std::string m_delimiter;     // of the raw string being read
+    uint64_t m_bytesIn = 0;
+    uint64_t m_bytesOut = 0;
+};
@@ -0,0 +1,51 @@
+#include "ContentHash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+
+uint64_t ContentHash::Hash(const char* data, size_t size, uint64_t seed)
+{
+    const uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+    uint64_t hash = seed;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = ((hash << 23 | hash >> 41) ^ word) * multiplier;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    hash = ((hash << 23 | hash >> 41) ^ tail ^ ((uint64_t)(size - i) << 56)) * multiplier;
+    return hash ^ (hash >> 29);
+}
+
+uint64_t ContentHash::HashContents(const char* data, size_t size)
+{
+    uint64_t hash = 0;
+    for (size_t offset = 0; offset < size; offset += kChunkSize)
+        hash = Hash(data + offset, std::min(kChunkSize, size - offset), hash);
+    return hash;
+}
+
+bool ContentHash::HashStream(std::istream& stream, uint64_t& hash, uint64_t& size)
+{
+    std::string chunk(kChunkSize, '\0');
+    hash = 0;
+    size = 0;
+    while (stream.read(&chunk[0], (std::streamsize)chunk.size()) || stream.gcount() > 0)
+    {
+        hash = Hash(chunk.data(), (size_t)stream.gcount(), hash);
+        size += (uint64_t)stream.gcount();
+    }
+    return !stream.bad();
+}
+
+bool ContentHash::HashFile(const std::string& path, uint64_t& hash, uint64_t& size)
+{
+    std::ifstream file(std::filesystem::u8path(path), std::ios::binary);
+    return file && HashStream(file, hash, size);
+}
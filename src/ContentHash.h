@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+// A fast 64-bit hash of file contents, eight bytes per step. Not
+// cryptographic: it tells contents apart for caches, duplicate detection and
+// export manifests, nothing more.
+class ContentHash
+{
+public:
+    static constexpr size_t kChunkSize = 256 * 1024;
+
+    // Longer contents can be hashed in pieces by passing the previous result as
+    // seed. That gives a different value than hashing them in one call, so one
+    // use must stick to one way of splitting.
+    static uint64_t Hash(const char* data, size_t size, uint64_t seed = 0);
+
+    // The hash of a whole file: Hash chained over kChunkSize pieces, so a file
+    // held in memory and one read from disk in chunks give the same value
+    static uint64_t HashContents(const char* data, size_t size);
+    static bool HashStream(std::istream& stream, uint64_t& hash, uint64_t& size);
+    static bool HashFile(const std::string& path, uint64_t& hash, uint64_t& size);
+};
@@ -0,0 +1,100 @@
+#include "ContentSniffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SNIFFER_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SNIFFER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    // Tab, line feed, form feed, carriage return and escape (ANSI colours) are fine in text
+    bool IsSuspiciousControl(unsigned char byte)
+    {
+        return byte < 0x20 && byte != '\t' && byte != '\n' && byte != '\f' && byte != '\r' && byte != 0x1B;
+    }
+
+    unsigned PopCount16(unsigned mask)
+    {
+        mask = mask - ((mask >> 1) & 0x5555);
+        mask = (mask & 0x3333) + ((mask >> 2) & 0x3333);
+        mask = (mask + (mask >> 4)) & 0x0F0F;
+        return (mask + (mask >> 8)) & 0x1F;
+    }
+}
+
+bool ContentSniffer::IsBinary(const char* data, size_t size)
+{
+    size = std::min(size, kBlockSize);
+
+    // A UTF-16 byte order mark: the NULs that follow are part of the text
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    if (size >= 2 && ((bytes[0] == 0xFF && bytes[1] == 0xFE) || (bytes[0] == 0xFE && bytes[1] == 0xFF)))
+        return false;
+
+    size_t suspicious = 0;
+    size_t i = 0;
+
+#if defined(SNIFFER_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i maxControl = _mm_set1_epi8(0x1F);
+    const __m128i tab = _mm_set1_epi8('\t'), lf = _mm_set1_epi8('\n'), ff = _mm_set1_epi8('\f');
+    const __m128i cr = _mm_set1_epi8('\r'), esc = _mm_set1_epi8(0x1B);
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)))
+            return true;
+
+        // Unsigned v <= 0x1F, minus the whitespace that belongs in text
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(v, maxControl), v);
+        __m128i allowed = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(v, lf)),
+                                       _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, ff), _mm_cmpeq_epi8(v, cr)),
+                                                    _mm_cmpeq_epi8(v, esc)));
+        suspicious += PopCount16((unsigned)_mm_movemask_epi8(_mm_andnot_si128(allowed, control)));
+    }
+#elif defined(SNIFFER_NEON)
+    const uint8x16_t maxControl = vdupq_n_u8(0x1F);
+    for (; i + 16 <= size; i += 16)
+    {
+        uint8x16_t v = vld1q_u8(bytes + i);
+        if (vmaxvq_u8(vceqq_u8(v, vdupq_n_u8(0))))
+            return true;
+
+        uint8x16_t control = vcleq_u8(v, maxControl);
+        uint8x16_t allowed = vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8('\t')), vceqq_u8(v, vdupq_n_u8('\n'))),
+                                      vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8('\f')), vceqq_u8(v, vdupq_n_u8('\r'))),
+                                               vceqq_u8(v, vdupq_n_u8(0x1B))));
+        suspicious += vaddvq_u8(vandq_u8(vbicq_u8(control, allowed), vdupq_n_u8(1)));
+    }
+#endif
+
+    for (; i < size; ++i)
+    {
+        if (bytes[i] == 0)
+            return true;
+        suspicious += IsSuspiciousControl(bytes[i]);
+    }
+
+    // More than one byte in ten
+    return suspicious * 10 > size;
+}
+
+ContentKind ContentSniffer::SniffFile(const std::string& path)
+{
+    std::ifstream file(std::filesystem::u8path(path), std::ios::binary);
+    if (!file)
+        return ContentKind::Unknown;
+
+    char block[kBlockSize];
+    file.read(block, sizeof(block));
+    return IsBinary(block, (size_t)file.gcount()) ? ContentKind::Binary : ContentKind::Text;
+}
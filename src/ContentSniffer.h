@@ -0,0 +1,25 @@
+#pragma once
+
+#include "ProjectModel.h"
+
+#include <cstddef>
+#include <string>
+
+// Tells text from binary content by looking at the first block of a file:
+// any NUL byte, or too many control characters other than whitespace, means
+// binary. The block is scanned 16 bytes at a time (SSE2 or NEON where
+// available), so sniffing costs little more than the read itself.
+class ContentSniffer
+{
+public:
+    static constexpr size_t kBlockSize = 8192;
+
+    // Looks at no more than the first kBlockSize bytes
+    static bool IsBinary(const char* data, size_t size);
+
+    // Unknown if the file cannot be read
+    static ContentKind SniffFile(const std::string& path);
+
+    // Written instead of the contents of a binary file, in the export and in the preview
+    static const char* GetPlaceholder() { return "(binary file, contents omitted)\n"; }
+};
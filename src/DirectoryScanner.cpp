@@ -0,0 +1,456 @@
+#include "DirectoryScanner.h"
+#include "ContentSniffer.h"
+
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <chrono>
+#include <system_error>
+#endif
+
+namespace
+{
+#ifdef __linux__
+    int64_t ToNanoseconds(const struct stat& st)
+    {
+        return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    }
+
+    int64_t ReadModificationTime(const std::string& path)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            return -1;
+        return ToNanoseconds(st);
+    }
+
+    struct LinuxDirent64
+    {
+        ino64_t d_ino;
+        off64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+
+    // Reads entries straight from getdents64 so the file type comes with the
+    // directory read. Only entries the filesystem reports as DT_UNKNOWN (some
+    // NFS/FUSE mounts) or symlinks cost an extra fstatat.
+    // Returns the directory's modification time, or -1 if it could not be read.
+    template <typename Callback>
+    int64_t ForEachEntry(const std::string& path, Callback&& callback)
+    {
+        int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0)
+            return -1;
+
+        struct stat dirStat;
+        int64_t mtime = fstat(fd, &dirStat) == 0 ? ToNanoseconds(dirStat) : 0;
+
+        thread_local std::vector<char> buffer(256 * 1024);
+        for (;;)
+        {
+            long bytes = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+            if (bytes <= 0)
+                break;
+
+            for (long offset = 0; offset < bytes;)
+            {
+                const LinuxDirent64* entry = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+                offset += entry->d_reclen;
+
+                const char* name = entry->d_name;
+                if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                    continue;
+
+                bool isDir = entry->d_type == DT_DIR;
+                if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+                {
+                    struct stat st;
+                    if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                        continue;
+                    // Symlinked directories are not followed: they can form cycles
+                    if (S_ISLNK(st.st_mode) && fstatat(fd, name, &st, 0) == 0 && S_ISDIR(st.st_mode))
+                        continue;
+                    isDir = S_ISDIR(st.st_mode);
+                }
+
+                callback(std::string(name), isDir);
+            }
+        }
+        close(fd);
+        return mtime;
+    }
+#else
+    namespace fs = std::filesystem;
+
+    int64_t ReadModificationTime(const std::string& path)
+    {
+        std::error_code ec;
+        fs::file_time_type time = fs::last_write_time(fs::u8path(path), ec);
+        if (ec)
+            return -1;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    template <typename Callback>
+    int64_t ForEachEntry(const std::string& path, Callback&& callback)
+    {
+        int64_t mtime = ReadModificationTime(path);
+        std::error_code ec;
+        fs::directory_iterator it(fs::u8path(path), fs::directory_options::skip_permission_denied, ec);
+        if (ec)
+            return -1;
+        for (fs::directory_iterator end; !ec && it != end; it.increment(ec))
+        {
+            std::error_code typeEc;
+            bool isDir = it->is_directory(typeEc);
+
+            // Symlinked directories are not followed: they can form cycles
+            if (isDir && it->is_symlink(typeEc))
+                continue;
+
+            callback(it->path().filename().u8string(), isDir);
+        }
+        return mtime;
+    }
+#endif
+}
+
+// Per-directory scan result. Each one is filled by exactly one task, so no
+// locking is needed; the tree of these is flattened into the model at the end.
+struct DirectoryScanner::PendingDir
+{
+    struct Entry
+    {
+        std::string name;
+        bool isDir;
+        std::unique_ptr<PendingDir> subdir;
+    };
+
+    std::string relativePath;
+    std::string fullPath;
+    std::vector<Entry> entries;
+    int64_t mtime = 0;
+    std::shared_ptr<const IgnoreScope> ignoreScope; // inherited, then replaced if the directory has its own rules
+};
+
+struct DirectoryScanner::PendingScan
+{
+    uint32_t dirIndex;
+    bool isRoot;
+    bool refresh; // root.entries only, merged into the existing ones
+    PendingDir root;
+};
+
+DirectoryScanner::DirectoryScanner(unsigned threadCount)
+    : m_pool(threadCount)
+{
+}
+
+ProjectModel DirectoryScanner::Scan(const std::string& rootPath)
+{
+    ProjectModel model(rootPath);
+    if (m_progress)
+        m_progress->StartPhase("Scanning");
+    ScanInto(model, model.GetRoot());
+    return model;
+}
+
+void DirectoryScanner::ScanInto(ProjectModel& model, uint32_t dirIndex)
+{
+    std::shared_ptr<PendingScan> scan = BeginScan(model, dirIndex);
+    ReadScan(*scan);
+    EndScan(model, *scan);
+}
+
+std::shared_ptr<DirectoryScanner::PendingScan> DirectoryScanner::BeginScan(const ProjectModel& model, uint32_t dirIndex, bool refresh) const
+{
+    auto scan = std::make_shared<PendingScan>();
+    scan->dirIndex = dirIndex;
+    scan->isRoot = dirIndex == model.GetRoot();
+    scan->refresh = refresh;
+    scan->root.relativePath = model.GetRelativePath(dirIndex);
+    scan->root.fullPath = model.GetFullPath(dirIndex);
+    if (!scan->isRoot)
+        scan->root.ignoreScope = model.GetNode(model.GetNode(dirIndex).parent).ignoreScope;
+    return scan;
+}
+
+void DirectoryScanner::ReadScan(PendingScan& scan)
+{
+    if (scan.refresh)
+    {
+        PendingDir& dir = scan.root;
+        if (m_progress && m_progress->IsCancelled())
+            return;
+        dir.mtime = ForEachEntry(dir.fullPath, [&dir](std::string name, bool isDir) {
+            dir.entries.push_back(PendingDir::Entry{ std::move(name), isDir, nullptr });
+        });
+        std::sort(dir.entries.begin(), dir.entries.end(),
+                  [](const PendingDir::Entry& a, const PendingDir::Entry& b) { return a.name < b.name; });
+        if (m_progress)
+            m_progress->Add(std::count_if(dir.entries.begin(), dir.entries.end(), [](const PendingDir::Entry& entry) { return !entry.isDir; }));
+        return;
+    }
+
+    if (scan.isRoot)
+        scan.root.ignoreScope = LoadIgnoreFile(scan.root.fullPath + "/.git/info/exclude", std::string(), nullptr);
+    PendingDir* root = &scan.root;
+    m_pool.Submit([this, root] { ScanDirectory(root); });
+    m_pool.Wait();
+}
+
+void DirectoryScanner::EndScan(ProjectModel& model, const PendingScan& scan) const
+{
+    const ProjectNode& node = model.GetNode(scan.dirIndex);
+    if (!scan.isRoot && node.parent == ProjectModel::npos)
+        return;
+    if (scan.refresh)
+    {
+        MergeEntries(model, scan);
+        return;
+    }
+    model.ClearChildren(scan.dirIndex);
+
+    // Flatten breadth-first so siblings end up next to each other in the node table
+    std::deque<std::pair<const PendingDir*, uint32_t>> queue;
+    queue.emplace_back(&scan.root, scan.dirIndex);
+    while (!queue.empty())
+    {
+        const PendingDir* dir = queue.front().first;
+        uint32_t parent = queue.front().second;
+        queue.pop_front();
+
+        model.MarkScanned(parent);
+        model.SetIgnoreScope(parent, dir->ignoreScope);
+        model.SetModificationTime(parent, dir->mtime);
+        for (const PendingDir::Entry& entry : dir->entries)
+        {
+            uint32_t index = model.AddNode(parent, entry.name, entry.isDir);
+            if (entry.subdir)
+                queue.emplace_back(entry.subdir.get(), index);
+        }
+    }
+}
+
+void DirectoryScanner::Refresh(ProjectModel& model, uint32_t dirIndex)
+{
+    std::shared_ptr<PendingScan> scan = BeginScan(model, dirIndex, true);
+    ReadScan(*scan);
+    EndScan(model, *scan);
+}
+
+void DirectoryScanner::MergeEntries(ProjectModel& model, const PendingScan& scan) const
+{
+    const std::vector<PendingDir::Entry>& entries = scan.root.entries;
+    uint32_t dirIndex = scan.dirIndex;
+    if (scan.root.mtime < 0 || !model.GetNode(dirIndex).scanned)
+        return; // Gone, and the parent's refresh removes it; or cleared meanwhile, and read in full later
+
+    // A .gitignore appearing or disappearing changes the scopes of the whole subtree
+    auto isIgnoreFile = [](const PendingDir::Entry& entry) { return !entry.isDir && entry.name == ".gitignore"; };
+    bool hasIgnoreFile = std::any_of(entries.begin(), entries.end(), isIgnoreFile);
+    if (hasIgnoreFile != (model.FindChild(dirIndex, ".gitignore") != ProjectModel::npos))
+    {
+        model.ClearChildren(dirIndex);
+        return;
+    }
+
+    // Both lists are sorted by name: entries that are still there keep their nodes and subtrees
+    std::vector<uint32_t> children = model.GetNode(dirIndex).children;
+    size_t next = 0;
+    for (uint32_t child : children)
+    {
+        // Looked up on every use: InsertNode() may grow the node table
+        while (next < entries.size() && entries[next].name < model.GetNode(child).name)
+        {
+            model.InsertNode(dirIndex, entries[next].name, entries[next].isDir);
+            ++next;
+        }
+        if (next < entries.size() && entries[next].name == model.GetNode(child).name &&
+            entries[next].isDir == model.GetNode(child).isDir)
+        {
+            ++next;
+            continue;
+        }
+        model.RemoveNode(child);
+    }
+    for (; next < entries.size(); ++next)
+        model.InsertNode(dirIndex, entries[next].name, entries[next].isDir);
+
+    model.SetModificationTime(dirIndex, scan.root.mtime);
+}
+
+void DirectoryScanner::DetectContentKinds(ProjectModel& model, const std::vector<uint32_t>& files)
+{
+    std::vector<std::string> paths;
+    paths.reserve(files.size());
+    for (uint32_t index : files)
+        paths.push_back(model.GetFullPath(index));
+
+    std::vector<SniffedFile> sniffed = DetectContentKinds(paths);
+    for (size_t i = 0; i < files.size(); ++i)
+        model.SetContentKind(files[i], sniffed[i].content, sniffed[i].stamp);
+}
+
+std::vector<DirectoryScanner::SniffedFile> DirectoryScanner::DetectContentKinds(const std::vector<std::string>& paths)
+{
+    // Each task only writes its own slots
+    std::vector<SniffedFile> sniffed(paths.size());
+    if (m_progress)
+        m_progress->StartPhase("Checking file types", paths.size());
+    const size_t batchSize = 64;
+    for (size_t begin = 0; begin < paths.size(); begin += batchSize)
+    {
+        size_t end = std::min(begin + batchSize, paths.size());
+        m_pool.Submit([this, &paths, &sniffed, begin, end] {
+            if (m_progress && m_progress->IsCancelled())
+                return;
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (FileStamp::Read(paths[i], sniffed[i].stamp))
+                    sniffed[i].content = ContentSniffer::SniffFile(paths[i]);
+            }
+            if (m_progress)
+                m_progress->Add(end - begin);
+        });
+    }
+    m_pool.Wait();
+    return sniffed;
+}
+
+void DirectoryScanner::RestoreIgnoreScopes(ProjectModel& model) const
+{
+    // Parents come before their children in the node table, so scopes can be chained in one pass
+    for (uint32_t index = 0; index < model.GetNodeCount(); ++index)
+    {
+        const ProjectNode& node = model.GetNode(index);
+        if (!node.isDir || !node.scanned || (index != model.GetRoot() && node.parent == ProjectModel::npos))
+            continue;
+
+        std::shared_ptr<const IgnoreScope> scope;
+        if (index == model.GetRoot())
+            scope = LoadIgnoreFile(model.GetRootPath() + "/.git/info/exclude", std::string(), nullptr);
+        else
+            scope = model.GetNode(node.parent).ignoreScope;
+
+        uint32_t ignoreFile = model.FindChild(index, ".gitignore");
+        if (ignoreFile != ProjectModel::npos && !model.GetNode(ignoreFile).isDir)
+            scope = LoadIgnoreFile(model.GetFullPath(ignoreFile), model.GetRelativePath(index), std::move(scope));
+        model.SetIgnoreScope(index, std::move(scope));
+    }
+}
+
+std::vector<DirectoryScanner::DirectoryStamp> DirectoryScanner::GetDirectoryStamps(const ProjectModel& model)
+{
+    std::vector<DirectoryStamp> stamps;
+    for (uint32_t index = 0; index < model.GetNodeCount(); ++index)
+    {
+        const ProjectNode& node = model.GetNode(index);
+        if (node.isDir && node.scanned && (index == model.GetRoot() || node.parent != ProjectModel::npos))
+            stamps.push_back(DirectoryStamp{ index, model.GetFullPath(index), node.mtime });
+    }
+    return stamps;
+}
+
+std::vector<uint32_t> DirectoryScanner::FindChangedDirectories(const std::vector<DirectoryStamp>& stamps)
+{
+    std::vector<uint32_t> changed;
+    for (const DirectoryStamp& stamp : stamps)
+    {
+        if (ReadModificationTime(stamp.fullPath) != stamp.mtime)
+            changed.push_back(stamp.index);
+    }
+    return changed;
+}
+
+std::vector<DirectoryScanner::ContentStamp> DirectoryScanner::GetContentStamps(const ProjectModel& model)
+{
+    std::vector<ContentStamp> stamps;
+    for (uint32_t index = 0; index < model.GetNodeCount(); ++index)
+    {
+        const ProjectNode& node = model.GetNode(index);
+        if (!node.isDir && node.content != ContentKind::Unknown && node.parent != ProjectModel::npos)
+            stamps.push_back(ContentStamp{ index, model.GetFullPath(index), FileStamp{ node.size, node.mtime } });
+    }
+    return stamps;
+}
+
+std::vector<uint32_t> DirectoryScanner::FindChangedFiles(const std::vector<ContentStamp>& stamps)
+{
+    // A file that is gone counts as changed too; the refresh of its folder removes it
+    std::vector<uint32_t> changed;
+    for (const ContentStamp& stamp : stamps)
+    {
+        FileStamp current;
+        if (!FileStamp::Read(stamp.fullPath, current) || current != stamp.stamp)
+            changed.push_back(stamp.index);
+    }
+    return changed;
+}
+
+void DirectoryScanner::ScanDirectory(PendingDir* dir)
+{
+    // Queued directories are skipped once cancelled, so the pool drains quickly
+    if (m_progress && m_progress->IsCancelled())
+        return;
+
+    dir->mtime = ForEachEntry(dir->fullPath, [dir](std::string name, bool isDir) {
+        dir->entries.push_back(PendingDir::Entry{ std::move(name), isDir, nullptr });
+    });
+
+    std::sort(dir->entries.begin(), dir->entries.end(),
+              [](const PendingDir::Entry& a, const PendingDir::Entry& b) { return a.name < b.name; });
+    if (m_progress)
+        m_progress->Add(std::count_if(dir->entries.begin(), dir->entries.end(), [](const PendingDir::Entry& entry) { return !entry.isDir; }));
+
+    for (const PendingDir::Entry& entry : dir->entries)
+    {
+        if (!entry.isDir && entry.name == ".gitignore")
+            dir->ignoreScope = LoadIgnoreFile(dir->fullPath + "/.gitignore", dir->relativePath, dir->ignoreScope);
+    }
+
+    for (PendingDir::Entry& entry : dir->entries)
+    {
+        if (!entry.isDir)
+            continue;
+
+        std::string relativePath = dir->relativePath.empty() ? entry.name : dir->relativePath + '/' + entry.name;
+        if (m_descendFilter && !m_descendFilter(relativePath, entry.name, true, dir->ignoreScope.get()))
+            continue;
+
+        entry.subdir = std::make_unique<PendingDir>();
+        PendingDir* subdir = entry.subdir.get();
+        subdir->relativePath = std::move(relativePath);
+        subdir->fullPath = dir->fullPath + '/' + entry.name;
+        subdir->ignoreScope = dir->ignoreScope;
+        m_pool.Submit([this, subdir] { ScanDirectory(subdir); });
+    }
+}
+
+std::shared_ptr<const IgnoreScope> DirectoryScanner::LoadIgnoreFile(const std::string& filePath, const std::string& basePath,
+                                                                    std::shared_ptr<const IgnoreScope> parent) const
+{
+    std::ifstream file(std::filesystem::u8path(filePath), std::ios::binary);
+    if (!file)
+        return parent;
+
+    std::ostringstream text;
+    text << file.rdbuf();
+    IgnoreMatcher matcher = IgnoreMatcher::Compile(text.str());
+    if (matcher.IsEmpty())
+        return parent;
+
+    return std::make_shared<const IgnoreScope>(IgnoreScope{ std::move(parent), basePath, std::move(matcher) });
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "FileStamp.h"
+#include "IgnoreMatcher.h"
+#include "JobProgress.h"
+#include "ProjectModel.h"
+#include "ThreadPool.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Walks a directory tree in parallel on a work-stealing pool and returns the
+// result as a ProjectModel. Children are sorted by name in every directory, so
+// the output is identical regardless of the number of threads.
+//
+// Every entry is recorded. The descend filter only decides which directories
+// are read: a rejected directory is kept as an unscanned node and can be
+// filled in later with ScanInto() if the settings change.
+//
+// .gitignore files are picked up during the walk (plus .git/info/exclude at
+// the root), compiled once per directory and attached to the model as scopes.
+//
+// With a JobProgress set, Scan() and DetectContentKinds() report the files
+// they got through and stop early once it is cancelled, leaving an incomplete
+// model that the caller is expected to throw away.
+class DirectoryScanner
+{
+public:
+    // A scanned directory and the modification time its entries were read at
+    struct DirectoryStamp
+    {
+        uint32_t index;
+        std::string fullPath;
+        int64_t mtime;
+    };
+
+    // A sniffed file and the size and modification time its content kind was taken at
+    struct ContentStamp
+    {
+        uint32_t index;
+        std::string fullPath;
+        FileStamp stamp;
+    };
+
+    // What sniffing found; the stamp is read before the file, so a write during the read shows up as a change
+    struct SniffedFile
+    {
+        ContentKind content = ContentKind::Unknown;
+        FileStamp stamp;
+    };
+
+    explicit DirectoryScanner(unsigned threadCount = 0);
+
+    void SetDescendFilter(EntryFilter filter) { m_descendFilter = std::move(filter); }
+    void SetProgress(JobProgress* progress) { m_progress = progress; }
+
+    ProjectModel Scan(const std::string& rootPath);
+
+    // Reads an unscanned directory of an existing model and appends its subtree
+    void ScanInto(ProjectModel& model, uint32_t dirIndex);
+
+    // ScanInto() in three steps, so the reading can run on another thread than the one
+    // owning the model: BeginScan() and EndScan() run on that thread, ReadScan() anywhere.
+    // EndScan() replaces whatever the directory holds by then, unless it was removed meanwhile.
+    // With refresh set it is Refresh() instead: only the directory's own entries are read.
+    struct PendingScan;
+    std::shared_ptr<PendingScan> BeginScan(const ProjectModel& model, uint32_t dirIndex, bool refresh = false) const;
+    void ReadScan(PendingScan& scan);
+    void EndScan(ProjectModel& model, const PendingScan& scan) const;
+
+    // Re-reads the entries of one scanned directory and merges them into the model.
+    // Entries that are still there keep their nodes, subtrees included.
+    void Refresh(ProjectModel& model, uint32_t dirIndex);
+
+    // Sniffs the first block of each of these files for binary content, in parallel
+    void DetectContentKinds(ProjectModel& model, const std::vector<uint32_t>& files);
+    // The same by path, for a job that must not touch the model. Files not reached before a cancel stay Unknown.
+    std::vector<SniffedFile> DetectContentKinds(const std::vector<std::string>& paths);
+
+    // Compiles the .gitignore files of a model that was not produced by Scan(), e.g. one loaded from an index
+    void RestoreIgnoreScopes(ProjectModel& model) const;
+
+    // Directories whose entries changed since they were read. FindChangedDirectories()
+    // only touches the disk, so it can run on another thread than the one owning the model.
+    static std::vector<DirectoryStamp> GetDirectoryStamps(const ProjectModel& model);
+    static std::vector<uint32_t> FindChangedDirectories(const std::vector<DirectoryStamp>& stamps);
+
+    // Sniffed files whose size or modification time moved since, so their content kind no longer holds.
+    // The directory mtimes miss these: rewriting a file does not touch its folder.
+    static std::vector<ContentStamp> GetContentStamps(const ProjectModel& model);
+    static std::vector<uint32_t> FindChangedFiles(const std::vector<ContentStamp>& stamps);
+
+    unsigned GetThreadCount() const { return m_pool.GetThreadCount(); }
+
+private:
+    struct PendingDir;
+
+    void ScanDirectory(PendingDir* dir);
+    void MergeEntries(ProjectModel& model, const PendingScan& scan) const;
+    std::shared_ptr<const IgnoreScope> LoadIgnoreFile(const std::string& filePath, const std::string& basePath,
+                                                      std::shared_ptr<const IgnoreScope> parent) const;
+
+    EntryFilter m_descendFilter;
+    JobProgress* m_progress = nullptr;
+    ThreadPool m_pool;
+};
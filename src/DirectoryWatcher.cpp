@@ -0,0 +1,337 @@
+#include "DirectoryWatcher.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // A batch goes out once the tree has been quiet this long, or at the latest after kMaxDelay
+    constexpr std::chrono::milliseconds kQuietPeriod(150);
+    constexpr std::chrono::milliseconds kMaxDelay(1000);
+
+    // Past this many changed entries in one directory, reading it again is cheaper
+    constexpr size_t kMaxChangesPerDirectory = 256;
+
+    bool IsWithin(const std::string& path, const std::string& directory)
+    {
+        return directory.empty() || path == directory ||
+               (path.size() > directory.size() && path[directory.size()] == '/' && path.compare(0, directory.size(), directory) == 0);
+    }
+}
+
+DirectoryWatcher::DirectoryWatcher(Callback callback)
+    : m_callback(std::move(callback)), m_fd(-1), m_wakeFd(-1), m_overflow(false)
+{
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+    Stop();
+}
+
+std::vector<std::string> DirectoryWatcher::GetUnwatchedDirectories() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_unwatched;
+}
+
+#ifdef __linux__
+
+bool DirectoryWatcher::IsSupported()
+{
+    return true;
+}
+
+void DirectoryWatcher::Start(const std::string& rootPath)
+{
+    Stop();
+
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0)
+        return;
+    m_wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (m_wakeFd < 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+        return;
+    }
+
+    m_rootPath = rootPath;
+    m_thread = std::thread(&DirectoryWatcher::ThreadLoop, this);
+}
+
+void DirectoryWatcher::Stop()
+{
+    if (m_thread.joinable())
+    {
+        uint64_t one = 1;
+        (void)!write(m_wakeFd, &one, sizeof(one));
+        m_thread.join();
+    }
+
+    // Closing the inotify descriptor drops every watch at once
+    if (m_fd >= 0)
+        close(m_fd);
+    if (m_wakeFd >= 0)
+        close(m_wakeFd);
+    m_fd = -1;
+    m_wakeFd = -1;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_wdPaths.clear();
+    m_pathWds.clear();
+    m_unwatched.clear();
+    m_pending.clear();
+    m_overflow = false;
+}
+
+void DirectoryWatcher::SetWatchedDirectories(const std::vector<std::string>& directories)
+{
+    if (m_fd < 0)
+        return;
+
+    const uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE |
+                          IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_unwatched.clear();
+
+    std::unordered_set<std::string> wanted(directories.begin(), directories.end());
+    for (const std::string& directory : directories)
+    {
+        if (m_pathWds.count(directory))
+            continue;
+
+        std::string fullPath = directory.empty() ? m_rootPath : m_rootPath + '/' + directory;
+        int wd = inotify_add_watch(m_fd, fullPath.c_str(), mask);
+        if (wd < 0)
+        {
+            // ENOSPC is fs.inotify.max_user_watches; anything else means the directory is already gone
+            if (errno == ENOSPC)
+                m_unwatched.push_back(directory);
+            continue;
+        }
+
+        // A renamed directory keeps its inode, and inotify hands back the existing watch
+        auto previous = m_wdPaths.find(wd);
+        if (previous != m_wdPaths.end())
+            m_pathWds.erase(previous->second);
+        m_wdPaths[wd] = directory;
+        m_pathWds[directory] = wd;
+    }
+
+    for (auto it = m_pathWds.begin(); it != m_pathWds.end();)
+    {
+        if (wanted.count(it->first))
+        {
+            ++it;
+            continue;
+        }
+        inotify_rm_watch(m_fd, it->second);
+        m_wdPaths.erase(it->second);
+        it = m_pathWds.erase(it);
+    }
+}
+
+void DirectoryWatcher::ThreadLoop()
+{
+    pollfd fds[2] = { { m_fd, POLLIN, 0 }, { m_wakeFd, POLLIN, 0 } };
+    for (;;)
+    {
+        int timeout = -1;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_pending.empty() || m_overflow)
+            {
+                Clock::time_point deadline = std::min(m_lastEvent + kQuietPeriod, m_firstEvent + kMaxDelay);
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+                timeout = (int)std::max<long long>(0, remaining.count());
+            }
+        }
+
+        if (poll(fds, 2, timeout) < 0 && errno != EINTR)
+            break;
+        if (fds[1].revents)
+            break; // Stop()
+
+        if (fds[0].revents & POLLIN)
+            ReadEvents();
+
+        bool due;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Clock::time_point now = Clock::now();
+            due = (!m_pending.empty() || m_overflow) &&
+                  (now >= m_lastEvent + kQuietPeriod || now >= m_firstEvent + kMaxDelay);
+        }
+        if (due)
+            Flush();
+    }
+}
+
+void DirectoryWatcher::ReadEvents()
+{
+    alignas(inotify_event) char buffer[64 * 1024];
+    for (;;)
+    {
+        ssize_t bytes = read(m_fd, buffer, sizeof(buffer));
+        if (bytes <= 0)
+            break;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (ssize_t offset = 0; offset < bytes;)
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                if (m_pending.empty() && !m_overflow)
+                    m_firstEvent = Clock::now();
+                m_lastEvent = Clock::now();
+                m_overflow = true;
+                continue;
+            }
+
+            auto it = m_wdPaths.find(event->wd);
+            if (it == m_wdPaths.end())
+                continue;
+            const std::string directory = it->second;
+
+            if (event->mask & IN_IGNORED)
+            {
+                // The watch is gone (directory deleted or unwatched)
+                auto path = m_pathWds.find(directory);
+                if (path != m_pathWds.end() && path->second == event->wd)
+                    m_pathWds.erase(path);
+                m_wdPaths.erase(it);
+                continue;
+            }
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+            {
+                // Other directories are reported by their parent; the root has none
+                if (directory.empty())
+                    MarkChanged(directory, std::string());
+                continue;
+            }
+
+            if (event->len == 0)
+                continue;
+            // Saving a file is reported too: its contents are sniffed and counted again
+            MarkChanged(directory, std::string(event->name));
+        }
+    }
+}
+
+void DirectoryWatcher::MarkChanged(const std::string& directory, const std::string& name)
+{
+    // Called with m_mutex held. An empty name asks for the directory to be read again.
+    Clock::time_point now = Clock::now();
+    if (m_pending.empty() && !m_overflow)
+        m_firstEvent = now;
+    m_lastEvent = now;
+
+    PendingDir& pending = m_pending[directory];
+    if (name.empty() || name == ".gitignore")
+        pending.rescan = true; // the ignore scopes of the whole subtree are rebuilt by the scanner
+    else
+        pending.names.insert(name);
+}
+
+void DirectoryWatcher::Flush()
+{
+    std::unordered_map<std::string, PendingDir> pending;
+    bool overflow;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        pending.swap(m_pending);
+        overflow = m_overflow;
+        m_overflow = false;
+    }
+
+    Batch batch;
+    batch.rootPath = m_rootPath;
+
+    // Lost events may be anywhere in the watched set; the receiver has the stamps to find them
+    batch.overflow = overflow;
+
+    std::vector<std::string> rescans;
+    for (const auto& entry : pending)
+    {
+        if (entry.second.rescan || entry.second.names.size() > kMaxChangesPerDirectory)
+            rescans.push_back(entry.first);
+    }
+
+    // Keep only the outermost rescans; everything below them is read anyway
+    std::sort(rescans.begin(), rescans.end(),
+              [](const std::string& a, const std::string& b) { return a.size() < b.size(); });
+    auto isCovered = [&batch](const std::string& path) {
+        return std::any_of(batch.rescans.begin(), batch.rescans.end(),
+                           [&path](const std::string& rescan) { return IsWithin(path, rescan); });
+    };
+    for (const std::string& rescan : rescans)
+    {
+        if (!isCovered(rescan))
+            batch.rescans.push_back(rescan);
+    }
+
+    // Report the state on disk now, not the events: a file created and deleted
+    // within one batch simply does not exist
+    for (const auto& entry : pending)
+    {
+        if (isCovered(entry.first))
+            continue;
+
+        std::string base = entry.first.empty() ? m_rootPath + '/' : m_rootPath + '/' + entry.first + '/';
+        for (const std::string& name : entry.second.names)
+        {
+            Change change{ entry.first, name, false, false };
+            struct stat st;
+            std::string fullPath = base + name;
+            if (lstat(fullPath.c_str(), &st) == 0)
+            {
+                change.exists = true;
+                change.isDir = S_ISDIR(st.st_mode);
+                // Symlinked directories are not followed, same as in the scanner
+                if (S_ISLNK(st.st_mode) && stat(fullPath.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+                    change.exists = false;
+            }
+            batch.changes.push_back(std::move(change));
+        }
+    }
+
+    if (!batch.changes.empty() || !batch.rescans.empty() || batch.overflow)
+        m_callback(std::move(batch));
+}
+
+#else
+
+bool DirectoryWatcher::IsSupported()
+{
+    return false;
+}
+
+void DirectoryWatcher::Start(const std::string& rootPath)
+{
+    m_rootPath = rootPath;
+}
+
+void DirectoryWatcher::Stop()
+{
+}
+
+void DirectoryWatcher::SetWatchedDirectories(const std::vector<std::string>& directories)
+{
+}
+
+#endif
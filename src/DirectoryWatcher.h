@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Watches the directories of a loaded project and reports what changed on
+// disk (inotify on Linux; elsewhere IsSupported() is false and nothing is
+// reported). Only the directories handed to SetWatchedDirectories() are
+// watched, so ignored trees like node_modules never cost a watch.
+//
+// Events are collected on a background thread until the tree has been quiet
+// for a moment and then delivered as one batch. A batch describes the final
+// state of every touched entry rather than the events themselves, so the
+// create/delete storms of git checkout or npm install collapse into a
+// single update.
+class DirectoryWatcher
+{
+public:
+    struct Change
+    {
+        std::string directory; // relative to the project root, "" for the root
+        std::string name;
+        bool exists; // also true for a file that was saved in place
+        bool isDir;
+    };
+
+    struct Batch
+    {
+        std::string rootPath;
+        std::vector<Change> changes;
+        // Directories whose whole subtree must be read again: a .gitignore changed
+        // or too many entries changed at once
+        std::vector<std::string> rescans;
+        // Events were lost to a queue overflow, in any of the watched directories
+        bool overflow = false;
+    };
+
+    // Runs on the watcher thread
+    using Callback = std::function<void(Batch batch)>;
+
+    explicit DirectoryWatcher(Callback callback);
+    ~DirectoryWatcher();
+
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    static bool IsSupported();
+
+    // Starts watching a new project (with no directories yet); drops any previous one
+    void Start(const std::string& rootPath);
+    void Stop();
+
+    // Makes the watched set equal to these directories (relative paths, "" for the root)
+    void SetWatchedDirectories(const std::vector<std::string>& directories);
+
+    // Directories left unwatched because the system watch limit was reached.
+    // Changes inside them are only picked up by rescanning them.
+    std::vector<std::string> GetUnwatchedDirectories() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct PendingDir
+    {
+        std::unordered_set<std::string> names;
+        bool rescan = false;
+    };
+
+    void ThreadLoop();
+    void ReadEvents();
+    void Flush();
+    void MarkChanged(const std::string& directory, const std::string& name);
+
+    Callback m_callback;
+    std::string m_rootPath;
+    int m_fd;
+    int m_wakeFd;
+    std::thread m_thread;
+
+    mutable std::mutex m_mutex; // guards everything below
+    std::unordered_map<int, std::string> m_wdPaths;
+    std::unordered_map<std::string, int> m_pathWds;
+    std::vector<std::string> m_unwatched;
+    std::unordered_map<std::string, PendingDir> m_pending;
+    bool m_overflow;
+    Clock::time_point m_firstEvent;
+    Clock::time_point m_lastEvent;
+};
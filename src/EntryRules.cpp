@@ -0,0 +1,34 @@
+#include "EntryRules.h"
+
+bool EntryRules::ShouldIgnore(const std::string& relativePath, const std::string& name, bool isDir, const IgnoreScope* ignoreScope) const
+{
+    if (!m_showHidden && !name.empty() && name[0] == '.')
+        return true;
+
+    // Typed patterns take precedence over the project's .gitignore files
+    IgnoreMatcher::Result result = m_ignoreMatcher.Match(relativePath, isDir);
+    if (result == IgnoreMatcher::Result::None && m_useGitignore && ignoreScope)
+        result = ignoreScope->Match(relativePath, isDir);
+    return result == IgnoreMatcher::Result::Ignored;
+}
+
+bool EntryRules::IsVisible(const std::string& relativePath, const std::string& name, bool isDir, const IgnoreScope* ignoreScope) const
+{
+    if (ShouldIgnore(relativePath, name, isDir, ignoreScope))
+        return false;
+    return isDir || m_enabledExtensions.FindForFileName(name) >= 0;
+}
+
+EntryFilter EntryRules::GetDescendFilter() const
+{
+    return [this](const std::string& relativePath, const std::string& name, bool isDir, const IgnoreScope* ignoreScope) {
+        return !ShouldIgnore(relativePath, name, isDir, ignoreScope);
+    };
+}
+
+EntryFilter EntryRules::GetVisibilityFilter() const
+{
+    return [this](const std::string& relativePath, const std::string& name, bool isDir, const IgnoreScope* ignoreScope) {
+        return IsVisible(relativePath, name, isDir, ignoreScope);
+    };
+}
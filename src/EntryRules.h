@@ -0,0 +1,36 @@
+#pragma once
+
+#include "FileTypeRegistry.h"
+#include "IgnoreMatcher.h"
+#include "ProjectModel.h"
+
+#include <string>
+#include <string_view>
+
+// The settings that decide which entries of a project are shown and exported:
+// hidden entries, the typed ignore patterns, the project's .gitignore files and
+// the enabled file types. Set up on one thread, then read concurrently by the
+// scanner threads; it never refers to any widget.
+class EntryRules
+{
+public:
+    void SetIgnorePatterns(std::string_view text) { m_ignoreMatcher = IgnoreMatcher::Compile(text); }
+    void SetShowHidden(bool showHidden) { m_showHidden = showHidden; }
+    void SetUseGitignore(bool useGitignore) { m_useGitignore = useGitignore; }
+    void SetEnabledExtensions(ExtensionTable extensions) { m_enabledExtensions = std::move(extensions); }
+
+    // Hidden or matched by an ignore rule; ignored directories are not descended into
+    bool ShouldIgnore(const std::string& relativePath, const std::string& name, bool isDir, const IgnoreScope* ignoreScope) const;
+    // Not ignored, and a directory or a file of an enabled type
+    bool IsVisible(const std::string& relativePath, const std::string& name, bool isDir, const IgnoreScope* ignoreScope) const;
+
+    // Both refer to this object, which must outlive them
+    EntryFilter GetDescendFilter() const;
+    EntryFilter GetVisibilityFilter() const;
+
+private:
+    IgnoreMatcher m_ignoreMatcher;
+    ExtensionTable m_enabledExtensions;
+    bool m_showHidden = false;
+    bool m_useGitignore = true;
+};
@@ -0,0 +1,172 @@
+#include "ExportManifest.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <system_error>
+
+namespace
+{
+    const char* const kMagic = "scriptcombiner-manifest 1";
+    const char* const kCreatedKey = "created ";
+
+    std::string GetLocalTime()
+    {
+        std::time_t now = std::time(nullptr);
+        char text[32];
+        std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+        return text;
+    }
+
+    // Parses digits up to the next tab; false if there are none or anything else is in the way
+    template <typename Number>
+    bool ParseField(std::string_view& line, unsigned base, Number& value)
+    {
+        size_t tab = line.find('\t');
+        if (tab == 0 || tab == std::string_view::npos)
+            return false;
+        bool negative = base == 10 && line[0] == '-';
+        uint64_t result = 0;
+        for (size_t i = negative ? 1 : 0; i < tab; ++i)
+        {
+            char c = line[i];
+            unsigned digit;
+            if (c >= '0' && c <= '9')
+                digit = (unsigned)(c - '0');
+            else if (base == 16 && c >= 'a' && c <= 'f')
+                digit = (unsigned)(c - 'a' + 10);
+            else
+                return false;
+            result = result * base + digit;
+        }
+        value = negative ? (Number)(0 - result) : (Number)result;
+        line.remove_prefix(tab + 1);
+        return true;
+    }
+
+    bool ParseEntry(std::string_view line, ExportManifest::Entry& entry)
+    {
+        if (!ParseField(line, 16, entry.hash) || !ParseField(line, 10, entry.size) || !ParseField(line, 10, entry.mtime) ||
+            line.empty())
+            return false;
+        entry.path.assign(line.data(), line.size());
+        return true;
+    }
+}
+
+bool ExportManifest::Load(const std::string& manifestPath)
+{
+    Clear();
+
+    // Read whole and split in place: a manifest of a big project has a line for each of 100k files
+    std::ifstream file(std::filesystem::u8path(manifestPath), std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    std::string text((size_t)std::max<std::streamoff>(file.tellg(), 0), '\0');
+    file.seekg(0);
+    if (!file.read(&text[0], (std::streamsize)text.size()))
+        return false;
+
+    std::string_view rest = text;
+    auto nextLine = [&rest](std::string_view& line) {
+        size_t end = rest.find('\n');
+        if (end == std::string_view::npos)
+            return false;
+        line = rest.substr(0, end);
+        rest.remove_prefix(end + 1);
+        return true;
+    };
+
+    std::string_view line;
+    if (!nextLine(line) || line != kMagic)
+        return false;
+    if (!nextLine(line) || line.substr(0, 8) != kCreatedKey)
+        return false;
+    m_created = std::string(line.substr(8));
+
+    size_t lineCount = (size_t)std::count(rest.begin(), rest.end(), '\n');
+    m_entries.reserve(lineCount);
+    m_index.reserve(lineCount);
+    Entry entry;
+    while (nextLine(line))
+    {
+        if (!ParseEntry(line, entry))
+        {
+            Clear();
+            return false;
+        }
+        Add(std::move(entry));
+    }
+    return rest.empty();
+}
+
+bool ExportManifest::Save(const std::string& manifestPath)
+{
+    m_created = GetLocalTime();
+
+    std::filesystem::path path = std::filesystem::u8path(manifestPath);
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+        file << kMagic << '\n' << kCreatedKey << m_created << '\n';
+
+        char fields[64];
+        for (const Entry& entry : m_entries)
+        {
+            // A path with a line break cannot be stored; that file counts as added next time
+            if (entry.path.find('\n') != std::string::npos)
+                continue;
+            int length = std::snprintf(fields, sizeof(fields), "%016" PRIx64 "\t%" PRIu64 "\t%" PRId64 "\t", entry.hash,
+                                       entry.size, entry.mtime);
+            file.write(fields, length);
+            file << entry.path << '\n';
+        }
+        if (!file.flush())
+            return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+void ExportManifest::Clear()
+{
+    m_entries.clear();
+    m_index.clear();
+    m_created.clear();
+}
+
+void ExportManifest::Add(Entry entry)
+{
+    auto inserted = m_index.emplace(entry.path, m_entries.size());
+    if (inserted.second)
+        m_entries.push_back(std::move(entry));
+    else
+        m_entries[inserted.first->second] = std::move(entry);
+}
+
+const ExportManifest::Entry* ExportManifest::Find(const std::string& path) const
+{
+    auto found = m_index.find(path);
+    return found != m_index.end() ? &m_entries[found->second] : nullptr;
+}
+
+std::string ExportManifest::GetPathFor(const std::string& exportPath)
+{
+    std::filesystem::path path = std::filesystem::u8path(exportPath);
+    path.replace_extension(".manifest");
+    return path.u8string();
+}
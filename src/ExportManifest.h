@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What a combined export contained: for every file, its relative path, size,
+// modification time and content hash. Saved next to the export, it lets the
+// next export write only what changed since (see CombinedExport::WriteChanges).
+//
+// The file is plain text, one file per line, so it can be inspected and
+// diffed: "<hash in hex>\t<size>\t<mtime in ns>\t<path>" under a two-line
+// header with the format version and the time of the export.
+class ExportManifest
+{
+public:
+    struct Entry
+    {
+        std::string path;   // relative to the project root, '/' separated
+        uint64_t size = 0;
+        int64_t mtime = 0;  // ns
+        uint64_t hash = 0;  // ContentHash::HashContents, 0 if not known (binary files are not read)
+    };
+
+    bool Load(const std::string& manifestPath);
+    // Stamps the manifest with the current time. Writes to a temporary file and renames it into place.
+    bool Save(const std::string& manifestPath);
+
+    void Clear();
+    void Add(Entry entry);
+    const Entry* Find(const std::string& path) const;
+    const std::vector<Entry>& GetEntries() const { return m_entries; }
+    const std::string& GetCreated() const { return m_created; } // "2025-06-01 14:03:11", local time
+
+    // "out/MyGame_2025-06-01.txt" -> "out/MyGame_2025-06-01.manifest"
+    static std::string GetPathFor(const std::string& exportPath);
+
+private:
+    std::vector<Entry> m_entries;
+    std::unordered_map<std::string, size_t> m_index; // path -> entry
+    std::string m_created;
+};
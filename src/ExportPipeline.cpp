@@ -0,0 +1,244 @@
+#include "ExportPipeline.h"
+#include "ContentHash.h"
+#include "ContentSniffer.h"
+#include "TextNormalizer.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+
+ExportPipeline::Summary ExportPipeline::Run(const std::vector<Item>& items, ExportWriter& writer)
+{
+    m_slots.assign(items.size(), Slot());
+    m_nextToRead = 0;
+    m_nextToWrite = 0;
+    m_inFlightBytes = 0;
+
+    // Reading is mostly waiting on the disk, so more readers than cores still pay off
+    unsigned readerCount = m_options.readerCount;
+    if (readerCount == 0)
+        readerCount = std::clamp(std::thread::hardware_concurrency() * 2, 4u, 32u);
+    readerCount = (unsigned)std::min<size_t>(readerCount, std::max<size_t>(items.size(), 1));
+
+    // Any file bigger than a fair share of the budget is streamed by the writer instead
+    m_streamThreshold = std::max<size_t>(m_options.maxInFlightBytes / (readerCount * 2), 64 * 1024);
+
+    std::vector<std::thread> readers;
+    for (unsigned i = 0; i < readerCount; ++i)
+        readers.emplace_back(&ExportPipeline::ReaderLoop, this, std::cref(items), std::cref(writer));
+
+    // By hash: the size and index of the first file with those contents
+    struct FirstCopy
+    {
+        uint64_t size;
+        size_t index;
+    };
+    std::unordered_map<uint64_t, FirstCopy> firstCopies;
+
+    JobProgress* progress = m_options.progress;
+    if (progress)
+        progress->StartPhase("Writing", items.size());
+
+    Summary summary;
+    if (m_options.recordHashes)
+        summary.hashes.assign(items.size(), 0);
+    if (m_options.stripComments && m_options.fileTypes)
+        summary.savings.assign(m_options.fileTypes->GetTypes().size(), CommentStripper::Savings());
+    for (size_t index = 0; index < items.size(); ++index)
+    {
+        // Readers claim nothing more; those still reading finish their file and leave
+        if (progress && progress->IsCancelled())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_nextToRead = items.size();
+            }
+            m_readerWake.notify_all();
+            break;
+        }
+
+        Slot slot;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_writerWake.wait(lock, [this, index] { return m_slots[index].state != Slot::Pending; });
+            slot = std::move(m_slots[index]);
+        }
+
+        const Item& item = items[index];
+        std::string reference;
+        if (slot.hashed && m_options.recordHashes)
+            summary.hashes[index] = slot.hash;
+        if (slot.hashed && m_options.deduplicate)
+        {
+            auto found = firstCopies.find(slot.hash);
+            if (found != firstCopies.end() && found->second.size == slot.size)
+                reference = "(identical to " + items[found->second.index].label + ", contents omitted)\n";
+        }
+
+        // A reference only pays off when it is shorter than what it replaces
+        bool written = false;
+        CommentStripper::Savings stripped;
+        if (!reference.empty() && reference.size() < slot.size)
+        {
+            writer.WriteSection(item.label, item.header, reference, writer.Measure(reference));
+            ++summary.duplicates;
+            written = true;
+        }
+        else if (slot.state == Slot::Ready)
+        {
+            writer.WriteSection(item.label, item.header, slot.content, slot.cost);
+            written = true;
+            stripped.bytesIn = slot.unstripped;
+            stripped.bytesOut = slot.content.size();
+        }
+        else if (slot.state == Slot::Stream)
+        {
+            written = writer.AppendTextFile(item.fullPath, item.header, item.label, slot.syntax, &stripped);
+        }
+
+        if (written)
+        {
+            ++summary.files;
+            if (slot.fileType >= 0 && stripped.bytesIn > 0)
+            {
+                CommentStripper::Savings& savings = summary.savings[slot.fileType];
+                ++savings.files;
+                savings.bytesIn += stripped.bytesIn;
+                savings.bytesOut += stripped.bytesOut;
+            }
+            if (slot.hashed && m_options.deduplicate)
+                firstCopies.emplace(slot.hash, FirstCopy{ slot.size, index });
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_inFlightBytes -= slot.content.size();
+            m_nextToWrite = index + 1;
+        }
+        m_readerWake.notify_all();
+        if (progress)
+            progress->Add(1, slot.size);
+    }
+
+    for (std::thread& reader : readers)
+        reader.join();
+    m_slots.clear();
+    return summary;
+}
+
+void ExportPipeline::ReaderLoop(const std::vector<Item>& items, const ExportWriter& writer)
+{
+    for (;;)
+    {
+        size_t index;
+        {
+            // Past the budget, only the file the writer is waiting for may still be read
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_readerWake.wait(lock, [this, &items] {
+                return m_nextToRead >= items.size() || m_inFlightBytes < m_options.maxInFlightBytes ||
+                       m_nextToRead == m_nextToWrite;
+            });
+            if (m_nextToRead >= items.size())
+                return;
+            index = m_nextToRead++;
+        }
+
+        Slot slot;
+        ReadItem(items[index], slot);
+        slot.cost = writer.Measure(slot.content);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_inFlightBytes += slot.content.size();
+            m_slots[index] = std::move(slot);
+        }
+        m_writerWake.notify_one();
+    }
+}
+
+void ExportPipeline::ReadItem(const Item& item, Slot& slot) const
+{
+    std::ifstream file(std::filesystem::u8path(item.fullPath), std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        slot.state = Slot::Failed;
+        return;
+    }
+
+    // Binary files are replaced by one line; files marked in the model are not even read
+    slot.state = Slot::Ready;
+    if (item.binary)
+    {
+        slot.content = ContentSniffer::GetPlaceholder();
+        return;
+    }
+
+    // The comment syntax comes from the type of the file, as in the preview
+    if (m_options.stripComments && m_options.fileTypes)
+    {
+        size_t slash = item.label.find_last_of('/');
+        std::string_view fileName = std::string_view(item.label).substr(slash == std::string::npos ? 0 : slash + 1);
+        if (const FileType* type = m_options.fileTypes->FindForFileName(fileName))
+        {
+            slot.syntax = CommentStripper::FromLexer(type->lexer);
+            if (slot.syntax != CommentStripper::Syntax::None)
+                slot.fileType = (int)(type - m_options.fileTypes->GetTypes().data());
+        }
+    }
+
+    std::streamoff size = file.tellg();
+    file.seekg(0);
+    slot.size = size > 0 ? (uint64_t)size : 0;
+    if (size < 0 || (size_t)size > m_streamThreshold)
+    {
+        char block[ContentSniffer::kBlockSize];
+        file.read(block, sizeof(block));
+        if (ContentSniffer::IsBinary(block, (size_t)file.gcount()))
+        {
+            slot.content = ContentSniffer::GetPlaceholder();
+            return;
+        }
+        slot.state = Slot::Stream;
+        if (m_options.deduplicate || m_options.recordHashes)
+        {
+            // Hashed a chunk at a time; the writer reads the file again only if it is new
+            file.clear();
+            file.seekg(0);
+            slot.hashed = ContentHash::HashStream(file, slot.hash, slot.size);
+        }
+        return;
+    }
+
+    std::string raw((size_t)size, '\0');
+    file.read(&raw[0], size);
+    raw.resize((size_t)file.gcount());
+    if (ContentSniffer::IsBinary(raw.data(), raw.size()))
+    {
+        slot.content = ContentSniffer::GetPlaceholder();
+        return;
+    }
+    if (m_options.deduplicate || m_options.recordHashes)
+    {
+        slot.hashed = true;
+        slot.hash = ContentHash::HashContents(raw.data(), raw.size());
+        slot.size = raw.size();
+    }
+
+    TextNormalizer normalizer;
+    slot.content.reserve(raw.size() + 1);
+    normalizer.Feed(raw.data(), raw.size(), slot.content);
+    normalizer.Finish(slot.content);
+
+    if (slot.syntax != CommentStripper::Syntax::None)
+    {
+        // The raw bytes are no longer needed, so their buffer takes the stripped text
+        CommentStripper stripper(slot.syntax);
+        raw.clear();
+        stripper.Feed(slot.content.data(), slot.content.size(), raw);
+        stripper.Finish(raw);
+        slot.unstripped = slot.content.size();
+        slot.content.swap(raw);
+    }
+}
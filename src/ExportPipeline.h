@@ -0,0 +1,101 @@
+#pragma once
+
+#include "CommentStripper.h"
+#include "ExportWriter.h"
+#include "FileTypeRegistry.h"
+#include "JobProgress.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Combines files into an ExportWriter with a pool of reader threads feeding a
+// single writer. Readers open, read and clean up files ahead of the writer, so
+// the latency of one file overlaps the others; the writer takes them strictly
+// in order, so the output is byte-identical to a serial export.
+//
+// Read-ahead is bounded: readers stop claiming files once maxInFlightBytes are
+// waiting for the writer, and files too large to hold in memory are left to
+// the writer to stream itself when their turn comes. Binary files are
+// replaced by a one-line placeholder. When the writer splits its output,
+// readers also measure what they read, so only files that straddle a part
+// boundary are measured again by the writer.
+//
+// With deduplicate on, readers also hash the raw bytes of each text file, and
+// a file with the same hash and size as one already written gets a one-line
+// reference to it instead of its contents. The hash is 64 bits and not
+// cryptographic; together with the size, a false match is not a practical
+// concern for source trees.
+//
+// With stripComments on, text files of a type whose lexer has a known comment
+// syntax go through a CommentStripper after normalizing, and the bytes saved
+// are summed per type. Hashes are still of the files as read.
+//
+// With a JobProgress, every file written is reported to it, and a cancel
+// stops the export after the file being written; the output is then
+// incomplete and should be discarded.
+class ExportPipeline
+{
+public:
+    struct Options
+    {
+        unsigned readerCount = 0;                   // 0 picks a default from the core count
+        size_t maxInFlightBytes = 64 * 1024 * 1024; // read but not yet written
+        bool deduplicate = false;                   // repeated contents become a reference to the first copy
+        bool recordHashes = false;                  // fills Summary::hashes
+        bool stripComments = false;                 // drops comments and blank lines, see CommentStripper
+        const FileTypeRegistry* fileTypes = nullptr; // tells the comment syntax of each file; must outlive Run()
+        JobProgress* progress = nullptr;
+    };
+
+    struct Summary
+    {
+        size_t files = 0;      // files written, references included
+        size_t duplicates = 0; // of those, written as a reference
+        std::vector<uint64_t> hashes; // per item: ContentHash::HashContents of the file, 0 if it was not read
+        std::vector<CommentStripper::Savings> savings; // per type of Options::fileTypes, when stripping comments
+    };
+
+    struct Item
+    {
+        std::string fullPath;
+        std::string header; // written in front of the contents, only if the file can be opened
+        std::string label;  // names the file in part headers
+        bool binary = false; // known to be binary: gets the placeholder without being read
+    };
+
+    ExportPipeline() = default;
+    explicit ExportPipeline(const Options& options) : m_options(options) {}
+
+    Summary Run(const std::vector<Item>& items, ExportWriter& writer);
+
+private:
+    struct Slot
+    {
+        enum State { Pending, Ready, Failed, Stream } state = Pending;
+        std::string content;
+        uint64_t cost = 0; // ExportWriter::Measure(content)
+        bool hashed = false;
+        uint64_t hash = 0; // ContentHash::HashContents of the file as read, before normalizing
+        uint64_t size = 0; // of the file on disk
+        int fileType = -1; // index in Options::fileTypes of a file to strip comments from
+        CommentStripper::Syntax syntax = CommentStripper::Syntax::None;
+        uint64_t unstripped = 0; // size of content before stripping
+    };
+
+    void ReaderLoop(const std::vector<Item>& items, const ExportWriter& writer);
+    void ReadItem(const Item& item, Slot& slot) const;
+
+    Options m_options;
+
+    std::mutex m_mutex;
+    std::condition_variable m_readerWake;
+    std::condition_variable m_writerWake;
+    std::vector<Slot> m_slots;
+    size_t m_nextToRead = 0;
+    size_t m_nextToWrite = 0;
+    size_t m_inFlightBytes = 0;
+    size_t m_streamThreshold = 0;
+};
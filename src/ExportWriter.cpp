@@ -0,0 +1,459 @@
+#include "ExportWriter.h"
+#include "TextNormalizer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+    const char* const kPartRule = "# =========================================================================\n";
+
+    std::string GetFileName(const std::string& path)
+    {
+        size_t slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+}
+
+ExportWriter::ExportWriter(size_t bufferSize)
+    : m_buffer(bufferSize), m_used(0), m_bytesWritten(0), m_failed(false), m_compression(BlockCompressor::Format::None),
+      m_compressionLevel(0), m_compressedBytes(0), m_partNumber(1), m_partCost(0),
+      m_partHeaderCost(0), m_trailerCost(0), m_partStarted(false), m_partHasText(false), m_sectionHeaderCost(0), m_headerPending(false), m_atLineStart(true)
+{
+}
+
+ExportWriter::~ExportWriter()
+{
+    Discard();
+}
+
+void ExportWriter::SetCompression(BlockCompressor::Format format, int level)
+{
+    m_compression = format;
+    m_compressionLevel = level;
+}
+
+bool ExportWriter::Open(const std::string& path, SplitOptions split)
+{
+    Discard();
+    m_split = std::move(split);
+    m_basePath = path;
+    m_bytesWritten = 0;
+    m_compressedBytes = 0;
+    m_failed = false;
+
+    m_partNumber = 1;
+    m_partCost = 0;
+    m_partStarted = false;
+    m_partHasText = false;
+    m_sectionLabel.clear();
+    m_headerPending = false;
+    m_atLineStart = true;
+    return OpenFile(GetPartPath(1));
+}
+
+bool ExportWriter::OpenFile(const std::string& path)
+{
+    m_path = path;
+    m_tempPath = path + ".partial";
+    m_used = 0;
+
+    m_file.open(std::filesystem::u8path(m_tempPath), std::ios::binary | std::ios::trunc);
+    if (!m_file || !BlockCompressor::IsAvailable(m_compression))
+        m_failed = true;
+    else if (m_compression != BlockCompressor::Format::None)
+        m_compressor = std::make_unique<BlockCompressor>(m_file, m_compression, m_compressionLevel);
+    return !m_failed;
+}
+
+void ExportWriter::CloseFile()
+{
+    FlushBuffer();
+    if (m_compressor)
+    {
+        if (!m_failed && !m_compressor->Finish())
+            m_failed = true;
+        m_compressedBytes += m_compressor->GetBytesOut();
+        m_compressor.reset();
+    }
+    m_file.close();
+    if (m_file.fail())
+        m_failed = true;
+}
+
+void ExportWriter::WriteOut(const char* data, size_t size)
+{
+    if (m_compressor)
+    {
+        m_compressor->Write(data, size);
+        if (m_compressor->HasFailed())
+            m_failed = true;
+    }
+    else if (!m_file.write(data, (std::streamsize)size))
+    {
+        m_failed = true;
+    }
+}
+
+void ExportWriter::Write(std::string_view data)
+{
+    if (m_failed)
+        return;
+
+    m_bytesWritten += data.size();
+    if (data.size() > m_buffer.size() - m_used)
+    {
+        FlushBuffer();
+        // Large pieces skip the buffer instead of being copied through it
+        if (data.size() >= m_buffer.size())
+        {
+            WriteOut(data.data(), data.size());
+            return;
+        }
+    }
+    std::memcpy(m_buffer.data() + m_used, data.data(), data.size());
+    m_used += data.size();
+}
+
+uint64_t ExportWriter::Measure(std::string_view text) const
+{
+    if (m_split.partBudget == 0)
+        return 0;
+    return m_split.measure ? m_split.measure(text) : text.size();
+}
+
+void ExportWriter::WriteSection(std::string_view label, std::string_view header, std::string_view content, uint64_t contentCost)
+{
+    BeginSection(label, header, contentCost, true);
+    WriteSectionText(content, contentCost);
+}
+
+bool ExportWriter::AppendTextFile(const std::string& path, std::string_view header, std::string_view label,
+                                  CommentStripper::Syntax strip, CommentStripper::Savings* savings)
+{
+    std::ifstream file(std::filesystem::u8path(path), std::ios::binary);
+    if (!file)
+        return false;
+    // Too big to be measured ahead, so it is never moved to the next part whole
+    BeginSection(label, header, 0, false);
+
+    std::vector<char> chunk(256 * 1024);
+    std::string text;
+    std::string stripped;
+    TextNormalizer normalizer;
+    CommentStripper stripper(strip);
+    bool stripping = strip != CommentStripper::Syntax::None;
+    uint64_t normalizedBytes = 0;
+    for (bool last = false; !last;)
+    {
+        file.read(chunk.data(), (std::streamsize)chunk.size());
+        size_t size = (size_t)file.gcount();
+        last = size == 0;
+
+        text.clear();
+        if (last)
+            normalizer.Finish(text);
+        else
+            normalizer.Feed(chunk.data(), size, text);
+        if (!stripping)
+        {
+            WriteSectionText(text, Measure(text));
+            continue;
+        }
+
+        normalizedBytes += text.size();
+        stripped.clear();
+        stripper.Feed(text.data(), text.size(), stripped);
+        if (last)
+            stripper.Finish(stripped);
+        WriteSectionText(stripped, Measure(stripped));
+    }
+
+    if (stripping && savings)
+    {
+        savings->bytesIn = normalizedBytes;
+        savings->bytesOut = stripper.GetBytesOut();
+    }
+    return true;
+}
+
+void ExportWriter::BeginSection(std::string_view label, std::string_view header, uint64_t contentCost, bool costKnown)
+{
+    if (m_split.partBudget == 0)
+    {
+        Write(header);
+        return;
+    }
+
+    // A section that fits in a part of its own is never split: it moves on whole if this part is too full
+    m_sectionHeaderCost = Measure(header);
+    if (costKnown && m_partHasText)
+    {
+        uint64_t cost = m_sectionHeaderCost + contentCost;
+        bool fitsHere = m_partCost + Measure(FormatPartTrailer(m_partFirst, label)) + cost <= m_split.partBudget;
+        bool fitsAlone = m_partHeaderCost + Measure(FormatPartTrailer(label, label)) + cost <= m_split.partBudget;
+        if (!fitsHere && fitsAlone)
+            NextPart();
+    }
+
+    m_sectionLabel = label;
+    m_sectionHeader = header;
+    m_headerPending = true;
+    m_atLineStart = true;
+    UpdateOverhead();
+}
+
+void ExportWriter::UpdateOverhead()
+{
+    if (!m_partStarted)
+        m_partHeaderCost = Measure(FormatPartHeader(m_sectionLabel, !m_headerPending));
+    m_trailerCost = Measure(FormatPartTrailer(m_partStarted ? m_partFirst : m_sectionLabel, m_sectionLabel));
+}
+
+uint64_t ExportWriter::GetPendingCost() const
+{
+    uint64_t cost = m_trailerCost;
+    if (!m_partStarted)
+        cost += m_partHeaderCost;
+    if (m_headerPending)
+        cost += m_sectionHeaderCost;
+    return cost;
+}
+
+void ExportWriter::WriteSectionText(std::string_view text, uint64_t cost)
+{
+    if (m_split.partBudget == 0)
+    {
+        Write(text);
+        return;
+    }
+
+    if (text.empty() || m_partCost + GetPendingCost() + cost <= m_split.partBudget)
+    {
+        WriteSectionHeader();
+        Write(text);
+        m_partCost += cost;
+        if (!text.empty())
+        {
+            m_partHasText = true;
+            m_atLineStart = text.back() == '\n';
+        }
+        return;
+    }
+
+    // More than the part has room for: written line by line, moving to the next part at a line end once it is full
+    for (size_t pos = 0; pos < text.size();)
+    {
+        size_t end = text.find('\n', pos);
+        end = end == std::string_view::npos ? text.size() : end + 1;
+        std::string_view line = text.substr(pos, end - pos);
+        uint64_t lineCost = Measure(line);
+
+        if (m_atLineStart && m_partHasText && m_partCost + GetPendingCost() + lineCost > m_split.partBudget)
+        {
+            NextPart();
+            UpdateOverhead();
+        }
+
+        WriteSectionHeader();
+        Write(line);
+        m_partCost += lineCost;
+        m_partHasText = true;
+        m_atLineStart = line.back() == '\n';
+        pos = end;
+    }
+}
+
+void ExportWriter::WriteSectionHeader()
+{
+    // A section that continues from the previous part gets its header again
+    if (!m_partStarted)
+    {
+        Write(FormatPartHeader(m_sectionLabel, !m_headerPending));
+        m_partCost += m_partHeaderCost;
+        m_partStarted = true;
+        m_partFirst = m_sectionLabel;
+        m_headerPending = true;
+    }
+    if (m_headerPending)
+    {
+        Write(m_sectionHeader);
+        m_partCost += m_sectionHeaderCost;
+        m_headerPending = false;
+    }
+}
+
+std::string ExportWriter::FormatPartHeader(std::string_view label, bool continued) const
+{
+    std::string text = kPartRule;
+    text += "# Part " + std::to_string(m_partNumber);
+    if (m_partNumber > 1)
+        text += ", continued from " + GetFileName(GetPartPath(m_partNumber - 1));
+    text += continued ? "\n# Continues: " : "\n# Starts at: ";
+    text += label;
+    text += "\n";
+    text += kPartRule;
+    return text;
+}
+
+std::string ExportWriter::FormatPartTrailer(std::string_view first, std::string_view last, bool lastPart) const
+{
+    std::string text = "\n";
+    text += kPartRule;
+    text += "# End of part " + std::to_string(m_partNumber) + ": ";
+    text += first;
+    if (last != first)
+    {
+        text += " to ";
+        text += last;
+    }
+    text += lastPart ? "\n# This is the last part\n" : "\n# Continued in " + GetFileName(GetPartPath(m_partNumber + 1)) + "\n";
+    text += kPartRule;
+    return text;
+}
+
+void ExportWriter::WritePartTrailer(bool lastPart)
+{
+    if (m_partStarted)
+        Write(FormatPartTrailer(m_partFirst, m_sectionLabel, lastPart));
+}
+
+bool ExportWriter::NextPart()
+{
+    WritePartTrailer(false);
+    CloseFile();
+    m_closedParts.push_back(m_path);
+    m_tempPath.clear();
+
+    ++m_partNumber;
+    m_partCost = 0;
+    m_partStarted = false;
+    m_partHasText = false;
+    return OpenFile(GetPartPath(m_partNumber));
+}
+
+std::string ExportWriter::GetPartPath(unsigned number) const
+{
+    if (m_split.partBudget == 0)
+        return m_basePath;
+
+    // name.txt -> name.part01.txt, name.txt.gz -> name.part01.txt.gz; a name without an extension gets the suffix at the end
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), ".part%02u", number);
+    std::string base = m_basePath;
+    std::string compressed = BlockCompressor::GetExtension(m_compression);
+    if (!compressed.empty() && base.size() > compressed.size() &&
+        base.compare(base.size() - compressed.size(), compressed.size(), compressed) == 0)
+        base.resize(base.size() - compressed.size());
+    else
+        compressed.clear();
+
+    size_t nameStart = base.find_last_of("/\\") + 1; // 0 if there is no directory
+    size_t dot = base.rfind('.');
+    if (dot == std::string::npos || dot <= nameStart)
+        return base + suffix + compressed;
+    return base.substr(0, dot) + suffix + base.substr(dot) + compressed;
+}
+
+void ExportWriter::FlushBuffer()
+{
+    if (m_used > 0 && !m_failed)
+        WriteOut(m_buffer.data(), m_used);
+    m_used = 0;
+}
+
+bool ExportWriter::Commit()
+{
+    if (!m_file.is_open())
+        return false;
+
+    if (m_split.partBudget > 0)
+        WritePartTrailer(true);
+    CloseFile();
+    if (m_failed)
+    {
+        Discard();
+        return false;
+    }
+    m_closedParts.push_back(m_path);
+    m_tempPath.clear();
+
+    // Every part is complete before any of them replaces an older file. Several parts cannot be
+    // replaced at once, so their old files are moved aside first and put back if a rename fails:
+    // the export is either all new or all old, never a mix.
+    bool keepOld = m_closedParts.size() > 1;
+    std::vector<std::string> movedAside; // old file now at path + ".previous"
+    std::vector<std::string> replaced;
+    bool renamed = true;
+    for (const std::string& path : m_closedParts)
+    {
+        std::error_code ec;
+        std::filesystem::path target = std::filesystem::u8path(path);
+        if (keepOld && std::filesystem::exists(target, ec))
+        {
+            std::filesystem::rename(target, std::filesystem::u8path(path + ".previous"), ec);
+            if (ec)
+            {
+                renamed = false;
+                break;
+            }
+            movedAside.push_back(path);
+        }
+        std::filesystem::rename(std::filesystem::u8path(path + ".partial"), target, ec);
+        if (ec)
+        {
+            renamed = false;
+            break;
+        }
+        replaced.push_back(path);
+    }
+    if (!renamed)
+    {
+        for (const std::string& path : replaced)
+        {
+            std::error_code ec;
+            std::filesystem::remove(std::filesystem::u8path(path), ec);
+        }
+        for (const std::string& path : movedAside)
+        {
+            std::error_code ec;
+            std::filesystem::rename(std::filesystem::u8path(path + ".previous"), std::filesystem::u8path(path), ec);
+        }
+        Discard();
+        return false;
+    }
+    for (const std::string& path : movedAside)
+    {
+        std::error_code ec;
+        std::filesystem::remove(std::filesystem::u8path(path + ".previous"), ec);
+    }
+    m_closedParts.clear();
+
+    // Parts left over from an earlier, longer export would read as a continuation
+    if (m_split.partBudget > 0)
+    {
+        std::error_code ec;
+        unsigned number = m_partNumber + 1;
+        while (std::filesystem::remove(std::filesystem::u8path(GetPartPath(number)), ec))
+            ++number;
+    }
+    return true;
+}
+
+void ExportWriter::Discard()
+{
+    m_compressor.reset();
+    if (m_file.is_open())
+        m_file.close();
+    if (!m_tempPath.empty())
+        m_closedParts.push_back(m_path);
+    for (const std::string& path : m_closedParts)
+    {
+        std::error_code ec;
+        std::filesystem::remove(std::filesystem::u8path(path + ".partial"), ec);
+    }
+    m_closedParts.clear();
+    m_tempPath.clear();
+    m_used = 0;
+}
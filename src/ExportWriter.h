@@ -0,0 +1,133 @@
+#pragma once
+
+#include "BlockCompressor.h"
+#include "CommentStripper.h"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Buffered output for the combined file. Everything goes to a temporary file
+// next to the target, which is renamed over it only when Commit() succeeds,
+// so a failed or cancelled export never leaves a truncated file behind.
+// Memory use is the buffer size, however large the output gets.
+//
+// With a part budget the output is split while it is written: name.txt
+// becomes name.part01.txt, name.part02.txt, ... Parts break between sections
+// (the tree, then one section per file); a section too big for a part of its
+// own is split at line ends. Each part starts with a short header naming the
+// part and where it starts, and ends with a trailer naming what it covered.
+// Commit() replaces the parts of an earlier export all or not at all.
+//
+// With compression, every output file is gzip or zstd compressed on the way
+// to disk by a BlockCompressor; no uncompressed copy is written. A ".gz" or
+// ".zst" at the end of the name stays there when parts are numbered.
+class ExportWriter
+{
+public:
+    struct SplitOptions
+    {
+        uint64_t partBudget = 0; // 0 writes a single file
+        // Cost of a piece of text against the budget, e.g. its token count; its size
+        // in bytes if not set. Also called from the export's reader threads.
+        std::function<uint64_t(std::string_view)> measure;
+    };
+
+    explicit ExportWriter(size_t bufferSize = 4 * 1024 * 1024);
+    ~ExportWriter(); // discards the output unless it was committed
+
+    ExportWriter(const ExportWriter&) = delete;
+    ExportWriter& operator=(const ExportWriter&) = delete;
+
+    // Applies from the next Open(); level 0 is the format's default
+    void SetCompression(BlockCompressor::Format format, int level = 0);
+
+    bool Open(const std::string& path) { return Open(path, SplitOptions()); }
+    bool Open(const std::string& path, SplitOptions split);
+    void Write(std::string_view data);
+
+    // One section of the export under its header. label names it in part
+    // headers; contentCost is Measure(content), which callers may compute ahead.
+    void WriteSection(std::string_view label, std::string_view header, std::string_view content, uint64_t contentCost);
+    // 0 without a part budget, so callers can measure unconditionally
+    uint64_t Measure(std::string_view text) const;
+
+    // A section written piece by piece, for text generated while it is written.
+    // Its size is not known ahead, so, like a streamed file, it is split at line
+    // ends rather than moved to the next part whole.
+    void BeginStreamedSection(std::string_view label, std::string_view header) { BeginSection(label, header, 0, false); }
+    void WriteStreamedText(std::string_view text) { WriteSectionText(text, Measure(text)); }
+
+    // Streams a source file as a section: a UTF-8 BOM is dropped, line endings
+    // become '\n' and a missing final newline is added. With a syntax, comments
+    // are stripped too, and savings gets the sizes before and after. Nothing is
+    // written and false is returned if the file cannot be opened.
+    bool AppendTextFile(const std::string& path, std::string_view header = std::string_view(),
+                        std::string_view label = std::string_view(),
+                        CommentStripper::Syntax strip = CommentStripper::Syntax::None,
+                        CommentStripper::Savings* savings = nullptr);
+
+    bool Commit();
+    void Discard();
+
+    bool HasFailed() const { return m_failed; }
+    uint64_t GetBytesWritten() const { return m_bytesWritten; }
+    // What ended up on disk, once committed; the same as GetBytesWritten() without compression
+    uint64_t GetBytesStored() const { return m_compression == BlockCompressor::Format::None ? m_bytesWritten : m_compressedBytes; }
+    unsigned GetPartCount() const { return m_split.partBudget > 0 ? m_partNumber : 1; }
+    // Where a part (from 1) is written. With a part budget that is always a numbered
+    // name, even for an export that fits in one part; without, the path given to Open().
+    std::string GetPartPath(unsigned number) const;
+
+private:
+    bool OpenFile(const std::string& path);
+    void CloseFile();
+    void FlushBuffer();
+    void WriteOut(const char* data, size_t size); // to the file, through the compressor if there is one
+
+    // --- Splitting ---
+    void BeginSection(std::string_view label, std::string_view header, uint64_t contentCost, bool costKnown);
+    void WriteSectionText(std::string_view text, uint64_t cost);
+    void WriteSectionHeader();
+    void WritePartTrailer(bool lastPart);
+    // Budget still needed by the current section besides its text; the trailer
+    // is reserved before anything goes in, so a part never ends over budget
+    void UpdateOverhead();
+    uint64_t GetPendingCost() const;
+    std::string FormatPartHeader(std::string_view label, bool continued) const;
+    // The "continued in" form, which is the longer one, is what gets reserved
+    std::string FormatPartTrailer(std::string_view first, std::string_view last, bool lastPart = false) const;
+    bool NextPart();
+
+    std::vector<char> m_buffer;
+    size_t m_used;
+    std::ofstream m_file;
+    std::string m_path;
+    std::string m_tempPath;
+    uint64_t m_bytesWritten;
+    bool m_failed;
+    BlockCompressor::Format m_compression;
+    int m_compressionLevel;
+    std::unique_ptr<BlockCompressor> m_compressor; // of the open file
+    uint64_t m_compressedBytes;                    // of the closed files
+
+    SplitOptions m_split;
+    std::string m_basePath;                 // as given to Open(); parts are named after it
+    std::vector<std::string> m_closedParts; // finished files, still under their temporary names
+    unsigned m_partNumber;
+    uint64_t m_partCost;
+    uint64_t m_partHeaderCost; // of the current part, or of the one about to start
+    uint64_t m_trailerCost;    // of the current part's trailer, if the current section is its last
+    bool m_partStarted;     // the part header has been written
+    bool m_partHasText;     // section text (not only headers) went into the current part
+    std::string m_partFirst; // label of the section the current part starts with
+    std::string m_sectionLabel;
+    std::string m_sectionHeader; // held back until the section's first line, and repeated in the next part
+    uint64_t m_sectionHeaderCost;
+    bool m_headerPending;
+    bool m_atLineStart;
+};
@@ -0,0 +1,35 @@
+#include "FileStamp.h"
+
+#ifdef __linux__
+#include <sys/stat.h>
+#else
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+#endif
+
+#ifdef __linux__
+bool FileStamp::Read(const std::string& fullPath, FileStamp& stamp)
+{
+    struct stat st;
+    if (stat(fullPath.c_str(), &st) != 0)
+        return false;
+    stamp.size = (uint64_t)st.st_size;
+    stamp.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+#else
+bool FileStamp::Read(const std::string& fullPath, FileStamp& stamp)
+{
+    std::error_code ec;
+    std::filesystem::path path = std::filesystem::u8path(fullPath);
+    stamp.size = (uint64_t)std::filesystem::file_size(path, ec);
+    if (ec)
+        return false;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return false;
+    stamp.mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    return true;
+}
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Size and modification time of a file: what tells a cached copy of its
+// contents from a stale one without reading the file again.
+struct FileStamp
+{
+    uint64_t size = 0;
+    int64_t mtime = 0; // ns
+
+    // One stat, without opening the file
+    static bool Read(const std::string& fullPath, FileStamp& stamp);
+
+    bool operator==(const FileStamp& other) const { return size == other.size && mtime == other.mtime; }
+    bool operator!=(const FileStamp& other) const { return !(*this == other); }
+};
@@ -0,0 +1,297 @@
+#include "FileTypeRegistry.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    const char* DEFAULT_FILE_TYPES =
+        "[.cpp / .c]\n"   "extensions = cpp c\n"     "lexer = cpp\n"        "presets = default\n" "enabled = true\n"
+        "[.h / .hpp]\n"   "extensions = h hpp\n"     "lexer = cpp\n"        "presets = default\n" "enabled = true\n"
+        "[.py]\n"         "extensions = py\n"        "lexer = python\n"     "presets = default\n" "enabled = true\n"
+        "[.js]\n"         "extensions = js\n"        "lexer = javascript\n" "presets = default node\n" "enabled = true\n"
+        "[.html]\n"       "extensions = html wxml\n" "lexer = html\n"       "presets = default\n" "enabled = true\n"
+        "[.css]\n"        "extensions = css wxss\n"  "lexer = css\n"        "presets = default\n" "enabled = true\n"
+        "[.json]\n"       "extensions = json\n"      "lexer = json\n"       "presets = default godot unity node\n" "enabled = true\n"
+        "[.md]\n"         "extensions = md\n"        "lexer = markdown\n"   "presets = default node\n" "enabled = true\n"
+        "[.gd]\n"         "extensions = gd\n"        "lexer = python\n"     "presets = godot\n"   "enabled = true\n"
+        "[.tscn]\n"       "extensions = tscn\n"      "lexer = xml\n"        "presets = godot\n"   "enabled = false\n"
+        "[.tres]\n"       "extensions = tres\n"      "lexer = xml\n"        "presets = godot\n"   "enabled = false\n"
+        "[.res]\n"        "extensions = res\n"       "lexer = xml\n"        "presets = godot\n"   "enabled = false\n"
+        "[.cs]\n"         "extensions = cs\n"        "lexer = cpp\n"        "presets = unity\n"   "enabled = true\n"
+        "[.shader]\n"     "extensions = shader\n"    "lexer = cpp\n"        "presets = godot unity\n" "enabled = true\n"
+        "[.unity]\n"      "extensions = unity\n"     "lexer = xml\n"        "presets = unity\n"   "enabled = false\n"
+        "[.prefab]\n"     "extensions = prefab\n"    "lexer = xml\n"        "presets = unity\n"   "enabled = false\n"
+        "[.ts]\n"         "extensions = ts\n"        "lexer = javascript\n" "presets = node\n"    "enabled = true\n"
+        "[.mjs]\n"        "extensions = mjs\n"       "lexer = javascript\n" "presets = node\n"    "enabled = true\n"
+        "[.cjs]\n"        "extensions = cjs\n"       "lexer = javascript\n" "presets = node\n"    "enabled = true\n"
+        "[XML]\n"         "extensions = xml csproj\n" "lexer = xml\n"       "filter = false\n";
+
+    inline char ToLowerAscii(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    }
+
+    std::string_view Trim(std::string_view text)
+    {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+            text.remove_prefix(1);
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r'))
+            text.remove_suffix(1);
+        return text;
+    }
+
+    std::vector<std::string> SplitWords(std::string_view text)
+    {
+        std::vector<std::string> words;
+        size_t start = 0;
+        while (start < text.size())
+        {
+            size_t end = text.find_first_of(" \t,", start);
+            if (end == std::string_view::npos)
+                end = text.size();
+            if (end > start)
+            {
+                std::string word(text.substr(start, end - start));
+                if (!word.empty() && word[0] == '.')
+                    word.erase(0, 1);
+                for (char& c : word)
+                    c = ToLowerAscii(c);
+                if (!word.empty())
+                    words.push_back(std::move(word));
+            }
+            start = end + 1;
+        }
+        return words;
+    }
+
+    bool ParseBool(std::string_view value)
+    {
+        return value == "true" || value == "yes" || value == "1" || value == "on";
+    }
+}
+
+// --- ExtensionTable ---
+
+bool ExtensionTable::PackKey(std::string_view extension, uint64_t& key)
+{
+    if (extension.empty() || extension.size() > 8)
+        return false;
+
+    key = 0;
+    for (size_t i = 0; i < extension.size(); ++i)
+        key |= (uint64_t)(unsigned char)ToLowerAscii(extension[i]) << (i * 8);
+    return true;
+}
+
+void ExtensionTable::Add(std::string_view extension, int value)
+{
+    uint64_t key;
+    if (!PackKey(extension, key))
+    {
+        if (extension.empty())
+            return;
+        std::string lower(extension);
+        for (char& c : lower)
+            c = ToLowerAscii(c);
+        m_longExtensions.emplace_back(std::move(lower), value);
+        return;
+    }
+
+    if ((m_count + 1) * 2 > m_slots.size())
+        Grow();
+
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = (key * 0x9E3779B97F4A7C15ull) >> 40 & mask;; i = (i + 1) & mask)
+    {
+        if (m_slots[i].key == key)
+            return; // first registration wins
+        if (m_slots[i].key == 0)
+        {
+            m_slots[i] = Slot{ key, value };
+            ++m_count;
+            return;
+        }
+    }
+}
+
+void ExtensionTable::Clear()
+{
+    m_slots.clear();
+    m_count = 0;
+    m_longExtensions.clear();
+}
+
+void ExtensionTable::Grow()
+{
+    std::vector<Slot> old = std::move(m_slots);
+    m_slots.assign(old.empty() ? 32 : old.size() * 2, Slot());
+    m_count = 0;
+
+    size_t mask = m_slots.size() - 1;
+    for (const Slot& slot : old)
+    {
+        if (slot.key == 0)
+            continue;
+        size_t i = (slot.key * 0x9E3779B97F4A7C15ull) >> 40 & mask;
+        while (m_slots[i].key != 0)
+            i = (i + 1) & mask;
+        m_slots[i] = slot;
+        ++m_count;
+    }
+}
+
+int ExtensionTable::Find(std::string_view extension) const
+{
+    uint64_t key;
+    if (!PackKey(extension, key))
+    {
+        for (const auto& entry : m_longExtensions)
+        {
+            if (entry.first.size() != extension.size())
+                continue;
+            bool same = true;
+            for (size_t i = 0; same && i < extension.size(); ++i)
+                same = entry.first[i] == ToLowerAscii(extension[i]);
+            if (same)
+                return entry.second;
+        }
+        return -1;
+    }
+
+    if (m_count == 0)
+        return -1;
+
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = (key * 0x9E3779B97F4A7C15ull) >> 40 & mask;; i = (i + 1) & mask)
+    {
+        if (m_slots[i].key == key)
+            return m_slots[i].value;
+        if (m_slots[i].key == 0)
+            return -1;
+    }
+}
+
+int ExtensionTable::FindForFileName(std::string_view fileName) const
+{
+    std::string_view extension = GetExtension(fileName);
+    return extension.empty() ? -1 : Find(extension);
+}
+
+std::string_view ExtensionTable::GetExtension(std::string_view fileName)
+{
+    size_t dot = fileName.rfind('.');
+    if (dot == std::string_view::npos || dot == 0)
+        return std::string_view(); // no extension, or a dotfile like ".gitignore"
+    return fileName.substr(dot + 1);
+}
+
+// --- FileTypeRegistry ---
+
+FileTypeRegistry FileTypeRegistry::CreateDefault()
+{
+    return Parse(DEFAULT_FILE_TYPES);
+}
+
+FileTypeRegistry FileTypeRegistry::Parse(std::string_view text)
+{
+    FileTypeRegistry registry;
+    FileType* current = nullptr;
+
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find('\n', start);
+        if (end == std::string_view::npos)
+            end = text.size();
+        std::string_view line = Trim(text.substr(start, end - start));
+        start = end + 1;
+
+        if (line.empty() || line[0] == '#' || line[0] == ';')
+            continue;
+
+        if (line.front() == '[' && line.back() == ']')
+        {
+            registry.m_types.emplace_back();
+            current = &registry.m_types.back();
+            current->label = std::string(Trim(line.substr(1, line.size() - 2)));
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (!current || equals == std::string_view::npos)
+            continue;
+
+        std::string_view key = Trim(line.substr(0, equals));
+        std::string_view value = Trim(line.substr(equals + 1));
+        if (key == "extensions")
+            current->extensions = SplitWords(value);
+        else if (key == "lexer")
+            current->lexer = std::string(value);
+        else if (key == "presets")
+            current->presets = SplitWords(value);
+        else if (key == "enabled")
+            current->enabled = ParseBool(value);
+        else if (key == "filter")
+            current->filter = ParseBool(value);
+    }
+
+    registry.Index();
+    return registry;
+}
+
+bool FileTypeRegistry::LoadFile(const std::string& path)
+{
+    std::ifstream file(std::filesystem::u8path(path), std::ios::binary);
+    if (!file)
+        return false;
+
+    std::ostringstream text;
+    text << file.rdbuf();
+    FileTypeRegistry loaded = Parse(text.str());
+    if (loaded.m_types.empty())
+        return false;
+
+    *this = std::move(loaded);
+    return true;
+}
+
+void FileTypeRegistry::Index()
+{
+    m_lookup.Clear();
+    for (size_t i = 0; i < m_types.size(); ++i)
+    {
+        for (const std::string& extension : m_types[i].extensions)
+            m_lookup.Add(extension, (int)i);
+    }
+}
+
+const FileType* FileTypeRegistry::FindForFileName(std::string_view fileName) const
+{
+    int index = m_lookup.FindForFileName(fileName);
+    return index < 0 ? nullptr : &m_types[index];
+}
+
+bool FileTypeRegistry::IsInPreset(size_t index, std::string_view preset) const
+{
+    for (const std::string& name : m_types[index].presets)
+    {
+        if (name == preset)
+            return true;
+    }
+    return false;
+}
+
+ExtensionTable FileTypeRegistry::BuildExtensionTable(const std::vector<bool>& enabledTypes) const
+{
+    ExtensionTable table;
+    for (size_t i = 0; i < m_types.size() && i < enabledTypes.size(); ++i)
+    {
+        if (!enabledTypes[i] || !m_types[i].filter)
+            continue;
+        for (const std::string& extension : m_types[i].extensions)
+            table.Add(extension, (int)i);
+    }
+    return table;
+}
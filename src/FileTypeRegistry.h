@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Maps file extensions to a value (a file type index) with one probe of a flat
+// table. Extensions of up to 8 bytes are packed, lowercased, into a 64-bit key,
+// so lookups never allocate; longer ones fall back to a short list.
+class ExtensionTable
+{
+public:
+    void Add(std::string_view extension, int value);
+    void Clear();
+    bool IsEmpty() const { return m_count == 0 && m_longExtensions.empty(); }
+
+    // Both return -1 when there is no entry
+    int Find(std::string_view extension) const;
+    int FindForFileName(std::string_view fileName) const;
+
+    // The extension of a file name, or an empty view ("README", ".gitignore")
+    static std::string_view GetExtension(std::string_view fileName);
+
+private:
+    struct Slot
+    {
+        uint64_t key = 0; // 0 marks an empty slot; packed keys are never 0
+        int value = -1;
+    };
+
+    static bool PackKey(std::string_view extension, uint64_t& key);
+    void Grow();
+
+    std::vector<Slot> m_slots;
+    size_t m_count = 0;
+    std::vector<std::pair<std::string, int>> m_longExtensions;
+};
+
+// One language or file type: the checkbox it appears as, the extensions it
+// covers, the editor lexer used to preview it and the presets that enable it.
+struct FileType
+{
+    std::string label;
+    std::vector<std::string> extensions;
+    std::string lexer;              // "cpp", "python", "javascript", "html", "css", "json", "markdown", "xml"
+    std::vector<std::string> presets; // "default", "godot", "unity", "node"
+    bool enabled = true;            // initial checkbox state
+    bool filter = true;             // false: only used for syntax highlighting
+};
+
+// The table of known file types, read from a languages.conf file:
+//
+//   [.cpp / .c]
+//   extensions = cpp c
+//   lexer = cpp
+//   presets = default
+//   enabled = true
+//
+// Built-in defaults are used when no file is present.
+class FileTypeRegistry
+{
+public:
+    static FileTypeRegistry CreateDefault();
+    static FileTypeRegistry Parse(std::string_view text);
+
+    // Returns false (and leaves the registry unchanged) if the file is missing or defines no types
+    bool LoadFile(const std::string& path);
+
+    const std::vector<FileType>& GetTypes() const { return m_types; }
+    const FileType* FindForFileName(std::string_view fileName) const;
+    bool IsInPreset(size_t index, std::string_view preset) const;
+
+    // Table of the extensions of the given types, for the scanner threads
+    ExtensionTable BuildExtensionTable(const std::vector<bool>& enabledTypes) const;
+
+private:
+    void Index();
+
+    std::vector<FileType> m_types;
+    ExtensionTable m_lookup;
+};
@@ -0,0 +1,508 @@
+#include "IgnoreMatcher.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+    inline int CountTrailingZeros(uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return (int)index;
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+
+    inline uint64_t HashBytes(std::string_view key)
+    {
+        uint64_t hash = 1469598103934665603ull; // FNV-1a
+        for (unsigned char c : key)
+        {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Reads one "[...]" expression starting at p[i] == '['. Returns false if it is
+    // not terminated, in which case the '[' is taken literally.
+    bool ParseBracket(std::string_view p, size_t& i, std::bitset<256>& chars)
+    {
+        size_t j = i + 1;
+        bool negate = false;
+        if (j < p.size() && (p[j] == '!' || p[j] == '^'))
+        {
+            negate = true;
+            ++j;
+        }
+
+        std::bitset<256> set;
+        bool first = true;
+        while (j < p.size())
+        {
+            unsigned char c = (unsigned char)p[j];
+            if (c == ']' && !first)
+            {
+                if (negate)
+                    set.flip();
+                set.reset('/');
+                chars = set;
+                i = j + 1;
+                return true;
+            }
+            first = false;
+
+            if (c == '[' && j + 1 < p.size() && p[j + 1] == ':')
+            {
+                size_t close = p.find(":]", j + 2);
+                if (close != std::string_view::npos)
+                {
+                    std::string_view name = p.substr(j + 2, close - j - 2);
+                    for (int ch = 0; ch < 256; ++ch)
+                    {
+                        bool match = (name == "alpha" && isalpha(ch)) || (name == "digit" && isdigit(ch))
+                                  || (name == "alnum" && isalnum(ch)) || (name == "upper" && isupper(ch))
+                                  || (name == "lower" && islower(ch)) || (name == "space" && isspace(ch))
+                                  || (name == "punct" && ispunct(ch)) || (name == "xdigit" && isxdigit(ch));
+                        if (match && ch < 128)
+                            set.set(ch);
+                    }
+                    j = close + 2;
+                    continue;
+                }
+            }
+
+            if (c == '\\' && j + 1 < p.size())
+                c = (unsigned char)p[++j];
+
+            unsigned char high = c;
+            if (j + 2 < p.size() && p[j + 1] == '-' && p[j + 2] != ']')
+            {
+                j += 2;
+                high = (unsigned char)p[j];
+                if (high == '\\' && j + 1 < p.size())
+                    high = (unsigned char)p[++j];
+            }
+            for (unsigned ch = c; ch <= high; ++ch)
+                set.set(ch);
+            ++j;
+        }
+        return false;
+    }
+}
+
+// --- LiteralTable ---
+
+void IgnoreMatcher::LiteralTable::Add(std::string_view key, int rule, bool dirOnly)
+{
+    if ((m_count + 1) * 2 > m_slots.size())
+        Grow();
+
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = HashBytes(key) & mask;; i = (i + 1) & mask)
+    {
+        Slot& slot = m_slots[i];
+        if (slot.key.empty())
+        {
+            slot.key = std::string(key);
+            ++m_count;
+        }
+        else if (slot.key != key)
+        {
+            continue;
+        }
+
+        int& target = dirOnly ? slot.dirRule : slot.anyRule;
+        target = std::max(target, rule);
+        return;
+    }
+}
+
+int IgnoreMatcher::LiteralTable::Find(std::string_view key, bool isDir) const
+{
+    if (m_count == 0 || key.empty())
+        return -1;
+
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = HashBytes(key) & mask;; i = (i + 1) & mask)
+    {
+        const Slot& slot = m_slots[i];
+        if (slot.key.empty())
+            return -1;
+        if (slot.key == key)
+            return isDir ? std::max(slot.anyRule, slot.dirRule) : slot.anyRule;
+    }
+}
+
+void IgnoreMatcher::LiteralTable::Grow()
+{
+    std::vector<Slot> old = std::move(m_slots);
+    m_slots.assign(old.empty() ? 16 : old.size() * 2, Slot());
+    m_count = 0;
+
+    size_t mask = m_slots.size() - 1;
+    for (Slot& slot : old)
+    {
+        if (slot.key.empty())
+            continue;
+        size_t i = HashBytes(slot.key) & mask;
+        while (!m_slots[i].key.empty())
+            i = (i + 1) & mask;
+        m_slots[i] = std::move(slot);
+        ++m_count;
+    }
+}
+
+// --- GlobAutomaton ---
+
+void IgnoreMatcher::GlobAutomaton::AddRule(const std::vector<Token>& tokens, int rule, bool dirOnly)
+{
+    m_pending.push_back(PendingRule{ tokens, rule, dirOnly });
+}
+
+void IgnoreMatcher::GlobAutomaton::Finish()
+{
+    m_stateCount = 0;
+    for (const PendingRule& pending : m_pending)
+        m_stateCount += pending.tokens.size() + 1;
+    if (m_stateCount == 0)
+        return;
+
+    m_words = (m_stateCount + 63) / 64;
+    m_consume.assign(256 * m_words, 0);
+    m_loop.assign(256 * m_words, 0);
+    m_skipOne.assign(m_words, 0);
+    m_skipDirs.assign(m_words, 0);
+    m_initial.assign(m_words, 0);
+    m_finalAny.assign(m_words, 0);
+    m_finalFiles.assign(m_words, 0);
+    m_stateRule.assign(m_stateCount, -1);
+
+    auto setBit = [](std::vector<uint64_t>& bits, size_t offset, size_t state) {
+        bits[offset + state / 64] |= 1ull << (state % 64);
+    };
+
+    size_t state = 0;
+    for (const PendingRule& pending : m_pending)
+    {
+        setBit(m_initial, 0, state);
+        for (const Token& token : pending.tokens)
+        {
+            for (int c = 0; c < 256; ++c)
+            {
+                if (token.kind == Token::One && token.chars.test(c))
+                    setBit(m_consume, c * m_words, state);
+                else if (token.kind == Token::Star && c != '/')
+                    setBit(m_loop, c * m_words, state);
+                else if (token.kind == Token::DoubleStar)
+                    setBit(m_loop, c * m_words, state);
+            }
+            if (token.kind == Token::Star || token.kind == Token::DoubleStar)
+                setBit(m_skipOne, 0, state);
+            if (token.skipsDirs)
+                setBit(m_skipDirs, 0, state);
+            ++state;
+        }
+
+        setBit(m_finalAny, 0, state);
+        if (!pending.dirOnly)
+            setBit(m_finalFiles, 0, state);
+        m_stateRule[state] = pending.rule;
+        ++state;
+    }
+
+    m_pending.clear();
+    m_pending.shrink_to_fit();
+}
+
+void IgnoreMatcher::GlobAutomaton::Closure(uint64_t* states) const
+{
+    // Follow epsilon moves (stars matching nothing) until nothing new is reached.
+    // Words are visited high to low so the carry reads a not-yet-updated word.
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t w = m_words; w-- > 0;)
+        {
+            uint64_t one = states[w] & m_skipOne[w];
+            uint64_t dirs = states[w] & m_skipDirs[w];
+            uint64_t reached = (one << 1) | (dirs << 3);
+            if (w > 0)
+            {
+                reached |= (states[w - 1] & m_skipOne[w - 1]) >> 63;
+                reached |= (states[w - 1] & m_skipDirs[w - 1]) >> 61;
+            }
+            if (reached & ~states[w])
+            {
+                states[w] |= reached;
+                changed = true;
+            }
+        }
+    }
+}
+
+int IgnoreMatcher::GlobAutomaton::Match(std::string_view text, bool isDir) const
+{
+    if (m_stateCount == 0)
+        return -1;
+
+    // Grows once per thread to the largest automaton seen, then never allocates again
+    thread_local std::vector<uint64_t> scratch;
+    if (scratch.size() < m_words * 2)
+        scratch.resize(m_words * 2);
+    uint64_t* current = scratch.data();
+    uint64_t* next = current + m_words;
+
+    std::copy(m_initial.begin(), m_initial.end(), current);
+    Closure(current);
+
+    for (unsigned char c : text)
+    {
+        const uint64_t* consume = &m_consume[c * m_words];
+        const uint64_t* loop = &m_loop[c * m_words];
+
+        uint64_t any = 0;
+        uint64_t carry = 0;
+        for (size_t w = 0; w < m_words; ++w)
+        {
+            uint64_t advanced = current[w] & consume[w];
+            next[w] = (advanced << 1) | carry | (current[w] & loop[w]);
+            carry = advanced >> 63;
+            any |= next[w];
+        }
+        if (!any)
+            return -1;
+
+        std::swap(current, next);
+        Closure(current);
+    }
+
+    const std::vector<uint64_t>& finals = isDir ? m_finalAny : m_finalFiles;
+    int best = -1;
+    for (size_t w = 0; w < m_words; ++w)
+    {
+        uint64_t bits = current[w] & finals[w];
+        while (bits)
+        {
+            best = std::max(best, m_stateRule[w * 64 + CountTrailingZeros(bits)]);
+            bits &= bits - 1;
+        }
+    }
+    return best;
+}
+
+// --- IgnoreMatcher ---
+
+IgnoreMatcher IgnoreMatcher::Compile(std::string_view text)
+{
+    IgnoreMatcher matcher;
+    size_t start = 0;
+    while (start <= text.size())
+    {
+        size_t end = text.find('\n', start);
+        if (end == std::string_view::npos)
+            end = text.size();
+        matcher.AddRule(text.substr(start, end - start));
+        start = end + 1;
+    }
+    matcher.m_nameGlobs.Finish();
+    matcher.m_pathGlobs.Finish();
+    return matcher;
+}
+
+void IgnoreMatcher::AddRule(std::string_view pattern)
+{
+    using Token = GlobAutomaton::Token;
+
+    if (!pattern.empty() && pattern.back() == '\r')
+        pattern.remove_suffix(1);
+    if (pattern.empty() || pattern[0] == '#')
+        return;
+
+    // Trailing spaces are dropped unless escaped with a backslash
+    while (!pattern.empty() && pattern.back() == ' '
+           && !(pattern.size() >= 2 && pattern[pattern.size() - 2] == '\\'))
+        pattern.remove_suffix(1);
+
+    bool negated = false;
+    if (!pattern.empty() && pattern[0] == '!')
+    {
+        negated = true;
+        pattern.remove_prefix(1);
+    }
+
+    bool dirOnly = false;
+    if (!pattern.empty() && pattern.back() == '/')
+    {
+        dirOnly = true;
+        pattern.remove_suffix(1);
+    }
+
+    // A slash at the start or in the middle anchors the rule to the rule's directory
+    bool anchored = pattern.find('/') != std::string_view::npos;
+    if (!pattern.empty() && pattern[0] == '/')
+        pattern.remove_prefix(1);
+    if (pattern.empty())
+        return;
+
+    std::vector<Token> tokens;
+    std::string literal;
+    bool isLiteral = true;
+
+    auto pushChar = [&](unsigned char c) {
+        Token token{ Token::One, {}, false };
+        token.chars.set(c);
+        tokens.push_back(token);
+        literal += (char)c;
+    };
+
+    for (size_t i = 0; i < pattern.size();)
+    {
+        char c = pattern[i];
+        if (c == '\\')
+        {
+            if (i + 1 < pattern.size())
+                pushChar((unsigned char)pattern[i + 1]);
+            i += 2;
+        }
+        else if (c == '*')
+        {
+            size_t end = i;
+            while (end < pattern.size() && pattern[end] == '*')
+                ++end;
+
+            bool doubleStar = end - i >= 2 && (i == 0 || pattern[i - 1] == '/')
+                              && (end == pattern.size() || pattern[end] == '/');
+            if (doubleStar && end < pattern.size())
+            {
+                // "**/" is "(one or more of anything, then '/')" or nothing at all.
+                // It needs its own entry state: skipping from the looping state
+                // would let "**/b" match "lib".
+                Token first{ Token::One, {}, true };
+                first.chars.set();
+                tokens.push_back(first);
+                tokens.push_back(Token{ Token::DoubleStar, {}, false });
+                pushChar('/');
+                i = end + 1;
+            }
+            else if (doubleStar)
+            {
+                tokens.push_back(Token{ Token::DoubleStar, {}, false });
+                i = end;
+            }
+            else
+            {
+                if (tokens.empty() || tokens.back().kind != Token::Star)
+                    tokens.push_back(Token{ Token::Star, {}, false });
+                i = end;
+            }
+            isLiteral = false;
+        }
+        else if (c == '?')
+        {
+            Token token{ Token::One, {}, false };
+            token.chars.set();
+            token.chars.reset('/');
+            tokens.push_back(token);
+            isLiteral = false;
+            ++i;
+        }
+        else if (c == '[')
+        {
+            Token token{ Token::One, {}, false };
+            if (ParseBracket(pattern, i, token.chars))
+            {
+                tokens.push_back(token);
+                isLiteral = false;
+            }
+            else
+            {
+                pushChar('[');
+                ++i;
+            }
+        }
+        else
+        {
+            pushChar((unsigned char)c);
+            ++i;
+        }
+    }
+
+    int rule = (int)m_ruleNegated.size();
+    m_ruleNegated.push_back(negated);
+
+    if (isLiteral)
+    {
+        (anchored ? m_paths : m_names).Add(literal, rule, dirOnly);
+        return;
+    }
+
+    // "*.ext" and "*.png.import": a leading star followed by a literal starting with '.'
+    bool suffixOnly = !anchored && tokens.size() > 1 && tokens[0].kind == Token::Star;
+    for (size_t i = 1; suffixOnly && i < tokens.size(); ++i)
+        suffixOnly = tokens[i].kind == Token::One && tokens[i].chars.count() == 1;
+    if (suffixOnly && tokens[1].chars.test('.'))
+    {
+        std::string suffix;
+        for (size_t i = 1; i < tokens.size(); ++i)
+        {
+            for (int c = 0; c < 256; ++c)
+            {
+                if (tokens[i].chars.test(c))
+                    suffix += (char)c;
+            }
+        }
+        m_suffixes.Add(suffix, rule, dirOnly);
+        return;
+    }
+
+    (anchored ? m_pathGlobs : m_nameGlobs).AddRule(tokens, rule, dirOnly);
+}
+
+IgnoreMatcher::Result IgnoreMatcher::Match(std::string_view relativePath, bool isDir) const
+{
+    if (m_ruleNegated.empty())
+        return Result::None;
+
+    size_t slash = relativePath.rfind('/');
+    std::string_view name = slash == std::string_view::npos ? relativePath : relativePath.substr(slash + 1);
+
+    int best = std::max(m_names.Find(name, isDir), m_paths.Find(relativePath, isDir));
+    if (!m_suffixes.IsEmpty())
+    {
+        for (size_t dot = name.find('.'); dot != std::string_view::npos; dot = name.find('.', dot + 1))
+            best = std::max(best, m_suffixes.Find(name.substr(dot), isDir));
+    }
+    best = std::max(best, m_nameGlobs.Match(name, isDir));
+    best = std::max(best, m_pathGlobs.Match(relativePath, isDir));
+
+    if (best < 0)
+        return Result::None;
+    return m_ruleNegated[best] ? Result::Included : Result::Ignored;
+}
+
+// --- IgnoreScope ---
+
+IgnoreMatcher::Result IgnoreScope::Match(std::string_view relativePath, bool isDir) const
+{
+    for (const IgnoreScope* scope = this; scope; scope = scope->parent.get())
+    {
+        std::string_view local = relativePath;
+        if (!scope->basePath.empty())
+        {
+            if (local.size() <= scope->basePath.size() || local.compare(0, scope->basePath.size(), scope->basePath) != 0
+                || local[scope->basePath.size()] != '/')
+                continue;
+            local.remove_prefix(scope->basePath.size() + 1);
+        }
+
+        IgnoreMatcher::Result result = scope->matcher.Match(local, isDir);
+        if (result != IgnoreMatcher::Result::None)
+            return result;
+    }
+    return IgnoreMatcher::Result::None;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A set of ignore rules with .gitignore semantics, compiled once and matched
+// against relative paths without allocating:
+//   - literal names ("node_modules") and literal paths ("/build") are hash lookups,
+//   - "*.ext" style rules are a suffix table probed at each '.' of the name,
+//   - every remaining glob is part of one bit-parallel automaton that runs all
+//     of them over the input in a single pass.
+// Supports "#" comments, "!" negation, trailing "/" for directories, leading or
+// inner "/" anchoring, "**", "?", "[...]" classes and backslash escapes.
+// As in git, the last matching rule wins.
+class IgnoreMatcher
+{
+public:
+    enum class Result { None, Ignored, Included };
+
+    IgnoreMatcher() = default;
+
+    // Compiles newline-separated rules (the contents of a .gitignore file)
+    static IgnoreMatcher Compile(std::string_view text);
+
+    // relativePath uses '/' separators and is relative to the directory the rules belong to.
+    // Included means a "!" rule matched last; None means no rule matched at all.
+    Result Match(std::string_view relativePath, bool isDir) const;
+    bool IsIgnored(std::string_view relativePath, bool isDir) const { return Match(relativePath, isDir) == Result::Ignored; }
+
+    bool IsEmpty() const { return m_ruleNegated.empty(); }
+    size_t GetRuleCount() const { return m_ruleNegated.size(); }
+
+private:
+    // Open-addressing table from a literal (name, path or suffix) to the last
+    // rule that matches it, kept separately for "any entry" and "directories only".
+    class LiteralTable
+    {
+    public:
+        void Add(std::string_view key, int rule, bool dirOnly);
+        int Find(std::string_view key, bool isDir) const;
+        bool IsEmpty() const { return m_count == 0; }
+
+    private:
+        struct Slot
+        {
+            std::string key;
+            int anyRule = -1;
+            int dirRule = -1;
+        };
+
+        void Grow();
+
+        std::vector<Slot> m_slots;
+        size_t m_count = 0;
+    };
+
+    // All glob rules of one kind (name or path) as a single NFA simulated with
+    // bitsets: each rule is a run of states, and one step advances every rule.
+    class GlobAutomaton
+    {
+    public:
+        struct Token
+        {
+            enum Kind { One, Star, DoubleStar } kind;
+            std::bitset<256> chars; // accepted bytes for One
+            bool skipsDirs;         // first token of "**/": the whole group may match nothing
+        };
+
+        void AddRule(const std::vector<Token>& tokens, int rule, bool dirOnly);
+        void Finish();
+        int Match(std::string_view text, bool isDir) const;
+        bool IsEmpty() const { return m_stateCount == 0; }
+
+    private:
+        void Closure(uint64_t* states) const;
+
+        struct PendingRule
+        {
+            std::vector<Token> tokens;
+            int rule;
+            bool dirOnly;
+        };
+
+        std::vector<PendingRule> m_pending;
+        size_t m_stateCount = 0;
+        size_t m_words = 0;
+        std::vector<uint64_t> m_consume;   // [byte][word]: state advances on byte
+        std::vector<uint64_t> m_loop;      // [byte][word]: state stays on byte (stars)
+        std::vector<uint64_t> m_skipOne;   // epsilon to the next state
+        std::vector<uint64_t> m_skipDirs;  // epsilon over the three tokens of "**/"
+        std::vector<uint64_t> m_initial;
+        std::vector<uint64_t> m_finalAny;
+        std::vector<uint64_t> m_finalFiles; // excludes directory-only rules
+        std::vector<int> m_stateRule;
+    };
+
+    void AddRule(std::string_view pattern);
+
+    std::vector<bool> m_ruleNegated;
+    LiteralTable m_names;
+    LiteralTable m_paths;
+    LiteralTable m_suffixes;
+    GlobAutomaton m_nameGlobs;
+    GlobAutomaton m_pathGlobs;
+};
+
+// The .gitignore rules in effect inside one directory: the directory's own
+// file on top of everything inherited from its parents. Scopes are shared
+// between directories, so a subtree without its own .gitignore costs nothing.
+struct IgnoreScope
+{
+    std::shared_ptr<const IgnoreScope> parent;
+    std::string basePath; // directory the rules belong to, relative to the project root
+    IgnoreMatcher matcher;
+
+    // Innermost rules first; the first scope with a matching rule decides
+    IgnoreMatcher::Result Match(std::string_view relativePath, bool isDir) const;
+};
@@ -0,0 +1,67 @@
+#include "JobProgress.h"
+
+#include <chrono>
+#include <cstdio>
+
+void JobProgress::Reset()
+{
+    m_cancelled = false;
+    StartPhase("");
+}
+
+void JobProgress::StartPhase(const char* phase, uint64_t itemsTotal)
+{
+    m_items = 0;
+    m_bytes = 0;
+    m_itemsTotal = itemsTotal;
+    m_phaseStart = Now();
+    m_phase = phase;
+}
+
+JobProgress::Snapshot JobProgress::GetSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.phase = m_phase;
+    snapshot.items = m_items;
+    snapshot.itemsTotal = m_itemsTotal;
+    snapshot.bytes = m_bytes;
+    snapshot.seconds = (Now() - m_phaseStart) / 1e9;
+
+    // Too early an estimate swings wildly, so there is none for the first half second
+    if (snapshot.itemsTotal > 0 && snapshot.items > 0 && snapshot.seconds >= 0.5)
+    {
+        uint64_t left = snapshot.itemsTotal > snapshot.items ? snapshot.itemsTotal - snapshot.items : 0;
+        snapshot.secondsLeft = snapshot.seconds * (double)left / (double)snapshot.items;
+    }
+    return snapshot;
+}
+
+std::string JobProgress::Format(const Snapshot& snapshot, const char* itemName)
+{
+    char buffer[64];
+    if (snapshot.itemsTotal > 0)
+        std::snprintf(buffer, sizeof(buffer), "%llu/%llu ", (unsigned long long)snapshot.items, (unsigned long long)snapshot.itemsTotal);
+    else
+        std::snprintf(buffer, sizeof(buffer), "%llu ", (unsigned long long)snapshot.items);
+    std::string text = buffer;
+    text += itemName;
+    if (snapshot.bytes > 0)
+    {
+        std::snprintf(buffer, sizeof(buffer), ", %.1f MB", snapshot.bytes / (1024.0 * 1024.0));
+        text += buffer;
+    }
+    if (snapshot.secondsLeft >= 0)
+    {
+        if (snapshot.secondsLeft < 60)
+            std::snprintf(buffer, sizeof(buffer), ", about %.0f s left", snapshot.secondsLeft + 0.5);
+        else
+            std::snprintf(buffer, sizeof(buffer), ", about %.0f min left", snapshot.secondsLeft / 60 + 0.5);
+        text += buffer;
+    }
+    return text;
+}
+
+int64_t JobProgress::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
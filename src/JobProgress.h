@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Progress and cancellation of one long operation (a scan, an export), shared
+// between the threads doing the work and the one showing it. Workers add what
+// they finished and check IsCancelled() between files; the UI polls
+// GetSnapshot() at whatever rate it likes, so there is no callback per file.
+//
+// Work goes through phases ("Scanning", "Writing", ...); each one starts its
+// counters and its clock again, so the estimate of the time left only
+// extrapolates the phase it is in. A phase with no known total has no estimate.
+class JobProgress
+{
+public:
+    struct Snapshot
+    {
+        const char* phase = "";
+        uint64_t items = 0;
+        uint64_t itemsTotal = 0; // 0: not known
+        uint64_t bytes = 0;
+        double seconds = 0;      // in this phase
+        double secondsLeft = -1; // -1: no estimate yet
+    };
+
+    JobProgress() { Reset(); }
+
+    JobProgress(const JobProgress&) = delete;
+    JobProgress& operator=(const JobProgress&) = delete;
+
+    // Clears the counters and the cancel request, for another run
+    void Reset();
+    void StartPhase(const char* phase, uint64_t itemsTotal = 0);
+    void Add(uint64_t items, uint64_t bytes = 0)
+    {
+        m_items.fetch_add(items, std::memory_order_relaxed);
+        m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void Cancel() { m_cancelled = true; }
+    bool IsCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+    Snapshot GetSnapshot() const;
+
+    // "1234/5678 files, 12.3 MB, about 2 min left", with "files" as given
+    static std::string Format(const Snapshot& snapshot, const char* itemName);
+
+private:
+    static int64_t Now(); // steady clock, ns
+
+    std::atomic<const char*> m_phase;
+    std::atomic<uint64_t> m_items;
+    std::atomic<uint64_t> m_itemsTotal;
+    std::atomic<uint64_t> m_bytes;
+    std::atomic<int64_t> m_phaseStart;
+    std::atomic<bool> m_cancelled;
+};
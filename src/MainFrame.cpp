@@ -4,92 +4,72 @@
 #include <wx/textfile.h> // For reading text files
 #include <wx/txtstrm.h> 
 #include <wx/datetime.h> 
+#include <wx/stopwatch.h>
 
-// --- Ignore Pattern Presets ---
-
-const char* DEFAULT_IGNORE_PATTERNS =
-    ".git\n"
-    ".vscode\n"
-    "node_modules\n"
-    "*.log\n"
-    ".DS_Store\n";
-
-const char* GODOT_IGNORE_PATTERNS =
-    ".godot/\n"
-    "*.import\n"
-    ".mono/\n"
-    "export_presets.cfg\n"
-    "*.binary\n"
-    "*.rcedit\n"
-    "*.TMP\n"
-    "*.png.import\n"
-    "*.svg.import\n"
-    "*.gltf.import\n"
-    "*.glb.import\n"
-    "*.obj.import\n"
-    "*.wav.import\n"
-    "*.mp3.import\n";
-
-const char* UNITY_IGNORE_PATTERNS =
-    "[Ll]ibrary/\n"
-    "[Tt]emp/\n"
-    "[Oo]bj/\n"
-    "[Bb]uild/\n"
-    "[Bb]uilds/\n"
-    "[Ll]ogs/\n"
-    "[Mm]emoryCaptures/\n"
-    "*.pidb\n"
-    "*.suo\n"
-    "*.user\n"
-    "*.userprefs\n"
-    "*.sln\n"
-    "*.csproj\n"
-    "*.unityproj\n"
-    "*.apk\n"
-    "*.aab\n"
-    "*.unitypackage\n"
-    "*.app\n"
-    "*.exe\n"
-    "*.dll\n"
-    "*.mdb\n"
-    "*.pdb\n"
-    ".vs/\n"
-    ".vscode/\n";
-
-const char* NODE_IGNORE_PATTERNS =
-    "node_modules/\n"
-    "npm-debug.log\n"
-    "yarn-debug.log\n"
-    "yarn-error.log\n"
-    "package-lock.json\n"
-    "yarn.lock\n"
-    "pnpm-lock.yaml\n"
-    ".env\n"
-    "dist/\n"
-    "build/\n"
-    "*.log\n"
-    ".DS_Store\n"
-    ".cache/\n";
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
 
+namespace
+{
+    // Above this, previews are shown without syntax highlighting: lexing the whole file would stall the editor
+    const uint64_t kLexerSizeLimit = 4 * 1024 * 1024;
+    // Visible files on either side of the selection that are read ahead into the preview cache
+    const unsigned kPrefetchNeighbours = 2;
+
+    // Whether a node lies below one of these folders (sorted)
+    bool IsBelowAny(const ProjectModel& model, uint32_t index, const std::vector<uint32_t>& folders)
+    {
+        for (uint32_t parent = model.GetNode(index).parent; parent != ProjectModel::npos; parent = model.GetNode(parent).parent)
+        {
+            if (std::binary_search(folders.begin(), folders.end(), parent))
+                return true;
+        }
+        return false;
+    }
+}
 
 MainFrame::MainFrame(const wxString& title, const wxPoint& pos, const wxSize& size)
-    : wxFrame(NULL, wxID_ANY, title, pos, size), m_imageList(nullptr), m_projectType(ProjectType::None)
+    : wxFrame(NULL, wxID_ANY, title, pos, size), m_treeModel(nullptr), m_refilterTimer(this),
+      m_watcher([this](DirectoryWatcher::Batch batch) { CallAfter([this, batch] { ApplyWatchBatch(batch); }); }),
+      m_tokenMode(TokenCounter::Mode::Approximate), m_tokenJobCancel(false), m_tokenGeneration(0), m_tokenRecount(false),
+      m_previewGeneration(0),
+      m_rightClickedIsDir(false), m_projectType(ProjectType::None), m_scanGeneration(0), m_projectGeneration(0), m_contentGeneration(0), m_rereadPending(false), m_refilterPending(false), m_exporting(false), m_jobTimer(this)
 {
     // ... (SetupMenuBar, CreateStatusBar are unchanged)
     SetupMenuBar();
     m_statusBar = CreateStatusBar(2);
     SetStatusText("Please load a project folder.", 0);
     
-    m_imageList = new wxImageList(16, 16, true); 
-    m_imageList->Add(wxArtProvider::GetIcon(wxART_FOLDER, wxART_OTHER, wxSize(16, 16)));
-    m_imageList->Add(wxArtProvider::GetIcon(wxART_NORMAL_FILE, wxART_OTHER, wxSize(16, 16)));
-    
+    LoadFileTypes();
+    LoadTokenizer();
     CreateLayout();
     SetupEditorStyles();
     Centre();
 
     // --- ADDED: Bind Context Menu Event ---
-    Bind(wxEVT_TREE_ITEM_RIGHT_CLICK, &MainFrame::OnTreeRightClick, this, m_treeCtrl->GetId());
+    Bind(wxEVT_DATAVIEW_ITEM_CONTEXT_MENU, &MainFrame::OnTreeRightClick, this, m_treeCtrl->GetId());
+
+    Bind(wxEVT_TIMER, &MainFrame::OnRefilterTimer, this, m_refilterTimer.GetId());
+    Bind(wxEVT_TIMER, &MainFrame::OnJobTimer, this, m_jobTimer.GetId());
+    Bind(wxEVT_ACTIVATE, &MainFrame::OnActivate, this);
+    Bind(wxEVT_CLOSE_WINDOW, &MainFrame::OnClose, this);
+
+    // Runs on the scanner's worker threads: only reads the settings snapshot, never the widgets.
+    // Ignored directories are recorded but not read until a settings change un-ignores them.
+    m_scanner.SetDescendFilter(m_rules.GetDescendFilter());
+}
+
+MainFrame::~MainFrame()
+{
+    m_scanJob.Cancel();
+    m_exportJob.Cancel();
+    m_previewLoader.Cancel();
+    if (m_indexCheck.joinable())
+        m_indexCheck.join();
+    m_tokenJobCancel = true;
+    if (m_tokenJob.joinable())
+        m_tokenJob.join();
 }
 
 void MainFrame::SetupMenuBar()
@@ -98,6 +78,7 @@ void MainFrame::SetupMenuBar()
     wxMenu* menuFile = new wxMenu;
     menuFile->Append(ID_LoadProject, "&Open Project Folder...\tCtrl-O", "Load a project directory");
     menuFile->Append(ID_SaveCombined, "&Save Combined File...\tCtrl-S", "Save all filtered files into one");
+    menuFile->Append(ID_SaveChanges, "Save &Changes Since Export...\tCtrl-Shift-S", "Save only the files changed since an earlier export");
     menuFile->AppendSeparator();
     menuFile->Append(wxID_EXIT);
 
@@ -108,6 +89,8 @@ void MainFrame::SetupMenuBar()
     wxMenu* menuView = new wxMenu;
     menuView->AppendCheckItem(ID_ToggleWordWrap, "&Toggle Word Wrap\tCtrl-W", "Toggle word wrap in the editor");
     menuView->Check(ID_ToggleWordWrap, true); 
+    menuView->AppendCheckItem(ID_ExactTokens, "&Exact Token Counts", "Count tokens with the cl100k_base vocabulary instead of estimating");
+    menuView->AppendCheckItem(ID_PreviewStats, "Preview Cache &Statistics", "Show the preview cache hit rate in the status bar");
 
     wxMenu* menuHelp = new wxMenu;
     menuHelp->Append(wxID_ABOUT);
@@ -123,11 +106,14 @@ void MainFrame::SetupMenuBar()
     // --- Bind Menu Events ---
     Bind(wxEVT_MENU, &MainFrame::OnLoadProject, this, ID_LoadProject);
     Bind(wxEVT_MENU, &MainFrame::OnSaveCombined, this, ID_SaveCombined);
+    Bind(wxEVT_MENU, &MainFrame::OnSaveChanges, this, ID_SaveChanges);
     Bind(wxEVT_MENU, &MainFrame::OnExit, this, wxID_EXIT);
     Bind(wxEVT_MENU, &MainFrame::OnCopy, this, ID_Copy);
     Bind(wxEVT_MENU, &MainFrame::OnSelectAll, this, ID_SelectAll);
     Bind(wxEVT_MENU, &MainFrame::OnAbout, this, wxID_ABOUT);
     Bind(wxEVT_MENU, &MainFrame::OnToggleWordWrap, this, ID_ToggleWordWrap);
+    Bind(wxEVT_MENU, &MainFrame::OnToggleExactTokens, this, ID_ExactTokens);
+    Bind(wxEVT_MENU, &MainFrame::OnTogglePreviewStats, this, ID_PreviewStats);
 }
 
 void MainFrame::CreateLayout()
@@ -161,6 +147,9 @@ wxPanel* MainFrame::CreateLeftPanel(wxWindow* parent)
     
     m_showHiddenCheck = new wxCheckBox(settingsWin, ID_SettingsChanged, "Show Hidden Files/Folders");
     settingsSizer->Add(m_showHiddenCheck, 0, wxALL, 5);
+    m_useGitignoreCheck = new wxCheckBox(settingsWin, ID_SettingsChanged, "Apply .gitignore Files");
+    m_useGitignoreCheck->SetValue(true);
+    settingsSizer->Add(m_useGitignoreCheck, 0, wxLEFT | wxRIGHT | wxBOTTOM, 5);
     Bind(wxEVT_CHECKBOX, &MainFrame::OnSettingsChanged, this, ID_SettingsChanged);
 
     // --- Preset Buttons ---
@@ -180,7 +169,7 @@ wxPanel* MainFrame::CreateLeftPanel(wxWindow* parent)
 
     // --- Ignore Patterns Text Area ---
     settingsSizer->Add(new wxStaticText(settingsWin, wxID_ANY, "Ignore Patterns (one per line):"), 0, wxLEFT | wxRIGHT | wxTOP, 5);
-    m_ignorePatternsText = new wxTextCtrl(settingsWin, ID_SettingsChanged, DEFAULT_IGNORE_PATTERNS, wxDefaultPosition, wxSize(-1, 100), wxTE_MULTILINE);
+    m_ignorePatternsText = new wxTextCtrl(settingsWin, ID_SettingsChanged, ProjectPresets::GetIgnorePatterns(ProjectType::None), wxDefaultPosition, wxSize(-1, 100), wxTE_MULTILINE);
     settingsSizer->Add(m_ignorePatternsText, 1, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 5);
     Bind(wxEVT_TEXT, &MainFrame::OnSettingsChanged, this, ID_SettingsChanged);
 
@@ -196,6 +185,61 @@ wxPanel* MainFrame::CreateLeftPanel(wxWindow* parent)
     Bind(wxEVT_BUTTON, &MainFrame::OnSaveIgnoreFile, this, ID_SaveIgnoreFile);
     // ---
 
+    // --- Export Splitting ---
+    wxBoxSizer* splitSizer = new wxBoxSizer(wxHORIZONTAL);
+    m_splitCheck = new wxCheckBox(settingsWin, wxID_ANY, "Split export every");
+    m_splitBudget = new wxSpinCtrl(settingsWin, wxID_ANY, "100", wxDefaultPosition, wxSize(80, -1), wxSP_ARROW_KEYS, 1, 1000000, 100);
+    wxString splitUnits[] = { "k tokens", "KiB" };
+    m_splitUnit = new wxChoice(settingsWin, wxID_ANY, wxDefaultPosition, wxDefaultSize, 2, splitUnits);
+    m_splitUnit->SetSelection(0);
+    splitSizer->Add(m_splitCheck, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 4);
+    splitSizer->Add(m_splitBudget, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 4);
+    splitSizer->Add(m_splitUnit, 0, wxALIGN_CENTER_VERTICAL);
+    settingsSizer->Add(splitSizer, 0, wxLEFT | wxRIGHT | wxBOTTOM, 5);
+
+    // --- Tree Limits ---
+    wxBoxSizer* treeCollapseSizer = new wxBoxSizer(wxHORIZONTAL);
+    m_treeCollapseCheck = new wxCheckBox(settingsWin, wxID_ANY, "Summarize tree folders over");
+    m_treeCollapseCount = new wxSpinCtrl(settingsWin, wxID_ANY, "200", wxDefaultPosition, wxSize(80, -1), wxSP_ARROW_KEYS, 1, 1000000, 200);
+    m_treeCollapseCheck->SetToolTip("In the tree, the files of a bigger folder become one line counting them by extension");
+    treeCollapseSizer->Add(m_treeCollapseCheck, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 4);
+    treeCollapseSizer->Add(m_treeCollapseCount, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 4);
+    treeCollapseSizer->Add(new wxStaticText(settingsWin, wxID_ANY, "entries"), 0, wxALIGN_CENTER_VERTICAL);
+    settingsSizer->Add(treeCollapseSizer, 0, wxLEFT | wxRIGHT | wxBOTTOM, 5);
+
+    wxBoxSizer* treeDepthSizer = new wxBoxSizer(wxHORIZONTAL);
+    m_treeDepthCheck = new wxCheckBox(settingsWin, wxID_ANY, "Limit tree depth to");
+    m_treeDepth = new wxSpinCtrl(settingsWin, wxID_ANY, "4", wxDefaultPosition, wxSize(80, -1), wxSP_ARROW_KEYS, 1, 1000, 4);
+    m_treeDepthCheck->SetToolTip("Deeper folders are shown with the number of files they hold");
+    treeDepthSizer->Add(m_treeDepthCheck, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 4);
+    treeDepthSizer->Add(m_treeDepth, 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 4);
+    treeDepthSizer->Add(new wxStaticText(settingsWin, wxID_ANY, "levels"), 0, wxALIGN_CENTER_VERTICAL);
+    settingsSizer->Add(treeDepthSizer, 0, wxLEFT | wxRIGHT | wxBOTTOM, 5);
+
+    m_dedupCheck = new wxCheckBox(settingsWin, wxID_ANY, "Replace duplicate files with a reference");
+    settingsSizer->Add(m_dedupCheck, 0, wxLEFT | wxRIGHT | wxBOTTOM, 5);
+    m_stripCommentsCheck = new wxCheckBox(settingsWin, wxID_ANY, "Strip comments and blank lines");
+    m_stripCommentsCheck->SetToolTip("Drops comments, trailing spaces and empty lines from source files. "
+                                     "Strings and indentation are kept.");
+    settingsSizer->Add(m_stripCommentsCheck, 0, wxLEFT | wxRIGHT | wxBOTTOM, 5);
+    m_manifestCheck = new wxCheckBox(settingsWin, wxID_ANY, "Write a manifest for change exports");
+    settingsSizer->Add(m_manifestCheck, 0, wxLEFT | wxRIGHT | wxBOTTOM, 5);
+
+    wxBoxSizer* compressionSizer = new wxBoxSizer(wxHORIZONTAL);
+    m_compressionChoice = new wxChoice(settingsWin, wxID_ANY);
+    for (BlockCompressor::Format format : { BlockCompressor::Format::None, BlockCompressor::Format::Gzip, BlockCompressor::Format::Zstd })
+    {
+        if (!BlockCompressor::IsAvailable(format))
+            continue;
+        m_compressionFormats.push_back(format);
+        m_compressionChoice->Append(format == BlockCompressor::Format::None ? wxString("None")
+                                                                            : wxString(BlockCompressor::GetName(format)));
+    }
+    m_compressionChoice->SetSelection(0);
+    compressionSizer->Add(new wxStaticText(settingsWin, wxID_ANY, "Compress export:"), 0, wxALIGN_CENTER_VERTICAL | wxRIGHT, 4);
+    compressionSizer->Add(m_compressionChoice, 0, wxALIGN_CENTER_VERTICAL);
+    settingsSizer->Add(compressionSizer, 0, wxLEFT | wxRIGHT | wxBOTTOM, 5);
+
     settingsWin->SetSizer(settingsSizer);
 
     // --- Filter Accordion ---
@@ -208,54 +252,43 @@ wxPanel* MainFrame::CreateLeftPanel(wxWindow* parent)
     filterSizer->AddGrowableCol(1, 1);
     filterSizer->AddGrowableCol(2, 1);
 
-    // --- Checkboxes (all unchanged) ---
-    m_filterCpp = new wxCheckBox(filterWin, ID_SettingsChanged, ".cpp / .c"); m_filterCpp->SetValue(true);
-    m_filterH = new wxCheckBox(filterWin, ID_SettingsChanged, ".h / .hpp"); m_filterH->SetValue(true);
-    m_filterPy = new wxCheckBox(filterWin, ID_SettingsChanged, ".py"); m_filterPy->SetValue(true);
-    m_filterJs = new wxCheckBox(filterWin, ID_SettingsChanged, ".js"); m_filterJs->SetValue(true);
-    m_filterHtml = new wxCheckBox(filterWin, ID_SettingsChanged, ".html"); m_filterHtml->SetValue(true);
-    m_filterCss = new wxCheckBox(filterWin, ID_SettingsChanged, ".css"); m_filterCss->SetValue(true);
-    m_filterJson = new wxCheckBox(filterWin, ID_SettingsChanged, ".json"); m_filterJson->SetValue(true);
-    m_filterMd = new wxCheckBox(filterWin, ID_SettingsChanged, ".md"); m_filterMd->SetValue(true);
-    m_filterGd = new wxCheckBox(filterWin, ID_SettingsChanged, ".gd"); m_filterGd->SetValue(true);
-    m_filterTscn = new wxCheckBox(filterWin, ID_SettingsChanged, ".tscn"); m_filterTscn->SetValue(false);
-    m_filterTres = new wxCheckBox(filterWin, ID_SettingsChanged, ".tres"); m_filterTres->SetValue(false);
-    m_filterRes = new wxCheckBox(filterWin, ID_SettingsChanged, ".res"); m_filterRes->SetValue(false);
-    m_filterCs = new wxCheckBox(filterWin, ID_SettingsChanged, ".cs"); m_filterCs->SetValue(true);
-    m_filterShader = new wxCheckBox(filterWin, ID_SettingsChanged, ".shader"); m_filterShader->SetValue(true);
-    m_filterUnity = new wxCheckBox(filterWin, ID_SettingsChanged, ".unity"); m_filterUnity->SetValue(false);
-    m_filterPrefab = new wxCheckBox(filterWin, ID_SettingsChanged, ".prefab"); m_filterPrefab->SetValue(false);
-    m_filterTs = new wxCheckBox(filterWin, ID_SettingsChanged, ".ts"); m_filterTs->SetValue(true);
-    m_filterMjs = new wxCheckBox(filterWin, ID_SettingsChanged, ".mjs"); m_filterMjs->SetValue(true);
-    m_filterCjs = new wxCheckBox(filterWin, ID_SettingsChanged, ".cjs"); m_filterCjs->SetValue(true);
-    filterSizer->Add(m_filterCpp, 1, wxEXPAND);
-    filterSizer->Add(m_filterH, 1, wxEXPAND);
-    filterSizer->Add(m_filterPy, 1, wxEXPAND);
-    filterSizer->Add(m_filterJs, 1, wxEXPAND);
-    filterSizer->Add(m_filterHtml, 1, wxEXPAND);
-    filterSizer->Add(m_filterCss, 1, wxEXPAND);
-    filterSizer->Add(m_filterJson, 1, wxEXPAND);
-    filterSizer->Add(m_filterMd, 1, wxEXPAND);
-    filterSizer->Add(m_filterGd, 1, wxEXPAND);
-    filterSizer->Add(m_filterTscn, 1, wxEXPAND);
-    filterSizer->Add(m_filterTres, 1, wxEXPAND);
-    filterSizer->Add(m_filterRes, 1, wxEXPAND);
-    filterSizer->Add(m_filterCs, 1, wxEXPAND);
-    filterSizer->Add(m_filterShader, 1, wxEXPAND);
-    filterSizer->Add(m_filterUnity, 1, wxEXPAND);
-    filterSizer->Add(m_filterPrefab, 1, wxEXPAND);
-    filterSizer->Add(m_filterTs, 1, wxEXPAND);
-    filterSizer->Add(m_filterMjs, 1, wxEXPAND);
-    filterSizer->Add(m_filterCjs, 1, wxEXPAND);
+    // --- Checkboxes, generated from the file type registry ---
+    m_fileTypeChecks.assign(m_fileTypes.GetTypes().size(), nullptr);
+    for (size_t i = 0; i < m_fileTypes.GetTypes().size(); ++i)
+    {
+        const FileType& type = m_fileTypes.GetTypes()[i];
+        if (!type.filter) continue;
+
+        wxCheckBox* check = new wxCheckBox(filterWin, ID_SettingsChanged, wxString::FromUTF8(type.label));
+        check->SetValue(type.enabled);
+        filterSizer->Add(check, 1, wxEXPAND);
+        m_fileTypeChecks[i] = check;
+    }
     Bind(wxEVT_CHECKBOX, &MainFrame::OnSettingsChanged, this, ID_SettingsChanged);
     filterWin->SetSizer(filterSizer);
 
     // --- File Tree ---
 
-    m_treeCtrl = new wxTreeCtrl(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxTR_DEFAULT_STYLE | wxTR_HIDE_ROOT);
-    m_treeCtrl->AssignImageList(m_imageList); 
+    m_treeCtrl = new wxDataViewCtrl(panel, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxDV_SINGLE | wxDV_NO_HEADER);
+    m_treeModel = new ProjectTreeModel(m_model, m_filter);
+    m_treeCtrl->AssociateModel(m_treeModel);
+    m_treeModel->DecRef(); // The control keeps the only reference
+    m_treeCtrl->AppendIconTextColumn("Name", 0, wxDATAVIEW_CELL_INERT, -1, wxALIGN_LEFT, wxDATAVIEW_COL_RESIZABLE);
+    m_treeCtrl->AppendTextColumn("Tokens", 1, wxDATAVIEW_CELL_INERT, 60, wxALIGN_RIGHT);
     sizer->Add(m_treeCtrl, 1, wxEXPAND | wxALL, 5);
-    Bind(wxEVT_TREE_SEL_CHANGED, &MainFrame::OnTreeSelectionChanged, this, m_treeCtrl->GetId()); 
+    Bind(wxEVT_DATAVIEW_SELECTION_CHANGED, &MainFrame::OnTreeSelectionChanged, this, m_treeCtrl->GetId()); 
+
+    // --- Progress of a background scan or export ---
+
+    wxBoxSizer* jobSizer = new wxBoxSizer(wxHORIZONTAL);
+    m_jobGauge = new wxGauge(panel, wxID_ANY, 1000, wxDefaultPosition, wxSize(-1, 16));
+    m_jobCancelButton = new wxButton(panel, ID_CancelJob, "Cancel");
+    jobSizer->Add(m_jobGauge, 1, wxALIGN_CENTER_VERTICAL | wxRIGHT, 4);
+    jobSizer->Add(m_jobCancelButton, 0);
+    sizer->Add(jobSizer, 0, wxEXPAND | wxLEFT | wxRIGHT, 5);
+    m_jobGauge->Hide();
+    m_jobCancelButton->Hide();
+    Bind(wxEVT_BUTTON, &MainFrame::OnCancelJob, this, ID_CancelJob);
 
     // --- Save Button ---
 
@@ -330,36 +363,53 @@ void MainFrame::SetupEditorStyles()
 void MainFrame::SetEditorLexer(const wxString& filePath)
 {
 
-    wxFileName fn(filePath);
-    wxString ext = fn.GetExt().Lower();
+    const FileType* type = m_fileTypes.FindForFileName(std::string(wxFileName(filePath).GetFullName().utf8_str()));
+    const std::string lexer = type ? type->lexer : std::string();
 
-    if (ext == "cpp" || ext == "c" || ext == "h" || ext == "hpp") {
+    if (lexer == "cpp") {
         m_stc->SetLexer(wxSTC_LEX_CPP);
-    } else if (ext == "py" || ext == "gd") { 
+    } else if (lexer == "python") { 
         m_stc->SetLexer(wxSTC_LEX_PYTHON);
-    } else if (ext == "js" || ext == "mjs" || ext == "cjs") { 
+    } else if (lexer == "javascript") { 
         m_stc->SetLexer(wxSTC_LEX_ESCRIPT);
-    } else if (ext == "ts") {
-        m_stc->SetLexer(wxSTC_LEX_ESCRIPT); 
-    } else if (ext == "html" || ext == "wxml") {
+    } else if (lexer == "html") {
         m_stc->SetLexer(wxSTC_LEX_HTML);
-    } else if (ext == "css" || ext == "wxss") {
+    } else if (lexer == "css") {
         m_stc->SetLexer(wxSTC_LEX_CSS);
-    } else if (ext == "json") {
+    } else if (lexer == "json") {
         m_stc->SetLexer(wxSTC_LEX_JSON);
-    } else if (ext == "md") {
+    } else if (lexer == "markdown") {
         m_stc->SetLexer(wxSTC_LEX_MARKDOWN);
-    } else if (ext == "xml" || ext == "tscn" || ext == "tres" || ext == "res" || ext == "csproj" || ext == "unity" || ext == "prefab") { 
+    } else if (lexer == "xml") { 
         m_stc->SetLexer(wxSTC_LEX_XML);
-    } else if (ext == "cs") {
-        m_stc->SetLexer(wxSTC_LEX_CPP); 
-    } else if (ext == "shader") {
-        m_stc->SetLexer(wxSTC_LEX_CPP); 
     } else {
         m_stc->SetLexer(wxSTC_LEX_NULL);
     }
 }
 
+void MainFrame::LoadFileTypes()
+{
+
+    // A languages.conf in the user data directory replaces the built-in table
+    m_fileTypes = FileTypeRegistry::CreateDefault();
+    wxString configPath = wxStandardPaths::Get().GetUserDataDir() + wxFileName::GetPathSeparator() + "languages.conf";
+    if (wxFileExists(configPath))
+    {
+        m_fileTypes.LoadFile(std::string(configPath.utf8_str()));
+    }
+}
+
+void MainFrame::LoadTokenizer()
+{
+
+    // Exact counts need the vocabulary file in the user data directory; without it tokens are estimated
+    wxString vocabularyPath = wxStandardPaths::Get().GetUserDataDir() + wxFileName::GetPathSeparator() + "cl100k_base.tiktoken";
+    bool exact = wxFileExists(vocabularyPath) && m_tokenCounter.LoadVocabulary(std::string(vocabularyPath.utf8_str()));
+    m_tokenMode = exact ? TokenCounter::Mode::Exact : TokenCounter::Mode::Approximate;
+    m_menuBar->Enable(ID_ExactTokens, exact);
+    m_menuBar->Check(ID_ExactTokens, exact);
+}
+
 
 // --- Main Logic ---
 
@@ -372,14 +422,17 @@ void MainFrame::OnLoadProject(wxCommandEvent& event)
 
     m_projectRoot = dlg.GetPath();
     m_projectType = ProjectType::None; 
-
-    if (wxFileExists(m_projectRoot + "/project.godot")) {
-        OnPresetGodot(event);
-    } else if (wxDirExists(m_projectRoot + "/Assets") && wxDirExists(m_projectRoot + "/ProjectSettings")) {
-        OnPresetUnity(event);
-    } else if (wxFileExists(m_projectRoot + "/package.json")) {
-        OnPresetNode(event);
-    }
+    m_scanJob.Cancel(); // A scan of the previous choice is replaced, not finished
+    SaveIndex(); // Keeps the live updates of the previous project
+    m_watcher.Stop();
+    m_tokenJobCancel = true;
+    ++m_tokenGeneration;
+    m_model = ProjectModel(); // Presets below only refilter; the scan happens once, in PopulateFileTree
+    m_treeModel->Reset();
+
+    ProjectType detected = ProjectPresets::Detect(std::string(m_projectRoot.utf8_str()));
+    if (detected != ProjectType::None)
+        ApplyPreset(detected);
 
     PopulateFileTree();
 }
@@ -387,322 +440,924 @@ void MainFrame::OnLoadProject(wxCommandEvent& event)
 void MainFrame::OnSettingsChanged(wxCommandEvent& event)
 {
 
+    // Typing a pattern restarts the timer, so only the final text is applied
     if (!m_projectRoot.IsEmpty()) {
-        PopulateFileTree();
+        m_refilterTimer.StartOnce(250);
     }
 }
 
+void MainFrame::OnRefilterTimer(wxTimerEvent& event)
+{
+    RefreshFilters();
+}
+
 void MainFrame::PopulateFileTree()
 {
 
     if (m_projectRoot.IsEmpty()) return;
 
-    m_ignorePatterns.Clear();
-    wxStringInputStream sstream(m_ignorePatternsText->GetValue());
-    wxTextInputStream tstream(sstream); 
-    while (!sstream.Eof()) { 
-        wxString line = tstream.ReadLine();
-        if (!line.IsEmpty()) {
-            m_ignorePatterns.Add(line);
-        }
+    // The scanner threads read the settings snapshot, so a running scan is stopped before it changes
+    m_scanJob.Cancel();
+    unsigned generation = ++m_scanGeneration;
+    m_projectGeneration = generation;
+    m_contentGeneration = generation;
+    m_pendingRescans.clear();
+    m_pendingRefreshes.clear();
+    m_rereadPending = false;
+    m_refilterPending = false;
+    SnapshotFilterSettings();
+
+    // A project opened before comes from its index right away and is checked against the disk afterwards
+    std::string rootPath(m_projectRoot.utf8_str());
+    if (!ScanIndex::Load(GetIndexPath(rootPath), rootPath, m_model))
+    {
+        // A new one is read in the background; the model stays empty until ApplyScan, so nothing else touches it
+        m_model = ProjectModel();
+        m_treeModel->Reset();
+        m_scanJob.Start([this, generation, rootPath, visibility = m_rules.GetVisibilityFilter()](JobProgress& progress) {
+            m_scanner.SetProgress(&progress);
+            auto model = std::make_shared<ProjectModel>(m_scanner.Scan(rootPath));
+
+            // On a cold disk, sniffing the visible files costs as much as the scan, so it is done here too
+            if (!progress.IsCancelled())
+            {
+                ProjectFilter filter;
+                filter.ApplyAndScan(*model, m_scanner, visibility);
+            }
+            m_scanner.SetProgress(nullptr);
+            bool cancelled = progress.IsCancelled();
+            CallAfter([this, generation, model, cancelled] { ApplyScan(generation, model, cancelled); });
+        });
+        SetStatusText("Scanning " + m_projectRoot + "...", 0);
+        UpdateJobProgress();
+        return;
     }
 
-    m_treeCtrl->DeleteAllItems();
-    wxFileName fn(m_projectRoot);
-    wxTreeItemId rootId = m_treeCtrl->AddRoot(fn.GetFullName(), 0);
-    m_treeCtrl->SetItemData(rootId, new FileTreeData(m_projectRoot));
+    m_scanner.RestoreIgnoreScopes(m_model);
+    ShowProject();
+    CheckStamps(DirectoryScanner::GetDirectoryStamps(m_model));
+}
+
+void MainFrame::CheckStamps(std::vector<DirectoryScanner::DirectoryStamp> directories)
+{
+
+    // Only the stat() calls run in the background; the model is touched on this thread alone
+    if (m_indexCheck.joinable())
+        m_indexCheck.join();
+    m_indexCheck = std::thread([this, rootPath = m_model.GetRootPath(), directories = std::move(directories),
+                                files = DirectoryScanner::GetContentStamps(m_model)] {
+        std::vector<uint32_t> changedDirectories = DirectoryScanner::FindChangedDirectories(directories);
+        std::vector<uint32_t> changedFiles = DirectoryScanner::FindChangedFiles(files);
+        CallAfter([this, rootPath, changedDirectories, changedFiles] { ApplyIndexCheck(rootPath, changedDirectories, changedFiles); });
+    });
+}
+
+void MainFrame::ApplyScan(unsigned generation, const std::shared_ptr<ProjectModel>& model, bool cancelled)
+{
+
+    // A scan that was replaced has been joined already; its result is stale
+    if (generation != m_scanGeneration)
+        return;
+    m_scanJob.Join();
+    UpdateJobProgress();
+
+    if (cancelled)
+    {
+        m_projectRoot.Clear();
+        m_refilterPending = false;
+        SetStatusText("Scan cancelled.", 0);
+        return;
+    }
+
+    // The scan read with the settings of its start; changes made since are applied now that its threads are done
+    if (m_refilterPending)
+    {
+        m_refilterPending = false;
+        SnapshotFilterSettings();
+    }
+    m_model = std::move(*model);
+    ShowProject();
+    SaveIndex();
+}
+
+void MainFrame::ShowProject()
+{
 
-    ScanDirectoryRecursive(m_projectRoot, rootId);
-    m_treeCtrl->Expand(rootId);
+    m_watcher.Start(m_model.GetRootPath());
+    m_treeModel->Reset();
+    ApplyFilters();
     SetStatusText("Project loaded: " + m_projectRoot, 0);
 }
 
-void MainFrame::ScanDirectoryRecursive(const wxString& path, const wxTreeItemId& parentId)
+void MainFrame::ApplyIndexCheck(const std::string& rootPath, const std::vector<uint32_t>& changed,
+                                const std::vector<uint32_t>& rewritten)
+{
+
+    if (m_model.IsEmpty() || rootPath != m_model.GetRootPath()) return;
+    if (changed.empty() && rewritten.empty()) return; // The index on disk still matches
+
+    // Changed folders are queued, not read here: after a checkout that can be most of the project.
+    // Indices stay valid even if the watcher changed the model meanwhile; removed nodes are skipped
+    for (uint32_t index : changed)
+    {
+        const ProjectNode& node = m_model.GetNode(index);
+        if (node.scanned && (index == m_model.GetRoot() || node.parent != ProjectModel::npos))
+            RefreshDirectory(index);
+    }
+    ForgetFileContents(rewritten);
+
+    ApplyFilters();
+    SaveIndex();
+}
+
+std::string MainFrame::GetIndexPath(const std::string& rootPath) const
+{
+    wxString cacheDir = wxStandardPaths::Get().GetUserDir(wxStandardPaths::Dir_Cache) + wxFileName::GetPathSeparator() +
+                        wxTheApp->GetAppName() + wxFileName::GetPathSeparator() + "index";
+    wxFileName::Mkdir(cacheDir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+    return std::string(cacheDir.utf8_str()) + '/' + ScanIndex::GetFileName(rootPath);
+}
+
+void MainFrame::SaveIndex()
+{
+
+    if (m_model.IsEmpty()) return;
+    ScanIndex::Save(m_model, GetIndexPath(m_model.GetRootPath()));
+}
+
+void MainFrame::RefreshFilters()
+{
+
+    m_refilterTimer.Stop();
+
+    // During the first scan of a project the scanner threads still read the snapshot; ApplyScan takes a new one
+    if (m_model.IsEmpty())
+    {
+        m_refilterPending = !m_projectRoot.IsEmpty();
+        return;
+    }
+
+    // The scanner threads of a running job read the settings, so it is stopped before they change
+    m_scanJob.Cancel();
+    SnapshotFilterSettings();
+    ApplyFilters();
+}
+
+void MainFrame::ApplyFilters()
 {
 
-    wxDir dir(path);
-    if (!dir.IsOpened())
+    if (m_model.IsEmpty()) return;
+    wxStopWatch watch;
+
+    // Only the model is walked here; folders that became visible are read in the background
+    std::vector<uint32_t> unscanned = m_filter.Apply(m_model, m_rules.GetVisibilityFilter());
+
+    // Only folders the user has expanded are patched; the rest is read lazily
+    m_treeModel->ApplyFilterChanges();
+    UpdateWatchedDirectories();
+
+    // Totals follow the new visibility at once; only files never counted are read
+    m_filter.SumTokens(m_model);
+    m_treeModel->RefreshTokenTotals();
+    CountTokens();
+    ReadVisibleEntries(std::move(unscanned));
+
+    SetStatusText(GetTotalsText() + wxString::Format(" (filtered in %ld ms)", watch.Time()), 1);
+}
+
+void MainFrame::ReadVisibleEntries(std::vector<uint32_t> directories)
+{
+
+    // One job at a time; whatever is still missing when it is done is picked up then
+    if (m_scanJob.IsRunning())
+    {
+        m_rereadPending = true;
+        return;
+    }
+
+    // A folder can be both, after its .gitignore changed
+    directories.insert(directories.end(), m_pendingRescans.begin(), m_pendingRescans.end());
+    std::sort(directories.begin(), directories.end());
+    directories.erase(std::unique(directories.begin(), directories.end()), directories.end());
+
+    // A folder read in full reads its subfolders too; rescans and refreshes below one are dropped
+    std::vector<uint32_t> rescans;
+    for (uint32_t dirIndex : directories)
+    {
+        if (!IsBelowAny(m_model, dirIndex, directories))
+            rescans.push_back(dirIndex);
+    }
+    auto isCovered = [this, &directories](uint32_t dirIndex) {
+        return std::binary_search(directories.begin(), directories.end(), dirIndex) || IsBelowAny(m_model, dirIndex, directories);
+    };
+    m_pendingRescans.erase(std::remove_if(m_pendingRescans.begin(), m_pendingRescans.end(), [&](uint32_t dirIndex) {
+        return IsBelowAny(m_model, dirIndex, directories);
+    }), m_pendingRescans.end());
+    std::sort(m_pendingRefreshes.begin(), m_pendingRefreshes.end());
+    m_pendingRefreshes.erase(std::unique(m_pendingRefreshes.begin(), m_pendingRefreshes.end()), m_pendingRefreshes.end());
+    m_pendingRefreshes.erase(std::remove_if(m_pendingRefreshes.begin(), m_pendingRefreshes.end(), isCovered), m_pendingRefreshes.end());
+    directories = std::move(rescans);
+
+    if (directories.empty() && m_pendingRefreshes.empty())
+    {
+        SniffVisibleFiles();
         return;
+    }
+
+    // The folders are read from copies of their paths and ignore scopes, so the model stays on this thread
+    std::vector<std::shared_ptr<DirectoryScanner::PendingScan>> scans;
+    for (uint32_t dirIndex : directories)
+        scans.push_back(m_scanner.BeginScan(m_model, dirIndex));
+    for (uint32_t dirIndex : m_pendingRefreshes)
+    {
+        directories.push_back(dirIndex);
+        scans.push_back(m_scanner.BeginScan(m_model, dirIndex, true));
+    }
+
+    unsigned generation = ++m_scanGeneration;
+    m_scanJob.Start([this, generation, directories = std::move(directories), scans = std::move(scans)](JobProgress& progress) {
+        m_scanner.SetProgress(&progress);
+        progress.StartPhase("Scanning");
+        for (const auto& scan : scans)
+            m_scanner.ReadScan(*scan);
+        m_scanner.SetProgress(nullptr);
+        bool cancelled = progress.IsCancelled();
+        CallAfter([this, generation, directories, scans, cancelled] { ApplyDirectoryScans(generation, directories, scans, cancelled); });
+    });
+    UpdateJobProgress();
+}
+
+void MainFrame::ApplyDirectoryScans(unsigned generation, const std::vector<uint32_t>& directories,
+                                    const std::vector<std::shared_ptr<DirectoryScanner::PendingScan>>& scans, bool cancelled)
+{
+
+    if (generation == m_scanGeneration)
+    {
+        m_scanJob.Join();
+        UpdateJobProgress();
+    }
+
+    // A cancelled read is incomplete; its folders are still unscanned or due for a rescan, so they are read next time
+    if (cancelled || generation < m_projectGeneration)
+        return;
+
+    for (size_t i = 0; i < scans.size(); ++i)
+    {
+        m_scanner.EndScan(m_model, *scans[i]);
+        m_pendingRescans.erase(std::remove(m_pendingRescans.begin(), m_pendingRescans.end(), directories[i]), m_pendingRescans.end());
+        m_pendingRefreshes.erase(std::remove(m_pendingRefreshes.begin(), m_pendingRefreshes.end(), directories[i]), m_pendingRefreshes.end());
+    }
+
+    // The new folders may hold more that are visible but unread, and their files are still to be sniffed
+    m_rereadPending = false;
+    ApplyFilters();
+}
+
+void MainFrame::SniffVisibleFiles()
+{
+
+    // Until its result arrives a file counts as Unknown; the export sniffs what it reads anyway
+    std::vector<uint32_t> files = m_filter.GetUnsniffedFiles(m_model);
+    if (files.empty()) return;
+
+    std::vector<std::string> paths;
+    paths.reserve(files.size());
+    for (uint32_t index : files)
+        paths.push_back(m_model.GetFullPath(index));
+
+    unsigned generation = ++m_scanGeneration;
+    m_scanJob.Start([this, generation, files = std::move(files), paths = std::move(paths)](JobProgress& progress) {
+        m_scanner.SetProgress(&progress);
+        std::vector<DirectoryScanner::SniffedFile> sniffed = m_scanner.DetectContentKinds(paths);
+        m_scanner.SetProgress(nullptr);
+        CallAfter([this, generation, files, sniffed] { ApplyContentKinds(generation, files, sniffed); });
+    });
+    UpdateJobProgress();
+}
+
+void MainFrame::ApplyContentKinds(unsigned generation, const std::vector<uint32_t>& files,
+                                  const std::vector<DirectoryScanner::SniffedFile>& sniffed)
+{
 
-    wxString filename;
-    bool cont = dir.GetFirst(&filename, wxEmptyString, wxDIR_FILES | wxDIR_DIRS | wxDIR_HIDDEN);
-    while (cont)
+    // A replaced job has been joined already, but what it sniffed is still good
+    if (generation == m_scanGeneration)
     {
-        wxString fullPath = path + wxFileName::GetPathSeparator() + filename;
-        bool isDir = wxDir::Exists(fullPath);
+        m_scanJob.Join();
+        UpdateJobProgress();
+    }
 
-        if (!ShouldIgnore(fullPath, isDir))
+    // Node indices are never reused; files removed meanwhile are written but never read.
+    // A sniff that may have read a file before it was saved is dropped, but what waited for it still runs.
+    if (generation >= m_contentGeneration)
+    {
+        for (size_t i = 0; i < files.size(); ++i)
         {
-            if (isDir)
-            {
-                wxTreeItemId newDirId = m_treeCtrl->AppendItem(parentId, filename, 0); 
-                m_treeCtrl->SetItemData(newDirId, new FileTreeData(fullPath));
-                ScanDirectoryRecursive(fullPath, newDirId);
-            }
-            else
-            {
-                if (IsFileTypeFiltered(fullPath))
-                {
-                    wxTreeItemId fileId = m_treeCtrl->AppendItem(parentId, filename, 1); 
-                    m_treeCtrl->SetItemData(fileId, new FileTreeData(fullPath));
-                }
-            }
+            if (sniffed[i].content != ContentKind::Unknown)
+                m_model.SetContentKind(files[i], sniffed[i].content, sniffed[i].stamp);
         }
-        cont = dir.GetNext(&filename);
+    }
+
+    if (m_rereadPending)
+    {
+        m_rereadPending = false;
+        ApplyFilters();
     }
 }
 
-bool MainFrame::ShouldIgnore(const wxString& path, bool isDir)
+void MainFrame::ApplyWatchBatch(const DirectoryWatcher::Batch& batch)
 {
 
-    wxFileName fn(path);
-    wxString name = fn.GetFullName();
+    // The batch may have been queued just before another project was loaded
+    if (m_model.IsEmpty() || batch.rootPath != m_model.GetRootPath()) return;
 
-    if (!m_showHiddenCheck->IsChecked() && name.StartsWith("."))
+    for (const std::string& directory : batch.rescans)
     {
-        return true;
+        uint32_t dirIndex = m_model.FindPath(directory);
+        if (dirIndex != ProjectModel::npos && m_model.GetNode(dirIndex).isDir)
+            RescanDirectory(dirIndex);
     }
 
-    for (const wxString& pattern : m_ignorePatterns)
+    std::vector<uint32_t> rewritten;
+    for (const DirectoryWatcher::Change& change : batch.changes)
     {
-        wxString patternToCheck = pattern;
-        if (pattern.EndsWith("/") || pattern.EndsWith(wxFileName::GetPathSeparator())) {
-            if (!isDir) continue; 
-            patternToCheck = pattern.Left(pattern.Length() - 1);
+        uint32_t dirIndex = m_model.FindPath(change.directory);
+        if (dirIndex == ProjectModel::npos || !m_model.GetNode(dirIndex).scanned) continue;
+
+        uint32_t index = m_model.FindChild(dirIndex, change.name);
+        if (index != ProjectModel::npos && change.exists && m_model.GetNode(index).isDir == change.isDir)
+        {
+            // A file saved in place is sniffed and counted again
+            if (!change.isDir)
+                rewritten.push_back(index);
+            continue;
         }
 
-        if (wxMatchWild(patternToCheck, name, false)) 
+        if (index != ProjectModel::npos)
+            m_model.RemoveNode(index);
+        // New directories start unscanned; ApplyFilters reads them only if they are visible
+        if (change.exists)
+            m_model.InsertNode(dirIndex, change.name, change.isDir);
+    }
+
+    ForgetFileContents(rewritten);
+
+    // Lost events could be in any folder: those whose mtime moved are read again, or all of them
+    // if some folder has no mtime to compare; sniffed files that changed are sniffed again
+    if (batch.overflow)
+    {
+        std::vector<DirectoryScanner::DirectoryStamp> stamps = DirectoryScanner::GetDirectoryStamps(m_model);
+        if (std::any_of(stamps.begin(), stamps.end(), [](const DirectoryScanner::DirectoryStamp& stamp) { return stamp.mtime == 0; }))
+            RescanDirectory(m_model.GetRoot());
+        else
+            CheckStamps(std::move(stamps));
+    }
+
+    ApplyFilters();
+}
+
+void MainFrame::ForgetFileContents(const std::vector<uint32_t>& files)
+{
+
+    if (files.empty()) return;
+    for (uint32_t index : files)
+    {
+        m_model.SetContentKind(index, ContentKind::Unknown);
+        m_model.SetTokenCount(index, ProjectModel::kUncounted);
+    }
+
+    // A running count or sniff may have read a file before it was saved; its results are dropped
+    if (m_tokenJob.joinable())
+    {
+        m_tokenJobCancel = true;
+        ++m_tokenGeneration;
+    }
+    m_contentGeneration = m_scanGeneration + 1;
+}
+
+void MainFrame::RescanDirectory(uint32_t dirIndex)
+{
+
+    // A visible folder shows its old contents until the new ones are read in the background;
+    // a hidden one is just dropped and read once it is shown
+    if (m_filter.IsVisible(dirIndex))
+        m_pendingRescans.push_back(dirIndex);
+    else
+        m_model.ClearChildren(dirIndex);
+}
+
+void MainFrame::RefreshDirectory(uint32_t dirIndex)
+{
+
+    // Only the folder's own entries are read again, in the background; a hidden one is dropped like in RescanDirectory
+    if (m_filter.IsVisible(dirIndex))
+        m_pendingRefreshes.push_back(dirIndex);
+    else
+        m_model.ClearChildren(dirIndex);
+}
+
+void MainFrame::UpdateWatchedDirectories()
+{
+
+    // Exactly the visible, scanned directories: ignored trees never use up watches
+    std::vector<std::string> directories;
+    std::vector<std::pair<uint32_t, std::string>> stack;
+    stack.emplace_back(m_model.GetRoot(), std::string());
+    while (!stack.empty())
+    {
+        uint32_t dirIndex = stack.back().first;
+        std::string path = std::move(stack.back().second);
+        stack.pop_back();
+
+        for (uint32_t child : m_model.GetNode(dirIndex).children)
         {
-            return true;
+            const ProjectNode& node = m_model.GetNode(child);
+            if (node.isDir && node.scanned && m_filter.IsVisible(child))
+                stack.emplace_back(child, path.empty() ? node.name : path + '/' + node.name);
         }
-        
-        wxString relativePath = GetRelativePath(path);
-        
-        if (wxMatchWild(patternToCheck, relativePath, false))
+        directories.push_back(std::move(path));
+    }
+    m_watcher.SetWatchedDirectories(directories);
+}
+
+void MainFrame::CountTokens()
+{
+
+    // One job at a time; files that become visible meanwhile are picked up when it finishes
+    if (m_tokenJob.joinable())
+    {
+        m_tokenRecount = true;
+        return;
+    }
+
+    std::vector<uint32_t> files;
+    std::vector<TokenCounter::File> requests;
+    for (uint32_t i = 0; i < m_model.GetNodeCount(); ++i)
+    {
+        const ProjectNode& node = m_model.GetNode(i);
+        if (!node.isDir && node.tokens == ProjectModel::kUncounted && m_filter.IsVisible(i))
         {
-            return true;
+            files.push_back(i);
+            requests.push_back({ m_model.GetFullPath(i), node.content == ContentKind::Binary });
         }
     }
-    
-    return false;
+    if (files.empty()) return;
+
+    m_tokenJobCancel = false;
+    m_tokenJob = std::thread([this, generation = m_tokenGeneration, mode = m_tokenMode, files = std::move(files), requests = std::move(requests)] {
+        std::vector<uint32_t> counts = m_tokenCounter.CountFiles(requests, mode, m_tokenJobCancel);
+        CallAfter([this, generation, files, counts] { ApplyTokenCounts(generation, files, counts); });
+    });
 }
 
-bool MainFrame::IsFileTypeFiltered(const wxString& path)
+void MainFrame::ApplyTokenCounts(unsigned generation, const std::vector<uint32_t>& files, const std::vector<uint32_t>& counts)
 {
 
-    wxString ext = wxFileName(path).GetExt().Lower();
+    m_tokenJob.join();
 
-    if (m_filterCpp->IsChecked() && (ext == "cpp" || ext == "c")) return true;
-    if (m_filterH->IsChecked() && (ext == "h" || ext == "hpp")) return true;
-    if (m_filterPy->IsChecked() && ext == "py") return true;
-    if (m_filterJs->IsChecked() && ext == "js") return true;
-    if (m_filterHtml->IsChecked() && (ext == "html" || ext == "wxml")) return true;
-    if (m_filterCss->IsChecked() && (ext == "css" || ext == "wxss")) return true;
-    if (m_filterJson->IsChecked() && ext == "json") return true;
-    if (m_filterMd->IsChecked() && ext == "md") return true;
-    if (m_filterGd->IsChecked() && ext == "gd") return true;
-    if (m_filterTscn->IsChecked() && ext == "tscn") return true;
-    if (m_filterTres->IsChecked() && ext == "tres") return true;
-    if (m_filterRes->IsChecked() && ext == "res") return true;
-    if (m_filterCs->IsChecked() && ext == "cs") return true;
-    if (m_filterShader->IsChecked() && ext == "shader") return true;
-    if (m_filterUnity->IsChecked() && ext == "unity") return true;
-    if (m_filterPrefab->IsChecked() && ext == "prefab") return true;
-    if (m_filterTs->IsChecked() && ext == "ts") return true;
-    if (m_filterMjs->IsChecked() && ext == "mjs") return true;
-    if (m_filterCjs->IsChecked() && ext == "cjs") return true;
+    // Node indices are never reused, so the counts still belong to the same files unless the project or mode changed
+    if (generation == m_tokenGeneration)
+    {
+        for (size_t i = 0; i < files.size(); ++i)
+            m_model.SetTokenCount(files[i], counts[i] == TokenCounter::kFailed ? 0 : counts[i]);
+        UpdateTokenTotals();
+    }
 
-    return false;
+    if (m_tokenRecount || generation != m_tokenGeneration)
+    {
+        m_tokenRecount = false;
+        CountTokens();
+    }
 }
 
-void MainFrame::OnTreeSelectionChanged(wxTreeEvent& event)
+void MainFrame::UpdateTokenTotals()
 {
 
-    wxTreeItemId itemId = event.GetItem();
-    if (!itemId.IsOk()) return;
+    m_filter.SumTokens(m_model);
+    m_treeModel->RefreshTokenTotals();
+    SetStatusText(GetTotalsText(), 1);
+}
 
-    FileTreeData* data = (FileTreeData*)m_treeCtrl->GetItemData(itemId);
-    if (data && !wxDir::Exists(data->GetPath()))
+wxString MainFrame::GetTotalsText() const
+{
+
+    // "~" marks estimated counts
+    wxString text = wxString::Format("%lu files, %s%s tokens", (unsigned long)m_filter.GetVisibleFileCount(),
+                                     m_tokenMode == TokenCounter::Mode::Approximate ? "~" : "",
+                                     TokenCounter::FormatCount(m_filter.GetTokenTotal(m_model.GetRoot())).c_str());
+    if (m_filter.GetUncountedFileCount() > 0)
+        text += ", counting...";
+    return text;
+}
+
+void MainFrame::OnClose(wxCloseEvent& event)
+{
+
+    SaveIndex();
+    event.Skip();
+}
+
+void MainFrame::OnActivate(wxActivateEvent& event)
+{
+
+    // Past the inotify watch limit some folders are not live; catch up on them when the user comes back
+    if (event.GetActive() && !m_model.IsEmpty())
+    {
+        std::vector<std::string> unwatched = m_watcher.GetUnwatchedDirectories();
+        for (const std::string& directory : unwatched)
+        {
+            uint32_t dirIndex = m_model.FindPath(directory);
+            if (dirIndex != ProjectModel::npos)
+                RescanDirectory(dirIndex);
+        }
+        if (!unwatched.empty())
+            ApplyFilters();
+    }
+    event.Skip();
+}
+
+void MainFrame::SnapshotFilterSettings()
+{
+
+    wxScopedCharBuffer patterns = m_ignorePatternsText->GetValue().utf8_str();
+    m_rules.SetIgnorePatterns(std::string_view(patterns.data(), patterns.length()));
+    m_rules.SetShowHidden(m_showHiddenCheck->IsChecked());
+    m_rules.SetUseGitignore(m_useGitignoreCheck->IsChecked());
+
+    std::vector<bool> enabledTypes(m_fileTypeChecks.size(), false);
+    for (size_t i = 0; i < m_fileTypeChecks.size(); ++i)
     {
-        LoadFileContent(data->GetPath());
+        enabledTypes[i] = m_fileTypeChecks[i] && m_fileTypeChecks[i]->IsChecked();
     }
+    m_rules.SetEnabledExtensions(m_fileTypes.BuildExtensionTable(enabledTypes));
 }
 
-void MainFrame::LoadFileContent(const wxString& filePath)
+void MainFrame::OnTreeSelectionChanged(wxDataViewEvent& event)
 {
 
-    wxTextFile file;
-    if (!file.Open(filePath))
+    wxDataViewItem item = event.GetItem();
+    if (!item.IsOk()) return;
+
+    uint32_t index = ProjectTreeModel::ToNode(item);
+    const ProjectNode& node = m_model.GetNode(index);
+    if (node.isDir) return;
+
+    if (node.content == ContentKind::Binary)
     {
-        m_stc->SetText("Error: Could not open file " + filePath);
+        m_previewLoader.Cancel();
+        ++m_previewGeneration;
+        m_stc->SetReadOnly(false);
+        m_stc->SetText(ContentSniffer::GetPlaceholder());
         m_stc->SetReadOnly(true);
+        m_stc->EmptyUndoBuffer();
+        SetStatusText(wxString::FromUTF8(m_model.GetFullPath(index)), 0);
         return;
     }
+    LoadFileContent(wxString::FromUTF8(m_model.GetFullPath(index)), GetPrefetchPaths(index));
+}
 
-    wxString content; 
-    for (size_t i = 0; i < file.GetLineCount(); ++i)
+std::vector<std::string> MainFrame::GetPrefetchPaths(uint32_t index) const
+{
+
+    // The files next to the selection in the tree are the likeliest ones to be opened next
+    std::vector<std::string> paths;
+    const std::vector<uint32_t>& siblings = m_model.GetNode(m_model.GetNode(index).parent).children;
+    auto selected = std::find(siblings.begin(), siblings.end(), index);
+    if (selected == siblings.end())
+        return paths;
+
+    auto wanted = [this](uint32_t sibling) {
+        const ProjectNode& node = m_model.GetNode(sibling);
+        return !node.isDir && node.content != ContentKind::Binary && m_filter.IsVisible(sibling);
+    };
+    unsigned found = 0;
+    for (auto it = selected + 1; it != siblings.end() && found < kPrefetchNeighbours; ++it)
     {
-        content += file.GetLine(i) + "\n";
+        if (wanted(*it))
+        {
+            paths.push_back(m_model.GetFullPath(*it));
+            ++found;
+        }
     }
-    file.Close();
+    found = 0;
+    for (auto it = selected; it != siblings.begin() && found < kPrefetchNeighbours;)
+    {
+        --it;
+        if (wanted(*it))
+        {
+            paths.push_back(m_model.GetFullPath(*it));
+            ++found;
+        }
+    }
+    return paths;
+}
 
-    m_stc->SetReadOnly(false);
-    m_stc->SetText(content);
-    m_stc->SetReadOnly(true); 
-    m_stc->EmptyUndoBuffer();
-    SetEditorLexer(filePath);
+void MainFrame::LoadFileContent(const wxString& filePath, std::vector<std::string> prefetch)
+{
+
+    // Read on the loader's thread; a load still running for the previous selection is cancelled
+    unsigned generation = ++m_previewGeneration;
+    m_previewPath = filePath;
     SetStatusText(filePath, 0);
+    m_previewLoader.Start(std::string(filePath.utf8_str()), [this, generation](std::shared_ptr<PreviewLoader::Chunk> chunk) {
+        CallAfter([this, generation, chunk] { AppendPreviewChunk(generation, *chunk); });
+    }, std::move(prefetch));
 }
 
-void MainFrame::OnSaveCombined(wxCommandEvent& event)
+void MainFrame::AppendPreviewChunk(unsigned generation, const PreviewLoader::Chunk& chunk)
 {
 
-    if (m_projectRoot.IsEmpty())
+    // Chunks already queued when another file was selected
+    if (generation != m_previewGeneration)
+        return;
+
+    m_stc->SetReadOnly(false);
+    if (chunk.failed)
     {
-        wxMessageBox("Please load a project folder first.", "Error", wxOK | wxICON_ERROR, this);
+        m_stc->SetText("Error: Could not open file " + m_previewPath);
+        m_stc->SetReadOnly(true);
         return;
     }
 
-    wxString projectName = wxFileName(m_projectRoot).GetFullName();
-    wxString date = wxDateTime::Now().Format("%Y-%m-%d");
-    wxString defaultFilename = "combined_files.txt";
+    // The editor works in UTF-8, so the normalized text goes in without another conversion
+    if (chunk.first)
+    {
+        m_stc->SetUndoCollection(false);
+        m_stc->ClearAll();
+        if (chunk.fileSize <= kLexerSizeLimit)
+            SetEditorLexer(m_previewPath);
+        else
+            m_stc->SetLexer(wxSTC_LEX_NULL);
+    }
+    m_stc->AppendTextRaw(chunk.text.data(), (int)chunk.text.size());
+    m_stc->SetReadOnly(true);
 
-    switch(m_projectType)
+    if (chunk.last)
     {
-        case ProjectType::Godot:
-            defaultFilename = "godot_" + projectName + "_" + date + ".txt";
-            break;
-        case ProjectType::Unity:
-            defaultFilename = "unity_" + projectName + "_" + date + ".txt";
-            break;
-        case ProjectType::Node:
-            defaultFilename = "node_" + projectName + "_" + date + ".txt";
-            break;
-        case ProjectType::None:
-        case ProjectType::Other:
-            defaultFilename = projectName + "_" + date + ".txt";
-            break;
+        m_stc->SetUndoCollection(true);
+        m_stc->EmptyUndoBuffer();
+        if (chunk.fileSize > kLexerSizeLimit)
+            SetStatusText(m_previewPath + " (large file, no syntax highlighting)", 0);
+        UpdatePreviewStats();
     }
+}
 
-    wxFileDialog saveDlg(this, "Save Combined File", "", defaultFilename, 
-                         "Text files (*.txt)|*.txt", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+void MainFrame::UpdatePreviewStats()
+{
 
-    if (saveDlg.ShowModal() == wxID_CANCEL)
+    if (!m_menuBar->IsChecked(ID_PreviewStats))
         return;
 
-    wxString combinedContent;
-    
-    combinedContent += "# -------------------------------------------------------------------------\n";
-    combinedContent += "# Project Structure\n";
-    combinedContent += "# -------------------------------------------------------------------------\n";
-    combinedContent += GenerateProjectTree(); 
-    combinedContent += "\n";
+    PreviewCache::Stats stats = m_previewLoader.GetCache().GetStats();
+    uint64_t lookups = stats.hits + stats.misses;
+    unsigned hitRate = lookups > 0 ? (unsigned)(stats.hits * 100 / lookups) : 0;
+    SetStatusText(wxString::Format("Preview cache: %u%% hits (%lu/%lu, %lu prefetched), %lu files, %.1f MB",
+                                   hitRate, (unsigned long)stats.hits, (unsigned long)lookups, (unsigned long)stats.prefetchHits,
+                                   (unsigned long)stats.entries, stats.bytes / (1024.0 * 1024.0)), 2);
+}
 
-    GetCombinedContent(m_treeCtrl->GetRootItem(), combinedContent);
+void MainFrame::OnSaveCombined(wxCommandEvent& event)
+{
+    SaveExport(nullptr);
+}
 
-    wxTextFile file;
-    if (!file.Create(saveDlg.GetPath()) && !file.Open(saveDlg.GetPath()))
+void MainFrame::OnSaveChanges(wxCommandEvent& event)
+{
+
+    if (m_projectRoot.IsEmpty())
     {
-        wxMessageBox("Could not save file to " + saveDlg.GetPath(), "Error", wxOK | wxICON_ERROR, this);
+        wxMessageBox("Please load a project folder first.", "Error", wxOK | wxICON_ERROR, this);
         return;
     }
 
-    file.Clear();
-    wxStringInputStream sstream(combinedContent);
-    wxTextInputStream tstream(sstream); 
-    while(!sstream.Eof()) 
+    wxFileDialog openDlg(this, "Changes Since Which Export?", wxPathOnly(m_lastManifestPath), wxFileNameFromPath(m_lastManifestPath),
+                         "Export manifests (*.manifest)|*.manifest", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+    if (openDlg.ShowModal() == wxID_CANCEL)
+        return;
+
+    auto previous = std::make_shared<ExportManifest>();
+    if (!previous->Load(std::string(openDlg.GetPath().utf8_str())))
     {
-        file.AddLine(tstream.ReadLine());
+        wxMessageBox("Could not read the manifest " + openDlg.GetPath(), "Error", wxOK | wxICON_ERROR, this);
+        return;
     }
-    file.Write();
-    file.Close();
-
-    SetStatusText("Combined file saved.", 0);
+    SaveExport(previous);
 }
 
-wxString MainFrame::GenerateProjectTree()
+void MainFrame::SaveExport(std::shared_ptr<const ExportManifest> previous)
 {
 
-    wxString treeString;
-    wxTreeItemId rootId = m_treeCtrl->GetRootItem();
-    if (!rootId.IsOk()) return "";
+    if (m_projectRoot.IsEmpty())
+    {
+        wxMessageBox("Please load a project folder first.", "Error", wxOK | wxICON_ERROR, this);
+        return;
+    }
+    if (m_model.IsEmpty())
+    {
+        wxMessageBox("The project is still being scanned.", "Error", wxOK | wxICON_ERROR, this);
+        return;
+    }
+    if (m_exporting)
+    {
+        wxMessageBox("An export is still being written.", "Error", wxOK | wxICON_ERROR, this);
+        return;
+    }
 
-    treeString += m_treeCtrl->GetItemText(rootId) + "/\n";
-    BuildTreeRecursive(rootId, treeString, "    ");
-    return treeString;
-}
+    std::string projectName(wxFileName(m_projectRoot).GetFullName().utf8_str());
+    std::string date(wxDateTime::Now().Format("%Y-%m-%d").utf8_str());
+    std::string fileName = ProjectPresets::GetExportFileName(m_projectType, projectName, date);
+    if (previous)
+        fileName.insert(fileName.size() - 4, "_changes");
 
-void MainFrame::BuildTreeRecursive(const wxTreeItemId& parentId, wxString& treeString, const wxString& indent)
-{
+    // Compressed while it is written, on all cores; the file name says how
+    BlockCompressor::Format compression = m_compressionFormats[m_compressionChoice->GetSelection()];
+    wxString extension = BlockCompressor::GetExtension(compression);
+    wxString defaultFilename = wxString::FromUTF8(fileName) + extension;
+    wxString wildcard = compression == BlockCompressor::Format::None
+                            ? wxString("Text files (*.txt)|*.txt")
+                            : wxString::Format("Compressed text files (*.txt%s)|*.txt%s", extension, extension);
 
-    wxTreeItemIdValue cookie;
-    wxTreeItemId childId = m_treeCtrl->GetFirstChild(parentId, cookie);
+    wxFileDialog saveDlg(this, previous ? "Save Changes" : "Save Combined File", "", defaultFilename, 
+                         wildcard, wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
 
-    while (childId.IsOk())
-    {
-        wxString name = m_treeCtrl->GetItemText(childId);
-        wxTreeItemId nextChildId = m_treeCtrl->GetNextChild(parentId, cookie); 
-        
-        treeString += indent;
-        treeString += (nextChildId.IsOk() ? "├── " : "└── ");
-        treeString += name;
+    if (saveDlg.ShowModal() == wxID_CANCEL)
+        return;
 
-        FileTreeData* data = (FileTreeData*)m_treeCtrl->GetItemData(childId);
-        if (data && wxDir::Exists(data->GetPath()))
+    // Parts are cut while the export streams, by tokens (as counted for the tree) or by size
+    ExportWriter::SplitOptions split;
+    if (m_splitCheck->IsChecked())
+    {
+        uint64_t budget = (uint64_t)m_splitBudget->GetValue();
+        if (m_splitUnit->GetSelection() == 0)
         {
-            treeString += "/\n";
-            wxString nextIndent = indent + (nextChildId.IsOk() ? "│   " : "    ");
-            BuildTreeRecursive(childId, treeString, nextIndent);
+            TokenCounter::Mode mode = m_tokenMode;
+            split.partBudget = budget * 1000;
+            split.measure = [this, mode](std::string_view text) { return (uint64_t)m_tokenCounter.Count(text, mode); };
         }
         else
         {
-            treeString += "\n";
+            split.partBudget = budget * 1024;
         }
-        
-        childId = nextChildId;
     }
-}
 
+    // Streamed straight to disk: memory use does not grow with the size of the export
+    std::string path(saveDlg.GetPath().utf8_str());
+    auto writer = std::make_shared<ExportWriter>();
+    writer->SetCompression(compression);
+    if (!writer->Open(path, split))
+    {
+        wxMessageBox("Could not save file to " + saveDlg.GetPath(), "Error", wxOK | wxICON_ERROR, this);
+        return;
+    }
+
+    ExportPipeline::Options options;
+    options.deduplicate = m_dedupCheck->IsChecked();
+    options.stripComments = m_stripCommentsCheck->IsChecked();
+    CombinedExport::TreeOptions tree;
+    if (m_treeCollapseCheck->IsChecked())
+        tree.collapseOver = (size_t)m_treeCollapseCount->GetValue();
+    if (m_treeDepthCheck->IsChecked())
+        tree.maxDepth = (unsigned)m_treeDepth->GetValue();
+    // A delta export always leaves a manifest for the next one
+    bool writeManifest = previous || m_manifestCheck->IsChecked();
+
+    // Written from a copy of the tree as it is now, so the watcher and the token counts can go on changing the model
+    auto model = std::make_shared<const ProjectModel>(m_model);
+    auto filter = std::make_shared<const ProjectFilter>(m_filter);
+    auto fileTypes = std::make_shared<const FileTypeRegistry>(m_fileTypes);
+    m_exporting = true;
+    m_exportJob.Start([this, model, filter, fileTypes, writer, previous, options, tree, writeManifest, path](JobProgress& progress) {
+        ExportPipeline::Options jobOptions = options;
+        jobOptions.progress = &progress;
+        jobOptions.fileTypes = fileTypes.get();
+        ExportManifest manifest;
+        ExportResult result;
+        result.path = path;
+        result.delta = previous != nullptr;
+        if (previous)
+            result.summary = CombinedExport::WriteChanges(*model, *filter, *writer, *previous, manifest, jobOptions, tree);
+        else
+            result.summary = CombinedExport::Write(*model, *filter, *writer, jobOptions, writeManifest ? &manifest : nullptr, tree);
+        result.savingsReport = CombinedExport::FormatSavings(*fileTypes, result.summary.savings);
+
+        // A cancelled export is never committed; the writer removes what it wrote
+        result.cancelled = progress.IsCancelled();
+        result.failed = !result.cancelled && !writer->Commit();
+        result.partCount = writer->GetPartCount();
+        result.firstPartPath = writer->GetPartPath(1);
+        if (writeManifest && !result.cancelled && !result.failed)
+        {
+            result.manifestPath = ExportManifest::GetPathFor(path);
+            result.manifestFailed = !manifest.Save(result.manifestPath);
+        }
+        CallAfter([this, result] { FinishExport(result); });
+    });
+    SetStatusText("Saving " + saveDlg.GetPath() + "...", 0);
+    UpdateJobProgress();
+}
 
-void MainFrame::GetCombinedContent(const wxTreeItemId& parentId, wxString& combinedContent)
+void MainFrame::FinishExport(const ExportResult& result)
 {
 
-    wxTreeItemIdValue cookie;
-    wxTreeItemId childId = m_treeCtrl->GetFirstChild(parentId, cookie);
+    m_exportJob.Join();
+    m_exporting = false;
+    UpdateJobProgress();
 
-    while (childId.IsOk())
+    wxString path = wxString::FromUTF8(result.path);
+    if (result.cancelled)
     {
-        FileTreeData* data = (FileTreeData*)m_treeCtrl->GetItemData(childId);
-        if (data)
-        {
-            wxString path = data->GetPath();
-            if (wxDir::Exists(path))
-            {
-                GetCombinedContent(childId, combinedContent);
-            }
-            else
-            {
-                wxTextFile file;
-                if (file.Open(path))
-                {
-                    wxString relativePath = GetRelativePath(path); // <-- CHANGED
-
-                    combinedContent += "\n# -------------------------------------------------------------------------\n";
-                    combinedContent += "# " + relativePath + "\n";
-                    combinedContent += "# -------------------------------------------------------------------------\n";
-                    
-                    for (size_t i = 0; i < file.GetLineCount(); ++i)
-                    {
-                        combinedContent += file.GetLine(i) + "\n";
-                    }
-                    file.Close();
-                }
-            }
-        }
-        childId = m_treeCtrl->GetNextChild(parentId, cookie);
+        SetStatusText("Export cancelled.", 0);
+        return;
+    }
+    if (result.failed)
+    {
+        SetStatusText("Export failed.", 0);
+        wxMessageBox("Could not save file to " + path, "Error", wxOK | wxICON_ERROR, this);
+        return;
+    }
+
+    if (!result.manifestPath.empty())
+    {
+        if (result.manifestFailed)
+            wxMessageBox("Could not save the manifest " + wxString::FromUTF8(result.manifestPath), "Error", wxOK | wxICON_ERROR, this);
+        else
+            m_lastManifestPath = wxString::FromUTF8(result.manifestPath);
+    }
+
+    const CombinedExport::Summary& summary = result.summary;
+    wxString status = result.delta ? wxString::Format("Changes saved: %lu files, %lu unchanged left out, %lu deleted",
+                                                      (unsigned long)summary.files, (unsigned long)summary.unchanged,
+                                                      (unsigned long)summary.deleted)
+                                   : wxString("Combined file saved");
+    // A split export is numbered even when it fits in one part, so the name is not the one chosen
+    wxString firstPart = wxFileName(wxString::FromUTF8(result.firstPartPath)).GetFullName();
+    if (result.partCount > 1)
+        status += wxString::Format(" in %u parts, from ", result.partCount) + firstPart;
+    else if (result.firstPartPath != result.path)
+        status += " as " + firstPart;
+    if (summary.duplicates > 0)
+        status += wxString::Format(", %lu duplicate files replaced by a reference", (unsigned long)summary.duplicates);
+
+    // The total goes in the status text, the report per file type in its tooltip
+    CommentStripper::Savings stripped;
+    for (const CommentStripper::Savings& savings : summary.savings)
+    {
+        stripped.bytesIn += savings.bytesIn;
+        stripped.bytesOut += savings.bytesOut;
+    }
+    if (stripped.bytesIn > 0)
+        status += wxString::Format(", comments stripped: %.1f MB saved (%.1f%%)", (stripped.bytesIn - stripped.bytesOut) / (1024.0 * 1024.0),
+                                   100.0 * (stripped.bytesIn - stripped.bytesOut) / stripped.bytesIn);
+    m_statusBar->SetToolTip(result.savingsReport.empty() ? wxString() : "Comments stripped:\n" + wxString::FromUTF8(result.savingsReport));
+    SetStatusText(status + ".", 0);
+}
+
+void MainFrame::UpdateJobProgress()
+{
+
+    // An export is shown in preference to a scan; both can run at once
+    const BackgroundJob* job = m_exportJob.IsRunning() ? &m_exportJob : m_scanJob.IsRunning() ? &m_scanJob : nullptr;
+    bool show = job != nullptr;
+    if (m_jobGauge->IsShown() != show)
+    {
+        m_jobGauge->Show(show);
+        m_jobCancelButton->Show(show);
+        m_leftPanel->Layout();
     }
+    if (!job)
+    {
+        m_jobTimer.Stop();
+        return;
+    }
+
+    // Polled a few times a second, however fast the workers get through files
+    if (!m_jobTimer.IsRunning())
+        m_jobTimer.Start(200);
+    JobProgress::Snapshot snapshot = job->GetProgress().GetSnapshot();
+    if (snapshot.itemsTotal > 0)
+        m_jobGauge->SetValue((int)(std::min(snapshot.items, snapshot.itemsTotal) * 1000 / snapshot.itemsTotal));
+    else
+        m_jobGauge->Pulse();
+    if (job->GetProgress().IsCancelled())
+        SetStatusText("Cancelling...", 0);
+    else if (snapshot.phase[0])
+        SetStatusText(wxString::FromUTF8(snapshot.phase) + ": " + wxString::FromUTF8(JobProgress::Format(snapshot, "files")), 0);
 }
 
+void MainFrame::OnJobTimer(wxTimerEvent& event)
+{
+    UpdateJobProgress();
+}
+
+void MainFrame::OnCancelJob(wxCommandEvent& event)
+{
+
+    // Only asks: the workers stop between files and the job's result comes back as cancelled
+    if (m_exportJob.IsRunning())
+        m_exportJob.RequestCancel();
+    else if (m_scanJob.IsRunning())
+        m_scanJob.RequestCancel();
+    UpdateJobProgress();
+}
 
 // --- Button/Menu Handlers ---
 void MainFrame::OnCopy(wxCommandEvent& event) { m_stc->Copy(); }
@@ -735,89 +1390,50 @@ void MainFrame::OnToggleWordWrap(wxCommandEvent& event)
     }
 }
 
-void MainFrame::OnPresetGodot(wxCommandEvent& event)
+void MainFrame::OnTogglePreviewStats(wxCommandEvent& event)
 {
-    m_ignorePatternsText->SetValue(GODOT_IGNORE_PATTERNS);
-    m_projectType = ProjectType::Godot;
-    UpdateFilterCheckboxes(m_projectType);
-    PopulateFileTree(); 
+
+    // A debugging aid, so the field only exists while it is asked for
+    m_statusBar->SetFieldsCount(m_menuBar->IsChecked(ID_PreviewStats) ? 3 : 2);
+    UpdatePreviewStats();
 }
 
-void MainFrame::OnPresetUnity(wxCommandEvent& event)
+void MainFrame::OnToggleExactTokens(wxCommandEvent& event)
 {
-    m_ignorePatternsText->SetValue(UNITY_IGNORE_PATTERNS);
-    m_projectType = ProjectType::Unity;
-    UpdateFilterCheckboxes(m_projectType);
-    PopulateFileTree(); 
+
+    // Counts of the two modes are never mixed; switching back is answered from the content cache
+    m_tokenMode = event.IsChecked() ? TokenCounter::Mode::Exact : TokenCounter::Mode::Approximate;
+    m_tokenJobCancel = true;
+    ++m_tokenGeneration;
+    m_model.ClearTokenCounts();
+    if (!m_model.IsEmpty())
+    {
+        UpdateTokenTotals();
+        CountTokens();
+    }
 }
 
-void MainFrame::OnPresetNode(wxCommandEvent& event)
+void MainFrame::OnPresetGodot(wxCommandEvent& event) { ApplyPreset(ProjectType::Godot); }
+void MainFrame::OnPresetUnity(wxCommandEvent& event) { ApplyPreset(ProjectType::Unity); }
+void MainFrame::OnPresetNode(wxCommandEvent& event) { ApplyPreset(ProjectType::Node); }
+
+void MainFrame::ApplyPreset(ProjectType type)
 {
-    m_ignorePatternsText->SetValue(NODE_IGNORE_PATTERNS);
-    m_projectType = ProjectType::Node;
+
+    m_ignorePatternsText->ChangeValue(ProjectPresets::GetIgnorePatterns(type));
+    m_projectType = type;
     UpdateFilterCheckboxes(m_projectType);
-    PopulateFileTree(); 
+    RefreshFilters();
 }
 
 void MainFrame::UpdateFilterCheckboxes(ProjectType type)
 {
 
-    m_filterCpp->SetValue(false);
-    m_filterH->SetValue(false);
-    m_filterPy->SetValue(false);
-    m_filterJs->SetValue(false);
-    m_filterHtml->SetValue(false);
-    m_filterCss->SetValue(false);
-    m_filterJson->SetValue(false);
-    m_filterMd->SetValue(false);
-    m_filterGd->SetValue(false);
-    m_filterTscn->SetValue(false);
-    m_filterTres->SetValue(false);
-    m_filterRes->SetValue(false);
-    m_filterCs->SetValue(false);
-    m_filterShader->SetValue(false);
-    m_filterUnity->SetValue(false);
-    m_filterPrefab->SetValue(false);
-    m_filterTs->SetValue(false);
-    m_filterMjs->SetValue(false);
-    m_filterCjs->SetValue(false);
-
-    switch(type)
-    {
-        case ProjectType::Godot:
-            m_filterGd->SetValue(true);
-            m_filterTscn->SetValue(true); 
-            m_filterTres->SetValue(true);
-            m_filterRes->SetValue(true);
-            m_filterShader->SetValue(true); 
-            m_filterJson->SetValue(true); 
-            break;
-        case ProjectType::Unity:
-            m_filterCs->SetValue(true);
-            m_filterShader->SetValue(true);
-            m_filterUnity->SetValue(true);
-            m_filterPrefab->SetValue(true);
-            m_filterJson->SetValue(true); 
-            break;
-        case ProjectType::Node:
-            m_filterJs->SetValue(true);
-            m_filterTs->SetValue(true);
-            m_filterMjs->SetValue(true);
-            m_filterCjs->SetValue(true);
-            m_filterJson->SetValue(true); 
-            m_filterMd->SetValue(true); 
-            break;
-        case ProjectType::None:
-        case ProjectType::Other:
-            m_filterCpp->SetValue(true);
-            m_filterH->SetValue(true);
-            m_filterPy->SetValue(true);
-            m_filterJs->SetValue(true);
-            m_filterHtml->SetValue(true);
-            m_filterCss->SetValue(true);
-            m_filterJson->SetValue(true);
-            m_filterMd->SetValue(true);
-            break;
+    const char* preset = ProjectPresets::GetName(type);
+    for (size_t i = 0; i < m_fileTypeChecks.size(); ++i)
+    {
+        if (m_fileTypeChecks[i])
+            m_fileTypeChecks[i]->SetValue(m_fileTypes.IsInPreset(i, preset));
     }
 }
 
@@ -836,24 +1452,25 @@ wxString MainFrame::GetRelativePath(const wxString& fullPath)
 
 // --- ADDED: All New Event Handlers ---
 
-void MainFrame::OnTreeRightClick(wxTreeEvent& event)
+void MainFrame::OnTreeRightClick(wxDataViewEvent& event)
 {
-    wxTreeItemId itemId = event.GetItem();
-    if (!itemId.IsOk() || itemId == m_treeCtrl->GetRootItem())
+    wxDataViewItem item = event.GetItem();
+    if (!item.IsOk())
     {
-        return; // Don't show menu for root or invalid item
+        return; // Don't show menu for empty space (the root is never shown)
     }
 
-    m_treeCtrl->SelectItem(itemId); // Select the item that was right-clicked
+    m_treeCtrl->Select(item); // Select the item that was right-clicked
 
-    FileTreeData* data = (FileTreeData*)m_treeCtrl->GetItemData(itemId);
-    if (!data) return;
+    uint32_t index = ProjectTreeModel::ToNode(item);
+    const ProjectNode& node = m_model.GetNode(index);
 
-    m_rightClickedPath = data->GetPath(); // Store the path for the handlers
-    bool isDir = wxDir::Exists(m_rightClickedPath);
+    m_rightClickedPath = wxString::FromUTF8(m_model.GetFullPath(index)); // Store the path for the handlers
+    m_rightClickedIsDir = node.isDir;
+    bool isDir = m_rightClickedIsDir;
 
     wxMenu contextMenu;
-    contextMenu.Append(ID_IgnoreItem, "Ignore \"" + m_treeCtrl->GetItemText(itemId) + "\"");
+    contextMenu.Append(ID_IgnoreItem, "Ignore \"" + wxString::FromUTF8(node.name) + "\"");
     
     if (!isDir)
     {
@@ -881,13 +1498,13 @@ void MainFrame::OnIgnoreItem(wxCommandEvent& event)
 
     wxString relativePath = GetRelativePath(m_rightClickedPath);
     
-    if (wxDir::Exists(m_rightClickedPath))
+    if (m_rightClickedIsDir)
     {
         relativePath += "/"; // Add trailing slash for directories
     }
 
     m_ignorePatternsText->AppendText("\n" + relativePath);
-    PopulateFileTree(); // This will re-trigger settings changed
+    RefreshFilters();
 }
 
 void MainFrame::OnIgnoreExtension(wxCommandEvent& event)
@@ -898,7 +1515,7 @@ void MainFrame::OnIgnoreExtension(wxCommandEvent& event)
     if (!ext.IsEmpty())
     {
         m_ignorePatternsText->AppendText("\n*." + ext);
-        PopulateFileTree(); // This will re-trigger settings changed
+        RefreshFilters();
     }
 }
 
@@ -925,8 +1542,8 @@ void MainFrame::OnLoadIgnoreFile(wxCommandEvent& event)
     }
     file.Close();
 
-    m_ignorePatternsText->SetValue(content);
-    PopulateFileTree(); // Will trigger settings changed
+    m_ignorePatternsText->ChangeValue(content);
+    RefreshFilters();
 }
 
 void MainFrame::OnSaveIgnoreFile(wxCommandEvent& event)
@@ -2,92 +2,152 @@
 
 #include <wx/wx.h>
 #include <wx/stc/stc.h> // For wxStyledTextCtrl
-#include <wx/treectrl.h>  // For wxTreeCtrl
+#include <wx/dataview.h> // For wxDataViewCtrl (virtual project tree)
 #include <wx/collpane.h> // For wxCollapsiblePane (accordion)
 #include <wx/textctrl.h> // For wxTextCtrl (ignore patterns)
 #include <wx/checkbox.h> // For wxCheckBox
+#include <wx/spinctrl.h> // For wxSpinCtrl (export part size)
+#include <wx/choice.h>
+#include <wx/gauge.h>
 #include <wx/dir.h>
 #include <wx/filedlg.h>
 #include <wx/dirdlg.h>
 #include <wx/filename.h>
 #include <wx/stdpaths.h>
 #include <wx/msgdlg.h>
-#include <wx/imaglist.h> // <-- ADDED: Header for wxImageList
+#include <wx/timer.h>
 
-// This class will hold file data in our tree
-class FileTreeData : public wxTreeItemData
-{
-public:
-    FileTreeData(const wxString& path) : m_path(path) {}
-    const wxString& GetPath() const { return m_path; }
-private:
-    wxString m_path;
-};
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BackgroundJob.h"
+#include "CombinedExport.h"
+#include "ContentSniffer.h"
+#include "DirectoryScanner.h"
+#include "DirectoryWatcher.h"
+#include "EntryRules.h"
+#include "FileTypeRegistry.h"
+#include "PreviewLoader.h"
+#include "ProjectFilter.h"
+#include "ProjectPresets.h"
+#include "ProjectTreeModel.h"
+#include "ScanIndex.h"
+#include "TextNormalizer.h"
+#include "TokenCounter.h"
 
 class MainFrame : public wxFrame
 {
 public:
     MainFrame(const wxString& title, const wxPoint& pos, const wxSize& size);
+    ~MainFrame();
 
 private:
     // --- Core UI Components ---
     wxPanel* m_leftPanel;
     wxPanel* m_rightPanel;
-    wxTreeCtrl* m_treeCtrl;
+    wxDataViewCtrl* m_treeCtrl;
+    ProjectTreeModel* m_treeModel; // Owned by m_treeCtrl
     wxStyledTextCtrl* m_stc;
     wxStatusBar* m_statusBar;
     wxMenuBar* m_menuBar; // <-- ADDED: Make menu bar a member
+    wxGauge* m_jobGauge;         // Shown while a scan or export runs
+    wxButton* m_jobCancelButton;
 
     // --- Sidebar Settings Components ---
     wxCollapsiblePane* m_settingsPane;
     wxCheckBox* m_showHiddenCheck;
+    wxCheckBox* m_useGitignoreCheck;
     wxTextCtrl* m_ignorePatternsText;
+    wxCheckBox* m_splitCheck;
+    wxSpinCtrl* m_splitBudget;
+    wxChoice* m_splitUnit; // k tokens or KiB
+    wxCheckBox* m_treeCollapseCheck;
+    wxSpinCtrl* m_treeCollapseCount; // entries a folder may have before its files become a summary line
+    wxCheckBox* m_treeDepthCheck;
+    wxSpinCtrl* m_treeDepth;
+    wxCheckBox* m_dedupCheck;
+    wxCheckBox* m_stripCommentsCheck;
+    wxCheckBox* m_manifestCheck;
+    wxChoice* m_compressionChoice;
+    std::vector<BlockCompressor::Format> m_compressionFormats; // per entry of m_compressionChoice, available ones only
 
     wxCollapsiblePane* m_filterPane;
-    // --- Filter Checkboxes (Expanded) ---
-    wxCheckBox* m_filterCpp;
-    wxCheckBox* m_filterH;
-    wxCheckBox* m_filterPy;
-    wxCheckBox* m_filterJs;
-    wxCheckBox* m_filterHtml;
-    wxCheckBox* m_filterCss;
-    wxCheckBox* m_filterJson;
-    wxCheckBox* m_filterMd;
-    // Godot
-    wxCheckBox* m_filterGd;
-    wxCheckBox* m_filterTscn;
-    wxCheckBox* m_filterTres;
-    wxCheckBox* m_filterRes;
-    // Unity
-    wxCheckBox* m_filterCs;
-    wxCheckBox* m_filterShader;
-    wxCheckBox* m_filterUnity;
-    wxCheckBox* m_filterPrefab;
-    // Node
-    wxCheckBox* m_filterTs;
-    wxCheckBox* m_filterMjs;
-    wxCheckBox* m_filterCjs;
+    // One checkbox per filterable entry of m_fileTypes (nullptr for highlight-only types)
+    std::vector<wxCheckBox*> m_fileTypeChecks;
     
     // --- Internal State ---
     wxString m_projectRoot;
-    wxArrayString m_ignorePatterns;
-    wxImageList* m_imageList; 
+    DirectoryScanner m_scanner;
+    ProjectModel m_model;                 // Raw scan, independent of the filters
+    ProjectFilter m_filter;               // Visibility of m_model nodes under the current settings
+    wxTimer m_refilterTimer;              // Debounces typing in the ignore box
+    DirectoryWatcher m_watcher;           // Keeps m_model in sync with the disk
+    std::thread m_indexCheck;             // Compares folder and sniffed file stamps with the disk after an index load or lost watcher events
+    TokenCounter m_tokenCounter;          // Exact with cl100k_base.tiktoken from the user data dir
+    TokenCounter::Mode m_tokenMode;
+    std::thread m_tokenJob;               // Counts visible files that have no count yet
+    std::atomic<bool> m_tokenJobCancel;
+    unsigned m_tokenGeneration;           // Bumped when running counts become stale (new project, mode switch)
+    bool m_tokenRecount;                  // More files need counting once the running job is done
+    PreviewLoader m_previewLoader;        // Reads the selected file off the UI thread
+    unsigned m_previewGeneration;         // Bumped per preview, so chunks of an abandoned one are dropped
+    wxString m_previewPath;
+    // Settings captured before a scan; the scanner threads read these, never the widgets
+    EntryRules m_rules;
+    FileTypeRegistry m_fileTypes; // Built-in defaults, or languages.conf from the user data dir
     wxString m_rightClickedPath; // <-- ADDED: For context menu
-    
-    enum class ProjectType { None, Godot, Unity, Node, Other };
+    bool m_rightClickedIsDir;
     ProjectType m_projectType;
+    wxString m_lastManifestPath; // written by the last export, offered for the next delta export
+    BackgroundJob m_scanJob;              // Reads a project that has no scan index yet, or sniffs files made visible
+    unsigned m_scanGeneration;            // Bumped per job, so the result of a replaced scan is dropped
+    unsigned m_projectGeneration;         // Jobs started before this one read another project
+    unsigned m_contentGeneration;         // Sniffs started before this one are stale (another project, a file saved)
+    std::vector<uint32_t> m_pendingRescans; // Visible folders the watcher wants read again
+    std::vector<uint32_t> m_pendingRefreshes; // Visible folders whose entries changed since they were read (index check)
+    bool m_rereadPending;                 // More folders or files became visible while the job was running
+    bool m_refilterPending;               // The settings changed while the first scan of the project was running
+    BackgroundJob m_exportJob;            // Writes an export from a copy of the tree
+    bool m_exporting;                     // From the start of an export until its result is shown
+    wxTimer m_jobTimer;                   // Polls the running job's progress
+
+    // What an export job hands back to the UI thread
+    struct ExportResult
+    {
+        std::string path;
+        bool delta = false;
+        bool cancelled = false;
+        bool failed = false;
+        CombinedExport::Summary summary;
+        std::string savingsReport; // per file type, if comments were stripped
+        unsigned partCount = 0;
+        std::string firstPartPath; // differs from path when the export was split
+        std::string manifestPath; // empty if no manifest was written
+        bool manifestFailed = false;
+    };
 
     // --- Event Handlers ---
     void OnLoadProject(wxCommandEvent& event);
     void OnSaveCombined(wxCommandEvent& event);
-    void OnTreeSelectionChanged(wxTreeEvent& event);
-    void OnTreeRightClick(wxTreeEvent& event); // <-- ADDED
+    void OnSaveChanges(wxCommandEvent& event);
+    void OnTreeSelectionChanged(wxDataViewEvent& event);
+    void OnTreeRightClick(wxDataViewEvent& event); // <-- ADDED
     void OnCopy(wxCommandEvent& event);
     void OnSelectAll(wxCommandEvent& event);
     void OnExit(wxCommandEvent& event);
     void OnAbout(wxCommandEvent& event);
     void OnSettingsChanged(wxCommandEvent& event); // For filters/hidden
+    void OnRefilterTimer(wxTimerEvent& event);
+    void OnActivate(wxActivateEvent& event);
+    void OnClose(wxCloseEvent& event);
     void OnToggleWordWrap(wxCommandEvent& event);
+    void OnToggleExactTokens(wxCommandEvent& event);
+    void OnTogglePreviewStats(wxCommandEvent& event);
+    void OnJobTimer(wxTimerEvent& event);
+    void OnCancelJob(wxCommandEvent& event);
     // Preset Handlers
     void OnPresetGodot(wxCommandEvent& event);
     void OnPresetUnity(wxCommandEvent& event);
@@ -106,18 +166,45 @@ private:
     void SetupMenuBar();
     void SetupEditorStyles();
     void SetEditorLexer(const wxString& filePath);
+    void LoadFileTypes();
+    void LoadTokenizer();
     
     void PopulateFileTree();
-    void ScanDirectoryRecursive(const wxString& path, const wxTreeItemId& parentId);
-    bool ShouldIgnore(const wxString& path, bool isDir);
-    bool IsFileTypeFiltered(const wxString& path);
-
-    wxString GenerateProjectTree(); 
-    void BuildTreeRecursive(const wxTreeItemId& parentId, wxString& treeString, const wxString& indent); 
+    void ApplyScan(unsigned generation, const std::shared_ptr<ProjectModel>& model, bool cancelled);
+    void ShowProject();
+    void RefreshFilters();
+    void ApplyFilters();
+    void ReadVisibleEntries(std::vector<uint32_t> directories);
+    void ApplyDirectoryScans(unsigned generation, const std::vector<uint32_t>& directories,
+                             const std::vector<std::shared_ptr<DirectoryScanner::PendingScan>>& scans, bool cancelled);
+    void SniffVisibleFiles();
+    void ApplyContentKinds(unsigned generation, const std::vector<uint32_t>& files,
+                           const std::vector<DirectoryScanner::SniffedFile>& sniffed);
+    void ApplyWatchBatch(const DirectoryWatcher::Batch& batch);
+    void RescanDirectory(uint32_t dirIndex);
+    void RefreshDirectory(uint32_t dirIndex);
+    void ForgetFileContents(const std::vector<uint32_t>& files); // rewritten on disk: sniffed and counted again
+    void CheckStamps(std::vector<DirectoryScanner::DirectoryStamp> directories);
+    void ApplyIndexCheck(const std::string& rootPath, const std::vector<uint32_t>& changed,
+                         const std::vector<uint32_t>& rewritten);
+    std::string GetIndexPath(const std::string& rootPath) const;
+    void SaveIndex();
+    void UpdateWatchedDirectories();
+    void CountTokens();
+    void ApplyTokenCounts(unsigned generation, const std::vector<uint32_t>& files, const std::vector<uint32_t>& counts);
+    void UpdateTokenTotals();
+    wxString GetTotalsText() const;
+    void SnapshotFilterSettings();
 
-    void GetCombinedContent(const wxTreeItemId& parentId, wxString& combinedContent);
-    void LoadFileContent(const wxString& filePath);
+    void LoadFileContent(const wxString& filePath, std::vector<std::string> prefetch = {});
+    std::vector<std::string> GetPrefetchPaths(uint32_t index) const;
+    void UpdatePreviewStats();
+    void AppendPreviewChunk(unsigned generation, const PreviewLoader::Chunk& chunk);
+    void SaveExport(std::shared_ptr<const ExportManifest> previous); // previous: only what changed since that export
+    void FinishExport(const ExportResult& result);
+    void UpdateJobProgress();
 
+    void ApplyPreset(ProjectType type);
     void UpdateFilterCheckboxes(ProjectType type); 
 
     wxString GetRelativePath(const wxString& fullPath); // <-- ADDED
@@ -126,10 +213,14 @@ private:
     enum {
         ID_LoadProject = wxID_HIGHEST + 1,
         ID_SaveCombined,
+        ID_SaveChanges,
         ID_Copy,
         ID_SelectAll,
         ID_SettingsChanged,
         ID_ToggleWordWrap,
+        ID_ExactTokens,
+        ID_PreviewStats,
+        ID_CancelJob,
         ID_PresetGodot,
         ID_PresetUnity,
         ID_PresetNode,
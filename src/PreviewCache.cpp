@@ -0,0 +1,72 @@
+#include "PreviewCache.h"
+
+std::shared_ptr<const std::string> PreviewCache::Find(const std::string& path, const FileStamp& stamp)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_index.find(path);
+    if (found == m_index.end() || found->second->stamp != stamp)
+    {
+        if (found != m_index.end())
+            Remove(found->second);
+        ++m_stats.misses;
+        return nullptr;
+    }
+
+    EntryList::iterator entry = found->second;
+    ++m_stats.hits;
+    if (entry->prefetched)
+    {
+        ++m_stats.prefetchHits;
+        entry->prefetched = false;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, entry);
+    return entry->text;
+}
+
+bool PreviewCache::Contains(const std::string& path, const FileStamp& stamp) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_index.find(path);
+    return found != m_index.end() && found->second->stamp == stamp;
+}
+
+void PreviewCache::Insert(const std::string& path, const FileStamp& stamp, std::shared_ptr<const std::string> text, bool prefetched)
+{
+    if (!text || text->size() > GetMaxEntrySize())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_index.find(path);
+    if (found != m_index.end())
+        Remove(found->second);
+
+    m_stats.bytes += text->size();
+    m_entries.push_front(Entry{ path, stamp, std::move(text), prefetched });
+    m_index.emplace(path, m_entries.begin());
+    while (m_stats.bytes > m_maxBytes && m_entries.size() > 1)
+        Remove(std::prev(m_entries.end()));
+    m_stats.entries = m_entries.size();
+}
+
+void PreviewCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_index.clear();
+    m_stats.entries = 0;
+    m_stats.bytes = 0;
+}
+
+PreviewCache::Stats PreviewCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void PreviewCache::Remove(EntryList::iterator entry)
+{
+    m_stats.bytes -= entry->text->size();
+    m_index.erase(entry->path);
+    m_entries.erase(entry);
+    m_stats.entries = m_entries.size();
+}
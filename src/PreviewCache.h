@@ -0,0 +1,59 @@
+#pragma once
+
+#include "FileStamp.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Decoded preview texts of recently viewed (or prefetched) files, least
+// recently used first out once the byte budget is reached. An entry only
+// counts while the file still has the size and modification time it was read
+// with. Safe to use from several threads.
+class PreviewCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t prefetchHits = 0; // hits on entries that were prefetched and not viewed before
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    explicit PreviewCache(size_t maxBytes = 64 * 1024 * 1024) : m_maxBytes(maxBytes) {}
+
+    // Files above this are not kept, so one big file cannot flush everything else
+    size_t GetMaxEntrySize() const { return m_maxBytes / 8; }
+
+    // Counted as a hit or a miss; a stale entry is dropped
+    std::shared_ptr<const std::string> Find(const std::string& path, const FileStamp& stamp);
+    // Not counted: for the prefetcher, to skip files that are already there
+    bool Contains(const std::string& path, const FileStamp& stamp) const;
+    void Insert(const std::string& path, const FileStamp& stamp, std::shared_ptr<const std::string> text, bool prefetched);
+    void Clear();
+
+    Stats GetStats() const;
+
+private:
+    struct Entry
+    {
+        std::string path;
+        FileStamp stamp;
+        std::shared_ptr<const std::string> text;
+        bool prefetched;
+    };
+    using EntryList = std::list<Entry>;
+
+    void Remove(EntryList::iterator entry);
+
+    mutable std::mutex m_mutex;
+    EntryList m_entries; // most recently used first
+    std::unordered_map<std::string, EntryList::iterator> m_index;
+    size_t m_maxBytes;
+    Stats m_stats;
+};
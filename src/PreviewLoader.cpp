@@ -0,0 +1,169 @@
+#include "PreviewLoader.h"
+#include "ContentSniffer.h"
+#include "TextNormalizer.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+void PreviewLoader::Start(const std::string& path, ChunkCallback callback, std::vector<std::string> prefetch)
+{
+    Cancel();
+    m_cancel = false;
+    m_thread = std::thread([this, path, callback = std::move(callback), prefetch = std::move(prefetch)]
+    {
+        Load(path, callback);
+        Prefetch(prefetch);
+    });
+}
+
+void PreviewLoader::Cancel()
+{
+    // The loader checks between chunks, prefetched ones included, so this waits for one of them at most
+    m_cancel = true;
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void PreviewLoader::Load(const std::string& path, const ChunkCallback& callback)
+{
+    auto chunk = std::make_shared<Chunk>();
+    chunk->first = true;
+
+    // The stamp is taken before the read: if the file changes in between, the entry is stale on the next look.
+    // A cached file costs this one stat; the file is only opened on a miss.
+    FileStamp stamp;
+    std::ifstream file;
+    std::shared_ptr<const std::string> cached;
+    bool opened = FileStamp::Read(path, stamp);
+    if (opened && !(cached = m_cache.Find(path, stamp)))
+    {
+        file.open(std::filesystem::u8path(path), std::ios::binary);
+        opened = (bool)file;
+    }
+    if (!opened)
+    {
+        chunk->failed = true;
+        chunk->last = true;
+        callback(chunk);
+        return;
+    }
+    chunk->fileSize = stamp.size;
+
+    if (cached)
+    {
+        chunk->text = *cached;
+        chunk->last = true;
+        callback(chunk);
+        return;
+    }
+
+    // Small enough to cache: the chunks are collected as they go out
+    size_t size = (size_t)stamp.size;
+    std::string whole;
+    bool keep = size <= m_cache.GetMaxEntrySize();
+    if (keep)
+        whole.reserve(size + 1);
+
+    // Read, not mapped: a log truncated or rotated while it loads would fault on the mapped pages.
+    // A file that shrinks ends early, one that grows is shown up to the size in the stamp.
+    // Chunks grow as the load goes on: the first shows up at once, later ones cost fewer UI updates
+    TextNormalizer normalizer;
+    std::vector<char> buffer;
+    size_t offset = 0;
+    size_t chunkSize = kFirstChunkSize;
+    for (;;)
+    {
+        size_t wanted = std::min(chunkSize, size - offset);
+        size_t piece = ReadPiece(file, wanted, buffer);
+        if (chunk->first && ContentSniffer::IsBinary(buffer.data(), std::min<size_t>(piece, ContentSniffer::kBlockSize)))
+        {
+            chunk->text = ContentSniffer::GetPlaceholder();
+            chunk->last = true;
+            m_cache.Insert(path, stamp, std::make_shared<const std::string>(chunk->text), false);
+            callback(chunk);
+            return;
+        }
+
+        chunk->text.reserve(piece + 1);
+        normalizer.Feed(buffer.data(), piece, chunk->text);
+        offset += piece;
+        if (offset == size || piece < wanted)
+        {
+            normalizer.Finish(chunk->text);
+            chunk->last = true;
+            keep = keep && piece == wanted;
+        }
+
+        if (m_cancel)
+            return;
+        if (keep)
+            whole += chunk->text;
+        callback(chunk);
+        if (chunk->last)
+            break;
+
+        auto next = std::make_shared<Chunk>();
+        next->fileSize = chunk->fileSize;
+        chunk = std::move(next);
+        chunkSize = std::min(chunkSize * 4, kMaxChunkSize);
+    }
+
+    if (keep)
+        m_cache.Insert(path, stamp, std::make_shared<const std::string>(std::move(whole)), false);
+}
+
+void PreviewLoader::Prefetch(const std::vector<std::string>& paths)
+{
+    std::vector<char> buffer;
+    for (const std::string& path : paths)
+    {
+        if (m_cancel)
+            return;
+
+        FileStamp stamp;
+        if (!FileStamp::Read(path, stamp) || stamp.size > m_cache.GetMaxEntrySize() || m_cache.Contains(path, stamp))
+            continue;
+        std::ifstream file(std::filesystem::u8path(path), std::ios::binary);
+        if (!file)
+            continue;
+
+        // Each piece may wait on a slow disk; a cancel, or a file that shrank meanwhile, leaves it out of the cache
+        size_t size = (size_t)stamp.size;
+        auto text = std::make_shared<std::string>();
+        TextNormalizer normalizer;
+        bool complete = true;
+        for (size_t offset = 0; offset < size; offset += kPrefetchChunkSize)
+        {
+            if (m_cancel)
+                return;
+            size_t wanted = std::min(kPrefetchChunkSize, size - offset);
+            size_t piece = ReadPiece(file, wanted, buffer);
+            if (offset == 0 && ContentSniffer::IsBinary(buffer.data(), std::min<size_t>(piece, ContentSniffer::kBlockSize)))
+            {
+                *text = ContentSniffer::GetPlaceholder();
+                break;
+            }
+            if (offset == 0)
+                text->reserve(size + 1);
+            normalizer.Feed(buffer.data(), piece, *text);
+            if (piece < wanted)
+            {
+                complete = false;
+                break;
+            }
+            if (offset + piece == size)
+                normalizer.Finish(*text);
+        }
+        if (complete)
+            m_cache.Insert(path, stamp, std::move(text), true);
+    }
+}
+
+size_t PreviewLoader::ReadPiece(std::ifstream& file, size_t size, std::vector<char>& buffer)
+{
+    if (buffer.size() < size)
+        buffer.resize(size);
+    file.read(buffer.data(), (std::streamsize)size);
+    return (size_t)file.gcount();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "PreviewCache.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loads a file for the preview on a thread of its own, so the UI thread never
+// touches the disk. The file is read and handed over in chunks of normalized
+// UTF-8 (see TextNormalizer): a small first one that fills the editor at once,
+// then larger ones until the end. Binary files arrive as the one-line
+// placeholder. It is read rather than mapped because the file may still be
+// written to: a mapped log that is truncated meanwhile would crash the reader.
+//
+// Files up to the cache's entry limit are kept decoded in a PreviewCache, so
+// going back to one costs a stat and a copy. After a load finishes, the loader
+// goes on to read the files it was told the user is likely to open next.
+//
+// Starting another load cancels the running one; the callback runs on the
+// loader thread and is never called for a load after it was cancelled.
+class PreviewLoader
+{
+public:
+    struct Chunk
+    {
+        std::string text;
+        uint64_t fileSize = 0;
+        bool first = false;
+        bool last = false;
+        bool failed = false; // could not be opened; the only chunk
+    };
+    using ChunkCallback = std::function<void(std::shared_ptr<Chunk> chunk)>;
+
+    static constexpr size_t kFirstChunkSize = 64 * 1024;   // comfortably more than a screenful
+    static constexpr size_t kMaxChunkSize = 4 * 1024 * 1024;
+    // Prefetching reads this much between checks for a cancel, so a click never waits on more
+    static constexpr size_t kPrefetchChunkSize = 256 * 1024;
+
+    PreviewLoader() = default;
+    ~PreviewLoader() { Cancel(); }
+
+    PreviewLoader(const PreviewLoader&) = delete;
+    PreviewLoader& operator=(const PreviewLoader&) = delete;
+
+    // prefetch: read into the cache after path is done, in this order
+    void Start(const std::string& path, ChunkCallback callback, std::vector<std::string> prefetch = {});
+    void Cancel();
+
+    const PreviewCache& GetCache() const { return m_cache; }
+
+private:
+    void Load(const std::string& path, const ChunkCallback& callback);
+    void Prefetch(const std::vector<std::string>& paths);
+    // Reads up to size bytes into buffer; fewer at the end of the file
+    static size_t ReadPiece(std::ifstream& file, size_t size, std::vector<char>& buffer);
+
+    PreviewCache m_cache;
+    std::thread m_thread;
+    std::atomic<bool> m_cancel{ false };
+};
@@ -0,0 +1,131 @@
+#include "ProjectFilter.h"
+#include "DirectoryScanner.h"
+
+std::vector<uint32_t> ProjectFilter::Apply(const ProjectModel& model, const EntryFilter& filter)
+{
+    m_visible.assign(model.GetNodeCount(), 0);
+    if (model.IsEmpty())
+        return {};
+
+    m_visible[model.GetRoot()] = 1;
+    return ApplySubtree(model, model.GetRoot(), filter);
+}
+
+std::vector<uint32_t> ProjectFilter::ApplySubtree(const ProjectModel& model, uint32_t dirIndex, const EntryFilter& filter)
+{
+    m_visible.resize(model.GetNodeCount(), 0);
+
+    std::vector<uint32_t> unscanned;
+    if (m_visible[dirIndex])
+    {
+        std::string path = model.GetRelativePath(dirIndex);
+        ApplyRecursive(model, dirIndex, path, filter, unscanned);
+    }
+    CountVisibleFiles(model);
+    return unscanned;
+}
+
+void ProjectFilter::ApplyAndScan(ProjectModel& model, DirectoryScanner& scanner, const EntryFilter& filter)
+{
+    std::vector<uint32_t> unscanned = Apply(model, filter);
+
+    // Directories that were ignored at scan time and are visible now get read on demand
+    while (!unscanned.empty())
+    {
+        uint32_t dirIndex = unscanned.back();
+        unscanned.pop_back();
+        scanner.ScanInto(model, dirIndex);
+        std::vector<uint32_t> nested = ApplySubtree(model, dirIndex, filter);
+        unscanned.insert(unscanned.end(), nested.begin(), nested.end());
+    }
+
+    // Every file that can end up in the export is sniffed once
+    scanner.DetectContentKinds(model, GetUnsniffedFiles(model));
+}
+
+std::vector<uint32_t> ProjectFilter::GetUnsniffedFiles(const ProjectModel& model) const
+{
+    std::vector<uint32_t> unsniffed;
+    for (uint32_t i = 0; i < model.GetNodeCount(); ++i)
+    {
+        const ProjectNode& node = model.GetNode(i);
+        if (!node.isDir && node.content == ContentKind::Unknown && IsVisible(i))
+            unsniffed.push_back(i);
+    }
+    return unsniffed;
+}
+
+void ProjectFilter::ApplyRecursive(const ProjectModel& model, uint32_t dirIndex, std::string& path,
+                                   const EntryFilter& filter, std::vector<uint32_t>& unscanned)
+{
+    const ProjectNode& dir = model.GetNode(dirIndex);
+    if (!dir.scanned)
+    {
+        unscanned.push_back(dirIndex);
+        return;
+    }
+
+    // The relative path is built in place while descending instead of per node
+    const size_t baseLength = path.size();
+    for (uint32_t index : dir.children)
+    {
+        const ProjectNode& node = model.GetNode(index);
+        if (baseLength > 0)
+            path += '/';
+        path += node.name;
+
+        bool visible = filter(path, node.name, node.isDir, dir.ignoreScope.get());
+        m_visible[index] = visible;
+        if (visible && node.isDir)
+            ApplyRecursive(model, index, path, filter, unscanned);
+
+        path.resize(baseLength);
+    }
+}
+
+void ProjectFilter::CountVisibleFiles(const ProjectModel& model)
+{
+    m_visibleFiles = 0;
+    m_fileCounts.assign(m_visible.size(), 0);
+
+    // As in SumTokens(): children come after their parent, so one backward pass totals every folder
+    for (uint32_t i = (uint32_t)m_visible.size(); i-- > 0;)
+    {
+        if (!m_visible[i])
+            continue;
+
+        const ProjectNode& node = model.GetNode(i);
+        if (!node.isDir)
+        {
+            ++m_visibleFiles;
+            m_fileCounts[i] = 1;
+        }
+        if (i != model.GetRoot())
+            m_fileCounts[node.parent] += m_fileCounts[i];
+    }
+}
+
+void ProjectFilter::SumTokens(const ProjectModel& model)
+{
+    m_tokens.assign(model.GetNodeCount(), 0);
+    m_uncountedFiles = 0;
+
+    // Nodes always come after their parent in the table, so one backward pass totals every folder
+    for (uint32_t i = (uint32_t)model.GetNodeCount(); i-- > 1;)
+    {
+        if (!IsVisible(i))
+            continue;
+
+        const ProjectNode& node = model.GetNode(i);
+        if (!node.isDir)
+        {
+            if (node.tokens == ProjectModel::kUncounted)
+            {
+                ++m_uncountedFiles;
+                continue;
+            }
+            m_tokens[i] = node.tokens;
+        }
+        m_tokens[node.parent] += m_tokens[i];
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ProjectModel.h"
+
+#include <cstdint>
+#include <vector>
+
+class DirectoryScanner;
+
+// Visibility of every model node under the current settings. Re-running the
+// filter only walks the in-memory model, so settings changes never touch the disk.
+class ProjectFilter
+{
+public:
+    // Recomputes visibility for the whole model. Returns visible directories
+    // that were never scanned; the caller reads them and calls ApplySubtree().
+    std::vector<uint32_t> Apply(const ProjectModel& model, const EntryFilter& filter);
+    std::vector<uint32_t> ApplySubtree(const ProjectModel& model, uint32_t dirIndex, const EntryFilter& filter);
+
+    // Apply() followed by the reads it calls for: visible directories that were
+    // never scanned are read, and visible files are sniffed for binary content,
+    // so the export and the preview know every binary file up front.
+    void ApplyAndScan(ProjectModel& model, DirectoryScanner& scanner, const EntryFilter& filter);
+
+    // Visible files that were never sniffed
+    std::vector<uint32_t> GetUnsniffedFiles(const ProjectModel& model) const;
+
+    bool IsVisible(uint32_t index) const { return index < m_visible.size() && m_visible[index]; }
+    size_t GetVisibleFileCount() const { return m_visibleFiles; }
+    // Visible files anywhere below a visible folder
+    size_t GetVisibleFileCount(uint32_t dirIndex) const { return dirIndex < m_fileCounts.size() ? m_fileCounts[dirIndex] : 0; }
+
+    // Adds up the token counts of the visible files for every visible folder.
+    // Cheap enough to redo after every refilter or batch of new counts.
+    void SumTokens(const ProjectModel& model);
+    uint64_t GetTokenTotal(uint32_t index) const { return index < m_tokens.size() ? m_tokens[index] : 0; }
+    size_t GetUncountedFileCount() const { return m_uncountedFiles; } // visible files not counted yet
+
+private:
+    void ApplyRecursive(const ProjectModel& model, uint32_t dirIndex, std::string& path,
+                        const EntryFilter& filter, std::vector<uint32_t>& unscanned);
+    void CountVisibleFiles(const ProjectModel& model);
+
+    std::vector<char> m_visible;
+    size_t m_visibleFiles = 0;
+    std::vector<uint32_t> m_fileCounts; // per folder, see GetVisibleFileCount()
+    std::vector<uint64_t> m_tokens;
+    size_t m_uncountedFiles = 0;
+};
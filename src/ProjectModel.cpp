@@ -0,0 +1,145 @@
+#include "ProjectModel.h"
+#include "IgnoreMatcher.h"
+
+#include <algorithm>
+
+ProjectModel::ProjectModel(const std::string& rootPath)
+    : m_rootPath(rootPath)
+{
+    while (m_rootPath.size() > 1 && (m_rootPath.back() == '/' || m_rootPath.back() == '\\'))
+        m_rootPath.pop_back();
+
+    std::string rootName = m_rootPath;
+    size_t slash = rootName.find_last_of("/\\");
+    if (slash != std::string::npos && slash + 1 < rootName.size())
+        rootName = rootName.substr(slash + 1);
+
+    m_nodes.push_back(ProjectNode{ rootName, npos, {}, true, false, nullptr });
+}
+
+uint32_t ProjectModel::AddNode(uint32_t parent, std::string name, bool isDir)
+{
+    uint32_t index = (uint32_t)m_nodes.size();
+    m_nodes.push_back(ProjectNode{ std::move(name), parent, {}, isDir, !isDir, nullptr });
+    m_nodes[parent].children.push_back(index);
+    return index;
+}
+
+uint32_t ProjectModel::InsertNode(uint32_t parent, std::string name, bool isDir)
+{
+    uint32_t index = (uint32_t)m_nodes.size();
+    m_nodes.push_back(ProjectNode{ std::move(name), parent, {}, isDir, !isDir, nullptr });
+
+    std::vector<uint32_t>& children = m_nodes[parent].children;
+    auto position = std::lower_bound(children.begin(), children.end(), m_nodes[index].name,
+                                     [this](uint32_t child, const std::string& key) { return m_nodes[child].name < key; });
+    children.insert(position, index);
+    return index;
+}
+
+void ProjectModel::RemoveNode(uint32_t index)
+{
+    std::vector<uint32_t>& siblings = m_nodes[m_nodes[index].parent].children;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), index));
+    Detach(index);
+}
+
+void ProjectModel::ClearChildren(uint32_t index)
+{
+    for (uint32_t child : m_nodes[index].children)
+        Detach(child);
+    m_nodes[index].children.clear();
+    m_nodes[index].scanned = false;
+}
+
+void ProjectModel::Detach(uint32_t index)
+{
+    // Orphaned nodes are recognisable by their parent; their subtree is dropped
+    ProjectNode& node = m_nodes[index];
+    node.parent = npos;
+    for (uint32_t child : node.children)
+        Detach(child);
+    node.children.clear();
+    node.children.shrink_to_fit();
+    node.ignoreScope.reset();
+}
+
+uint32_t ProjectModel::FindChild(uint32_t parent, const std::string& name) const
+{
+    const std::vector<uint32_t>& children = m_nodes[parent].children;
+    auto it = std::lower_bound(children.begin(), children.end(), name,
+                               [this](uint32_t child, const std::string& key) { return m_nodes[child].name < key; });
+    if (it == children.end() || m_nodes[*it].name != name)
+        return npos;
+    return *it;
+}
+
+uint32_t ProjectModel::FindPath(const std::string& relativePath) const
+{
+    if (IsEmpty())
+        return npos;
+
+    uint32_t index = GetRoot();
+    size_t start = 0;
+    while (start < relativePath.size() && index != npos)
+    {
+        size_t slash = relativePath.find('/', start);
+        if (slash == std::string::npos)
+            slash = relativePath.size();
+        index = FindChild(index, relativePath.substr(start, slash - start));
+        start = slash + 1;
+    }
+    return index;
+}
+
+std::string ProjectModel::GetRelativePath(uint32_t index) const
+{
+    if (index == GetRoot())
+        return std::string();
+
+    // Collect the chain up to (but excluding) the root, then join it in order
+    std::vector<uint32_t> chain;
+    size_t length = 0;
+    for (uint32_t i = index; i != GetRoot(); i = m_nodes[i].parent)
+    {
+        chain.push_back(i);
+        length += m_nodes[i].name.size() + 1;
+    }
+
+    std::string path;
+    path.reserve(length);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+    {
+        if (!path.empty())
+            path += '/';
+        path += m_nodes[*it].name;
+    }
+    return path;
+}
+
+std::string ProjectModel::GetFullPath(uint32_t index) const
+{
+    if (index == GetRoot())
+        return m_rootPath;
+    return m_rootPath + '/' + GetRelativePath(index);
+}
+
+size_t ProjectModel::CountFiles() const
+{
+    return (size_t)std::count_if(m_nodes.begin(), m_nodes.end(),
+                                 [](const ProjectNode& node) { return !node.isDir && node.parent != npos; });
+}
+
+void ProjectModel::ClearTokenCounts()
+{
+    for (ProjectNode& node : m_nodes)
+        node.tokens = kUncounted;
+}
+
+void ProjectModel::SetContentKind(uint32_t index, ContentKind content, const FileStamp& stamp)
+{
+    ProjectNode& node = m_nodes[index];
+    node.content = content;
+    node.size = stamp.size;
+    node.mtime = stamp.mtime;
+}
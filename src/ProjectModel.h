@@ -0,0 +1,87 @@
+#pragma once
+
+#include "FileStamp.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct IgnoreScope;
+
+// Decides whether an entry passes the current settings. ignoreScope holds the
+// .gitignore rules of the entry's directory (null if there are none). Called
+// from worker threads, so implementations must not touch any GUI state.
+using EntryFilter = std::function<bool(const std::string& relativePath, const std::string& name, bool isDir,
+                                       const IgnoreScope* ignoreScope)>;
+
+// What a file's first block looked like; Unknown until it has been sniffed.
+enum class ContentKind : uint8_t { Unknown, Text, Binary };
+
+// One file or directory found by the scanner.
+struct ProjectNode
+{
+    std::string name;
+    uint32_t parent;
+    std::vector<uint32_t> children; // sorted by name
+    bool isDir;
+    bool scanned; // false for directories whose contents were never read
+    std::shared_ptr<const IgnoreScope> ignoreScope; // rules applying to this directory's children
+    int64_t mtime = 0; // directories: modification time (ns) when the entries were read; files: when the content was sniffed
+    uint64_t size = 0; // files only: size when the content was sniffed
+    ContentKind content = ContentKind::Unknown; // files only
+    uint32_t tokens = UINT32_MAX; // files only: token count of the exported text, ProjectModel::kUncounted until counted
+};
+
+// In-memory result of a project scan: a flat node table where node 0 is the
+// project root. Paths are UTF-8 and always use '/' as the separator.
+// The model holds what is on disk, independent of the current filters.
+class ProjectModel
+{
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+    static constexpr uint32_t kUncounted = UINT32_MAX;
+
+    ProjectModel() = default;
+    explicit ProjectModel(const std::string& rootPath);
+
+    const std::string& GetRootPath() const { return m_rootPath; }
+    uint32_t GetRoot() const { return 0; }
+    size_t GetNodeCount() const { return m_nodes.size(); }
+    bool IsEmpty() const { return m_nodes.empty(); }
+
+    const ProjectNode& GetNode(uint32_t index) const { return m_nodes[index]; }
+
+    uint32_t AddNode(uint32_t parent, std::string name, bool isDir);
+    void MarkScanned(uint32_t index) { m_nodes[index].scanned = true; }
+    void SetIgnoreScope(uint32_t index, std::shared_ptr<const IgnoreScope> scope) { m_nodes[index].ignoreScope = std::move(scope); }
+    void SetModificationTime(uint32_t index, int64_t mtime) { m_nodes[index].mtime = mtime; }
+    void SetContentKind(uint32_t index, ContentKind content) { m_nodes[index].content = content; }
+    void SetContentKind(uint32_t index, ContentKind content, const FileStamp& stamp);
+    void SetTokenCount(uint32_t index, uint32_t tokens) { m_nodes[index].tokens = tokens; }
+    void ClearTokenCounts(); // after the counting mode changed
+
+    // Live updates from the directory watcher. Indices are never reused: a
+    // removed node keeps its slot but is no longer reachable from the root.
+    uint32_t InsertNode(uint32_t parent, std::string name, bool isDir); // keeps children sorted
+    void RemoveNode(uint32_t index);
+    void ClearChildren(uint32_t index); // forgets a directory's contents so it is scanned again
+
+    // Child with the given name, or npos
+    uint32_t FindChild(uint32_t parent, const std::string& name) const;
+    // Node at a '/' separated relative path, or npos
+    uint32_t FindPath(const std::string& relativePath) const;
+
+    // Path relative to the project root ("" for the root itself)
+    std::string GetRelativePath(uint32_t index) const;
+    std::string GetFullPath(uint32_t index) const;
+
+    size_t CountFiles() const;
+
+private:
+    void Detach(uint32_t index);
+
+    std::string m_rootPath;
+    std::vector<ProjectNode> m_nodes;
+};
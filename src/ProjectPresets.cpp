@@ -0,0 +1,152 @@
+#include "ProjectPresets.h"
+
+#include <filesystem>
+#include <system_error>
+
+namespace
+{
+    const char* const kDefaultIgnorePatterns =
+        ".git\n"
+        ".vscode\n"
+        "node_modules\n"
+        "*.log\n"
+        ".DS_Store\n";
+
+    const char* const kGodotIgnorePatterns =
+        ".godot/\n"
+        "*.import\n"
+        ".mono/\n"
+        "export_presets.cfg\n"
+        "*.binary\n"
+        "*.rcedit\n"
+        "*.TMP\n"
+        "*.png.import\n"
+        "*.svg.import\n"
+        "*.gltf.import\n"
+        "*.glb.import\n"
+        "*.obj.import\n"
+        "*.wav.import\n"
+        "*.mp3.import\n";
+
+    const char* const kUnityIgnorePatterns =
+        "[Ll]ibrary/\n"
+        "[Tt]emp/\n"
+        "[Oo]bj/\n"
+        "[Bb]uild/\n"
+        "[Bb]uilds/\n"
+        "[Ll]ogs/\n"
+        "[Mm]emoryCaptures/\n"
+        "*.pidb\n"
+        "*.suo\n"
+        "*.user\n"
+        "*.userprefs\n"
+        "*.sln\n"
+        "*.csproj\n"
+        "*.unityproj\n"
+        "*.apk\n"
+        "*.aab\n"
+        "*.unitypackage\n"
+        "*.app\n"
+        "*.exe\n"
+        "*.dll\n"
+        "*.mdb\n"
+        "*.pdb\n"
+        ".vs/\n"
+        ".vscode/\n";
+
+    const char* const kNodeIgnorePatterns =
+        "node_modules/\n"
+        "npm-debug.log\n"
+        "yarn-debug.log\n"
+        "yarn-error.log\n"
+        "package-lock.json\n"
+        "yarn.lock\n"
+        "pnpm-lock.yaml\n"
+        ".env\n"
+        "dist/\n"
+        "build/\n"
+        "*.log\n"
+        ".DS_Store\n"
+        ".cache/\n";
+
+    bool IsFile(const std::filesystem::path& path)
+    {
+        std::error_code ec;
+        return std::filesystem::is_regular_file(path, ec);
+    }
+
+    bool IsDirectory(const std::filesystem::path& path)
+    {
+        std::error_code ec;
+        return std::filesystem::is_directory(path, ec);
+    }
+}
+
+ProjectType ProjectPresets::Detect(const std::string& rootPath)
+{
+    std::filesystem::path root = std::filesystem::u8path(rootPath);
+    if (IsFile(root / "project.godot"))
+        return ProjectType::Godot;
+    if (IsDirectory(root / "Assets") && IsDirectory(root / "ProjectSettings"))
+        return ProjectType::Unity;
+    if (IsFile(root / "package.json"))
+        return ProjectType::Node;
+    return ProjectType::None;
+}
+
+bool ProjectPresets::FromName(std::string_view name, ProjectType& type)
+{
+    if (name == "godot")
+        type = ProjectType::Godot;
+    else if (name == "unity")
+        type = ProjectType::Unity;
+    else if (name == "node")
+        type = ProjectType::Node;
+    else if (name == "default")
+        type = ProjectType::None;
+    else
+        return false;
+    return true;
+}
+
+const char* ProjectPresets::GetName(ProjectType type)
+{
+    switch (type)
+    {
+        case ProjectType::Godot: return "godot";
+        case ProjectType::Unity: return "unity";
+        case ProjectType::Node: return "node";
+        case ProjectType::None:
+        case ProjectType::Other:
+            break;
+    }
+    return "default";
+}
+
+const char* ProjectPresets::GetIgnorePatterns(ProjectType type)
+{
+    switch (type)
+    {
+        case ProjectType::Godot: return kGodotIgnorePatterns;
+        case ProjectType::Unity: return kUnityIgnorePatterns;
+        case ProjectType::Node: return kNodeIgnorePatterns;
+        case ProjectType::None:
+        case ProjectType::Other:
+            break;
+    }
+    return kDefaultIgnorePatterns;
+}
+
+std::string ProjectPresets::GetExportFileName(ProjectType type, const std::string& projectName, const std::string& date)
+{
+    switch (type)
+    {
+        case ProjectType::Godot: return "godot_" + projectName + "_" + date + ".txt";
+        case ProjectType::Unity: return "unity_" + projectName + "_" + date + ".txt";
+        case ProjectType::Node: return "node_" + projectName + "_" + date + ".txt";
+        case ProjectType::None:
+        case ProjectType::Other:
+            break;
+    }
+    return projectName + "_" + date + ".txt";
+}
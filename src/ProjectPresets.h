@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+enum class ProjectType { None, Godot, Unity, Node, Other };
+
+// The built-in project presets: how a project type is recognized, the ignore
+// patterns it starts with, which file types it enables (the preset names of
+// FileTypeRegistry) and what its exports are called.
+class ProjectPresets
+{
+public:
+    // From marker files in the project root; None if nothing matches
+    static ProjectType Detect(const std::string& rootPath);
+
+    // "godot", "unity", "node" or "default" (None); false for any other name
+    static bool FromName(std::string_view name, ProjectType& type);
+    static const char* GetName(ProjectType type);
+
+    static const char* GetIgnorePatterns(ProjectType type);
+
+    // e.g. "godot_MyGame_2025-01-31.txt"
+    static std::string GetExportFileName(ProjectType type, const std::string& projectName, const std::string& date);
+};
@@ -0,0 +1,162 @@
+#include "ProjectTreeModel.h"
+#include "TokenCounter.h"
+
+#include <wx/artprov.h>
+
+ProjectTreeModel::ProjectTreeModel(const ProjectModel& model, const ProjectFilter& filter)
+    : m_model(model), m_filter(filter)
+{
+    m_folderIcon = wxArtProvider::GetIcon(wxART_FOLDER, wxART_OTHER, wxSize(16, 16));
+    m_fileIcon = wxArtProvider::GetIcon(wxART_NORMAL_FILE, wxART_OTHER, wxSize(16, 16));
+}
+
+wxDataViewItem ProjectTreeModel::ToItem(uint32_t index)
+{
+    // The project root is the invisible root item; other ids are offset by one so none is null
+    if (index == 0 || index == ProjectModel::npos)
+        return wxDataViewItem();
+    return wxDataViewItem(reinterpret_cast<void*>(static_cast<uintptr_t>(index) + 1));
+}
+
+uint32_t ProjectTreeModel::ToNode(const wxDataViewItem& item)
+{
+    if (!item.IsOk())
+        return 0;
+    return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(item.GetID()) - 1);
+}
+
+void ProjectTreeModel::Reset()
+{
+    m_reported.clear();
+    Cleared();
+}
+
+void ProjectTreeModel::ApplyFilterChanges()
+{
+    m_mark.resize(m_model.GetNodeCount(), 0);
+    if (!m_model.IsEmpty() && m_reported.count(m_model.GetRoot()))
+        ApplyChanges(m_model.GetRoot());
+}
+
+void ProjectTreeModel::ApplyChanges(uint32_t dirIndex)
+{
+    std::vector<uint32_t> current;
+    for (uint32_t child : m_model.GetNode(dirIndex).children)
+    {
+        if (m_filter.IsVisible(child))
+            current.push_back(child);
+    }
+
+    // 1 = reported before, 2 = reported before and still visible
+    std::vector<uint32_t> previous = std::move(m_reported[dirIndex]);
+    for (uint32_t child : previous)
+        m_mark[child] = 1;
+
+    wxDataViewItemArray added;
+    wxDataViewItemArray removed;
+    std::vector<uint32_t> expandedChildren;
+    for (uint32_t child : current)
+    {
+        if (m_mark[child] == 0)
+        {
+            added.Add(ToItem(child));
+            continue;
+        }
+        m_mark[child] = 2;
+        if (m_reported.count(child))
+            expandedChildren.push_back(child);
+    }
+    for (uint32_t child : previous)
+    {
+        if (m_mark[child] == 1)
+        {
+            removed.Add(ToItem(child));
+            ForgetSubtree(child);
+        }
+        m_mark[child] = 0;
+    }
+    m_reported[dirIndex] = std::move(current);
+
+    wxDataViewItem parent = ToItem(dirIndex);
+    if (!removed.IsEmpty())
+        ItemsDeleted(parent, removed);
+    if (!added.IsEmpty())
+        ItemsAdded(parent, added);
+
+    for (uint32_t child : expandedChildren)
+        ApplyChanges(child);
+}
+
+void ProjectTreeModel::RefreshTokenTotals()
+{
+    wxDataViewItemArray items;
+    for (const auto& [dirIndex, children] : m_reported)
+    {
+        for (uint32_t child : children)
+            items.Add(ToItem(child));
+    }
+    if (!items.IsEmpty())
+        ItemsChanged(items);
+}
+
+void ProjectTreeModel::ForgetSubtree(uint32_t index)
+{
+    auto it = m_reported.find(index);
+    if (it == m_reported.end())
+        return;
+
+    std::vector<uint32_t> children = std::move(it->second);
+    m_reported.erase(it);
+    for (uint32_t child : children)
+        ForgetSubtree(child);
+}
+
+void ProjectTreeModel::GetValue(wxVariant& variant, const wxDataViewItem& item, unsigned int col) const
+{
+    const uint32_t index = ToNode(item);
+    if (col == 1)
+    {
+        // Blank until something under the item has been counted
+        uint64_t tokens = m_filter.GetTokenTotal(index);
+        variant = tokens > 0 ? wxString(TokenCounter::FormatCount(tokens)) : wxString();
+        return;
+    }
+
+    const ProjectNode& node = m_model.GetNode(index);
+    wxDataViewIconText value(wxString::FromUTF8(node.name), node.isDir ? m_folderIcon : m_fileIcon);
+    variant << value;
+}
+
+wxDataViewItem ProjectTreeModel::GetParent(const wxDataViewItem& item) const
+{
+    if (!item.IsOk())
+        return wxDataViewItem();
+    return ToItem(m_model.GetNode(ToNode(item)).parent);
+}
+
+bool ProjectTreeModel::IsContainer(const wxDataViewItem& item) const
+{
+    if (!item.IsOk())
+        return true;
+    return m_model.GetNode(ToNode(item)).isDir;
+}
+
+unsigned int ProjectTreeModel::GetChildren(const wxDataViewItem& item, wxDataViewItemArray& children) const
+{
+    if (m_model.IsEmpty())
+        return 0;
+
+    uint32_t dirIndex = ToNode(item);
+    std::vector<uint32_t>& reported = m_reported[dirIndex];
+    reported.clear();
+
+    for (uint32_t child : m_model.GetNode(dirIndex).children)
+    {
+        if (m_filter.IsVisible(child))
+        {
+            children.Add(ToItem(child));
+            reported.push_back(child);
+        }
+    }
+    return static_cast<unsigned int>(children.GetCount());
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <wx/dataview.h>
+#include <wx/icon.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "ProjectFilter.h"
+#include "ProjectModel.h"
+
+// Virtual wxDataViewModel over the scan result. Items are model node indices,
+// so nothing is allocated per file: the control asks for a folder's children
+// only when it is expanded, and UI memory follows what has been expanded.
+class ProjectTreeModel : public wxDataViewModel
+{
+public:
+    ProjectTreeModel(const ProjectModel& model, const ProjectFilter& filter);
+
+    static wxDataViewItem ToItem(uint32_t index);
+    static uint32_t ToNode(const wxDataViewItem& item);
+
+    // After a new scan: forget everything the control was told
+    void Reset();
+
+    // After a refilter or a live update: notify the control about added and
+    // removed children, but only for folders it has already asked about
+    void ApplyFilterChanges();
+
+    // After new token counts: redraw the token column of every item the control knows
+    void RefreshTokenTotals();
+
+    // --- wxDataViewModel ---
+    // Column 0: icon and name; column 1: token total
+    unsigned int GetColumnCount() const override { return 2; }
+    wxString GetColumnType(unsigned int col) const override { return col == 0 ? "wxDataViewIconText" : "string"; }
+    void GetValue(wxVariant& variant, const wxDataViewItem& item, unsigned int col) const override;
+    bool SetValue(const wxVariant& variant, const wxDataViewItem& item, unsigned int col) override { return false; }
+    wxDataViewItem GetParent(const wxDataViewItem& item) const override;
+    bool IsContainer(const wxDataViewItem& item) const override;
+    unsigned int GetChildren(const wxDataViewItem& item, wxDataViewItemArray& children) const override;
+
+private:
+    void ApplyChanges(uint32_t dirIndex);
+    void ForgetSubtree(uint32_t index);
+
+    const ProjectModel& m_model;
+    const ProjectFilter& m_filter;
+    wxIcon m_folderIcon;
+    wxIcon m_fileIcon;
+
+    // What the control currently knows: the children reported for each folder it asked about.
+    // Diffing against these lists also catches nodes that were removed from the model.
+    mutable std::unordered_map<uint32_t, std::vector<uint32_t>> m_reported;
+    std::vector<char> m_mark; // scratch for ApplyChanges
+};
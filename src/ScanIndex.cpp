@@ -0,0 +1,173 @@
+#include "ScanIndex.h"
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+
+namespace
+{
+    constexpr uint32_t kMagic = 0x58494353; // "SCIX"
+    constexpr uint32_t kVersion = 3;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t nodeCount;
+        uint32_t rootPathLength;
+        uint64_t namesSize;
+        uint64_t checksum; // FNV-1a over everything after the header
+    };
+
+    struct Record
+    {
+        uint32_t parent;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t flags;
+        int64_t mtime; // directories: when the entries were read; files: when the content was sniffed
+        uint64_t size; // files: when the content was sniffed
+    };
+
+    // Record::flags
+    constexpr uint32_t kIsDir = 1;
+    constexpr uint32_t kScanned = 2;
+    constexpr uint32_t kText = 4; // files that were sniffed; neither flag means not yet
+    constexpr uint32_t kBinary = 8;
+
+    uint64_t Fnv1a(const char* data, size_t size, uint64_t hash = 14695981039346656037ull)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= (unsigned char)data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+bool ScanIndex::Save(const ProjectModel& model, const std::string& indexPath)
+{
+    if (model.IsEmpty())
+        return false;
+
+    // Renumber breadth-first so detached nodes are dropped and every parent precedes its children
+    std::vector<Record> records;
+    std::string names;
+    std::deque<std::pair<uint32_t, uint32_t>> queue; // model index, record index of the parent
+    queue.emplace_back(model.GetRoot(), UINT32_MAX);
+    while (!queue.empty())
+    {
+        uint32_t index = queue.front().first;
+        uint32_t parent = queue.front().second;
+        queue.pop_front();
+
+        const ProjectNode& node = model.GetNode(index);
+        uint32_t recordIndex = (uint32_t)records.size();
+        uint32_t flags = (node.isDir ? kIsDir : 0) | (node.scanned ? kScanned : 0) |
+                         (node.content == ContentKind::Text ? kText : node.content == ContentKind::Binary ? kBinary : 0);
+        records.push_back(Record{ parent, (uint32_t)names.size(), (uint32_t)node.name.size(), flags, node.mtime, node.size });
+        names += node.name;
+
+        for (uint32_t child : node.children)
+            queue.emplace_back(child, recordIndex);
+    }
+
+    const std::string& rootPath = model.GetRootPath();
+    Header header{ kMagic, kVersion, (uint32_t)records.size(), (uint32_t)rootPath.size(), names.size(), 0 };
+    header.checksum = Fnv1a(rootPath.data(), rootPath.size());
+    header.checksum = Fnv1a(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record), header.checksum);
+    header.checksum = Fnv1a(names.data(), names.size(), header.checksum);
+
+    std::filesystem::path path = std::filesystem::u8path(indexPath);
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(rootPath.data(), (std::streamsize)rootPath.size());
+        file.write(reinterpret_cast<const char*>(records.data()), (std::streamsize)(records.size() * sizeof(Record)));
+        file.write(names.data(), (std::streamsize)names.size());
+        if (!file.flush())
+            return false;
+    }
+
+    // A reader sees either the old index or the new one, never a partial write
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool ScanIndex::Load(const std::string& indexPath, const std::string& rootPath, ProjectModel& model)
+{
+    MappedFile file(indexPath);
+    const char* data = file.GetData();
+    size_t size = file.GetSize();
+    if (!data || size < sizeof(Header))
+        return false;
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != kMagic || header.version != kVersion || header.nodeCount == 0)
+        return false;
+
+    uint64_t expectedSize = sizeof(Header) + (uint64_t)header.rootPathLength +
+                            (uint64_t)header.nodeCount * sizeof(Record) + header.namesSize;
+    if (expectedSize != size)
+        return false;
+    if (Fnv1a(data + sizeof(Header), size - sizeof(Header)) != header.checksum)
+        return false;
+
+    ProjectModel loaded(rootPath);
+    const char* storedRoot = data + sizeof(Header);
+    if (std::string(storedRoot, header.rootPathLength) != loaded.GetRootPath())
+        return false;
+
+    const char* recordData = storedRoot + header.rootPathLength;
+    const char* names = recordData + (size_t)header.nodeCount * sizeof(Record);
+    for (uint32_t i = 0; i < header.nodeCount; ++i)
+    {
+        Record record;
+        std::memcpy(&record, recordData + (size_t)i * sizeof(Record), sizeof(Record));
+        if ((uint64_t)record.nameOffset + record.nameLength > header.namesSize)
+            return false;
+
+        uint32_t index = loaded.GetRoot();
+        if (i > 0)
+        {
+            // The checksum catches damage; this catches a well-formed file that is still nonsense
+            if (record.parent >= i || !loaded.GetNode(record.parent).isDir)
+                return false;
+            index = loaded.AddNode(record.parent, std::string(names + record.nameOffset, record.nameLength),
+                                   (record.flags & kIsDir) != 0);
+        }
+        if ((record.flags & kIsDir) && (record.flags & kScanned))
+            loaded.MarkScanned(index);
+        else if (record.flags & (kText | kBinary))
+            loaded.SetContentKind(index, (record.flags & kBinary) ? ContentKind::Binary : ContentKind::Text,
+                                  FileStamp{ record.size, record.mtime });
+        loaded.SetModificationTime(index, record.mtime);
+    }
+
+    model = std::move(loaded);
+    return true;
+}
+
+std::string ScanIndex::GetFileName(const std::string& rootPath)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.idx", (unsigned long long)Fnv1a(rootPath.data(), rootPath.size()));
+    return name;
+}
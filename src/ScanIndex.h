@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ProjectModel.h"
+
+#include <string>
+
+// Compact binary copy of a ProjectModel, so a project that was opened before
+// shows its tree without walking the disk. The file is memory-mapped and
+// turned back into a model in one pass; it is versioned and checksummed, and
+// anything that does not validate is rejected so the caller falls back to a
+// full scan.
+//
+// Layout (native byte order): Header, the root path, one Record per node in
+// breadth-first order (parents before children, siblings sorted), then the
+// name bytes. The content kind of sniffed files is kept in the record flags,
+// next to the size and modification time the file had when it was sniffed, so
+// a kind that no longer holds can be found (DirectoryScanner::FindChangedFiles).
+// Ignore scopes are not stored; they are rebuilt from the .gitignore files
+// with DirectoryScanner::RestoreIgnoreScopes().
+class ScanIndex
+{
+public:
+    // Only the nodes reachable from the root are written. Writes to a temporary file and renames it into place.
+    static bool Save(const ProjectModel& model, const std::string& indexPath);
+
+    // Fails if the file is missing, damaged, from another format version or for another root
+    static bool Load(const std::string& indexPath, const std::string& rootPath, ProjectModel& model);
+
+    // Cache file name for a project root: a hash of the path, so any root maps to a valid file name
+    static std::string GetFileName(const std::string& rootPath);
+};
@@ -0,0 +1,344 @@
+#include "TextNormalizer.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NORMALIZER_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define NORMALIZER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+    // Windows-1252 code points for 0x80-0x9F; the five unassigned bytes map to the C1 controls, as in Latin-1
+    const uint16_t kCp1252High[32] = {
+        0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+        0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+        0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+        0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+    };
+
+    uint32_t DecodeCp1252(unsigned char byte)
+    {
+        return byte >= 0x80 && byte < 0xA0 ? kCp1252High[byte - 0x80] : byte;
+    }
+
+    // True if these 16 bytes are ASCII without '\r', i.e. can be copied as they are
+    bool IsPlainBlock(const unsigned char* data)
+    {
+#if defined(NORMALIZER_SSE2)
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        return (_mm_movemask_epi8(v) | _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')))) == 0;
+#elif defined(NORMALIZER_NEON)
+        uint8x16_t v = vld1q_u8(data);
+        return vmaxvq_u8(vorrq_u8(vcgeq_u8(v, vdupq_n_u8(0x80)), vceqq_u8(v, vdupq_n_u8('\r')))) == 0;
+#else
+        const uint64_t high = 0x8080808080808080ull;
+        const uint64_t ones = 0x0101010101010101ull;
+        for (int half = 0; half < 2; ++half)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + half * 8, 8);
+            uint64_t cr = word ^ (ones * '\r');
+            if ((word & high) || ((cr - ones) & ~cr & high))
+                return false;
+        }
+        return true;
+#endif
+    }
+
+    // Length of the well-formed UTF-8 sequence at data, 0 if it is not one,
+    // or -1 if it is a valid prefix cut off by the end of the data
+    int SequenceLength(const unsigned char* data, size_t available)
+    {
+        unsigned char lead = data[0];
+        int continuations;
+        unsigned char low = 0x80, high = 0xBF; // range of the first continuation byte
+        if (lead >= 0xC2 && lead <= 0xDF)
+            continuations = 1;
+        else if (lead == 0xE0)
+            continuations = 2, low = 0xA0; // no overlong forms
+        else if (lead == 0xED)
+            continuations = 2, high = 0x9F; // no surrogates
+        else if (lead >= 0xE1 && lead <= 0xEF)
+            continuations = 2;
+        else if (lead == 0xF0)
+            continuations = 3, low = 0x90;
+        else if (lead == 0xF4)
+            continuations = 3, high = 0x8F; // nothing above U+10FFFF
+        else if (lead >= 0xF1 && lead <= 0xF3)
+            continuations = 3;
+        else
+            return 0;
+
+        for (int k = 1; k <= continuations; ++k)
+        {
+            if ((size_t)k >= available)
+                return -1;
+            unsigned char byte = data[k];
+            if (k == 1 ? (byte < low || byte > high) : (byte < 0x80 || byte > 0xBF))
+                return 0;
+        }
+        return continuations + 1;
+    }
+}
+
+void TextNormalizer::Feed(const char* data, size_t size, std::string& output)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    const size_t before = output.size();
+
+    // The first three bytes decide the encoding, even if they arrive in several pieces
+    if (m_encoding == Encoding::Unknown)
+    {
+        while (m_carrySize < 3 && size > 0)
+        {
+            m_carry[m_carrySize++] = *bytes++;
+            --size;
+        }
+        if (m_carrySize < 3)
+            return;
+        DetectEncoding(output);
+    }
+
+    FeedEncoded(bytes, size, output);
+    if (output.size() > before)
+        m_last = output.back();
+}
+
+void TextNormalizer::DetectEncoding(std::string& output)
+{
+    unsigned char head[3];
+    size_t headSize = m_carrySize;
+    std::memcpy(head, m_carry, headSize);
+    m_carrySize = 0;
+
+    size_t bomSize = 0;
+    m_encoding = Encoding::Utf8;
+    if (headSize >= 3 && head[0] == 0xEF && head[1] == 0xBB && head[2] == 0xBF)
+        bomSize = 3;
+    else if (headSize >= 2 && head[0] == 0xFF && head[1] == 0xFE)
+        m_encoding = Encoding::Utf16LE, bomSize = 2;
+    else if (headSize >= 2 && head[0] == 0xFE && head[1] == 0xFF)
+        m_encoding = Encoding::Utf16BE, bomSize = 2;
+
+    FeedEncoded(head + bomSize, headSize - bomSize, output);
+}
+
+void TextNormalizer::FeedEncoded(const unsigned char* data, size_t size, std::string& output)
+{
+    if (m_encoding == Encoding::Utf8)
+        FeedUtf8(data, size, output);
+    else
+        FeedUtf16(data, size, output);
+}
+
+void TextNormalizer::FeedUtf8(const unsigned char* data, size_t size, std::string& output)
+{
+    size_t i = 0;
+
+    // Finish a sequence that was split by the end of the previous piece
+    if (m_carrySize > 0 && size > 0)
+    {
+        unsigned char joined[8];
+        std::memcpy(joined, m_carry, m_carrySize);
+        size_t taken = size < 4 ? size : 4;
+        std::memcpy(joined + m_carrySize, data, taken);
+
+        int length = SequenceLength(joined, m_carrySize + taken);
+        if (length < 0)
+        {
+            std::memcpy(m_carry + m_carrySize, data, size);
+            m_carrySize += size;
+            return;
+        }
+        if (length > 0)
+        {
+            output.append(reinterpret_cast<const char*>(joined), (size_t)length);
+            i = (size_t)length - m_carrySize;
+        }
+        else
+        {
+            // A valid prefix that did not continue: the lead and continuation bytes stand alone
+            for (size_t k = 0; k < m_carrySize; ++k)
+                AppendCodePoint(DecodeCp1252(m_carry[k]), output);
+        }
+        m_carrySize = 0;
+    }
+
+    if (m_pendingCr && i < size)
+    {
+        if (data[i] == '\n')
+            ++i;
+        m_pendingCr = false;
+    }
+
+    // Bytes that pass through unchanged accumulate in [runStart, i) and are copied in one append
+    size_t runStart = i;
+    while (i < size)
+    {
+        if (i + 16 <= size && IsPlainBlock(data + i))
+        {
+            i += 16;
+            continue;
+        }
+
+        unsigned char byte = data[i];
+        if (byte < 0x80)
+        {
+            if (byte != '\r')
+            {
+                ++i;
+                continue;
+            }
+            output.append(reinterpret_cast<const char*>(data + runStart), i - runStart);
+            output += '\n';
+            ++i;
+            if (i == size)
+                m_pendingCr = true;
+            else if (data[i] == '\n')
+                ++i;
+            runStart = i;
+            continue;
+        }
+
+        int length = SequenceLength(data + i, size - i);
+        if (length > 0)
+        {
+            i += (size_t)length;
+            continue;
+        }
+
+        output.append(reinterpret_cast<const char*>(data + runStart), i - runStart);
+        if (length < 0)
+        {
+            std::memcpy(m_carry, data + i, size - i);
+            m_carrySize = size - i;
+            return;
+        }
+        AppendCodePoint(DecodeCp1252(byte), output);
+        runStart = ++i;
+    }
+    output.append(reinterpret_cast<const char*>(data + runStart), i - runStart);
+}
+
+void TextNormalizer::FeedUtf16(const unsigned char* data, size_t size, std::string& output)
+{
+    const bool bigEndian = m_encoding == Encoding::Utf16BE;
+    size_t i = 0;
+    unsigned char pair[2];
+    while (true)
+    {
+        // A code unit split by the end of the previous piece is completed first
+        const unsigned char* unitBytes;
+        if (m_carrySize == 1)
+        {
+            if (i >= size)
+                break;
+            pair[0] = m_carry[0];
+            pair[1] = data[i++];
+            m_carrySize = 0;
+            unitBytes = pair;
+        }
+        else if (i + 1 < size)
+        {
+            unitBytes = data + i;
+            i += 2;
+        }
+        else
+        {
+            if (i < size)
+            {
+                m_carry[0] = data[i];
+                m_carrySize = 1;
+            }
+            break;
+        }
+
+        uint32_t unit = bigEndian ? (unitBytes[0] << 8 | unitBytes[1]) : (unitBytes[1] << 8 | unitBytes[0]);
+        uint32_t codePoint = unit;
+        if (m_highSurrogate != 0)
+        {
+            if (unit >= 0xDC00 && unit <= 0xDFFF)
+            {
+                codePoint = 0x10000 + ((m_highSurrogate - 0xD800) << 10) + (unit - 0xDC00);
+                m_highSurrogate = 0;
+                AppendCodePoint(codePoint, output);
+                continue;
+            }
+            AppendCodePoint(0xFFFD, output);
+            m_highSurrogate = 0;
+        }
+        if (unit >= 0xD800 && unit <= 0xDBFF)
+        {
+            m_highSurrogate = unit;
+            m_pendingCr = false;
+            continue;
+        }
+        if (unit >= 0xDC00 && unit <= 0xDFFF)
+            codePoint = 0xFFFD;
+
+        if (codePoint == '\n' && m_pendingCr)
+        {
+            m_pendingCr = false;
+            continue;
+        }
+        m_pendingCr = codePoint == '\r';
+        AppendCodePoint(m_pendingCr ? '\n' : codePoint, output);
+    }
+}
+
+void TextNormalizer::AppendCodePoint(uint32_t codePoint, std::string& output)
+{
+    if (codePoint < 0x80)
+    {
+        output += (char)codePoint;
+    }
+    else if (codePoint < 0x800)
+    {
+        output += (char)(0xC0 | (codePoint >> 6));
+        output += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000)
+    {
+        output += (char)(0xE0 | (codePoint >> 12));
+        output += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        output += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else
+    {
+        output += (char)(0xF0 | (codePoint >> 18));
+        output += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+        output += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        output += (char)(0x80 | (codePoint & 0x3F));
+    }
+}
+
+void TextNormalizer::Finish(std::string& output)
+{
+    const size_t before = output.size();
+
+    // Files shorter than three bytes
+    if (m_encoding == Encoding::Unknown)
+        DetectEncoding(output);
+
+    // Whatever was left incomplete at the end of the file
+    if (m_encoding == Encoding::Utf8)
+    {
+        for (size_t k = 0; k < m_carrySize; ++k)
+            AppendCodePoint(DecodeCp1252(m_carry[k]), output);
+    }
+    else if (m_highSurrogate != 0 || m_carrySize > 0)
+    {
+        AppendCodePoint(0xFFFD, output);
+    }
+    m_carrySize = 0;
+    m_highSurrogate = 0;
+
+    if (output.size() > before)
+        m_last = output.back();
+    if (m_last != '\n')
+        output += '\n';
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Turns the bytes of a source file into the UTF-8 text that goes into the
+// export and the preview, in one pass and without per-line objects. Usable
+// on a whole file or chunk by chunk; the result does not depend on where the
+// chunks are split or on the platform's locale.
+//   - A UTF-8 BOM is dropped; a UTF-16 (LE/BE) BOM switches to transcoding.
+//   - UTF-8 is validated as it is copied. Bytes that are not valid UTF-8 are
+//     decoded one by one as Windows-1252, so legacy files still come out readable.
+//   - "\r\n" and lone '\r' become '\n', and a missing final newline is added
+//     (an empty file stays empty).
+// Plain ASCII without '\r' is checked 16 bytes at a time (SSE2/NEON, or 8 with
+// portable word operations) and copied in bulk.
+class TextNormalizer
+{
+public:
+    // Appends the converted form of the next piece of the file to output
+    void Feed(const char* data, size_t size, std::string& output);
+    // Call once after the last piece
+    void Finish(std::string& output);
+
+private:
+    enum class Encoding { Unknown, Utf8, Utf16LE, Utf16BE };
+
+    void DetectEncoding(std::string& output);
+    void FeedEncoded(const unsigned char* data, size_t size, std::string& output);
+    void FeedUtf8(const unsigned char* data, size_t size, std::string& output);
+    void FeedUtf16(const unsigned char* data, size_t size, std::string& output);
+    void AppendCodePoint(uint32_t codePoint, std::string& output);
+
+    Encoding m_encoding = Encoding::Unknown;
+    bool m_pendingCr = false; // the last character was '\r', so a following '\n' is dropped
+    char m_last = '\n';
+    unsigned char m_carry[4];  // the undecided start of the file, or an incomplete UTF-8 sequence or UTF-16 unit
+    size_t m_carrySize = 0;
+    uint32_t m_highSurrogate = 0;
+};
@@ -0,0 +1,117 @@
+#include "ThreadPool.h"
+
+namespace
+{
+    // Lets Submit() push onto the calling worker's own deque
+    thread_local ThreadPool* t_currentPool = nullptr;
+    thread_local unsigned t_workerIndex = 0;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount)
+    : m_queued(0), m_pending(0), m_nextQueue(0), m_stopping(false)
+{
+    if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+        threadCount = 1;
+
+    for (unsigned i = 0; i < threadCount; ++i)
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    for (unsigned i = 0; i < threadCount; ++i)
+        m_threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_stopping = true;
+    }
+    m_workAvailable.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+void ThreadPool::Submit(Task task)
+{
+    unsigned index = (t_currentPool == this)
+        ? t_workerIndex
+        : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+    m_pending.fetch_add(1, std::memory_order_acq_rel);
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        ++m_queued;
+    }
+    m_workAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_stateMutex);
+    m_allDone.wait(lock, [this] { return m_pending.load(std::memory_order_acquire) == 0; });
+}
+
+bool ThreadPool::TryPop(unsigned index, Task& task)
+{
+    WorkQueue& queue = *m_queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+        return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::TrySteal(unsigned thief, Task& task)
+{
+    const size_t count = m_queues.size();
+    for (size_t offset = 1; offset < count; ++offset)
+    {
+        WorkQueue& queue = *m_queues[(thief + offset) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::WorkerLoop(unsigned index)
+{
+    t_currentPool = this;
+    t_workerIndex = index;
+
+    for (;;)
+    {
+        Task task;
+        if (TryPop(index, task) || TrySteal(index, task))
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_stateMutex);
+                --m_queued;
+            }
+            task();
+            task = nullptr;
+
+            if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                std::lock_guard<std::mutex> lock(m_stateMutex);
+                m_allDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_stateMutex);
+        m_workAvailable.wait(lock, [this] { return m_queued > 0 || m_stopping; });
+        if (m_stopping && m_queued == 0)
+            return;
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A small work-stealing thread pool.
+// Each worker owns a deque: it pushes and pops its own tasks at the back and,
+// when idle, steals from the front of the other workers' deques. Tasks may
+// submit further tasks, which is how the directory scanner fans out.
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // threadCount == 0 picks std::thread::hardware_concurrency()
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(Task task);
+
+    // Blocks until every submitted task (including tasks spawned by tasks) has finished.
+    void Wait();
+
+    unsigned GetThreadCount() const { return (unsigned)m_threads.size(); }
+
+private:
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void WorkerLoop(unsigned index);
+    bool TryPop(unsigned index, Task& task);
+    bool TrySteal(unsigned thief, Task& task);
+
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_stateMutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_allDone;
+    size_t m_queued;               // tasks sitting in a deque (guarded by m_stateMutex)
+    std::atomic<size_t> m_pending; // queued + running
+    std::atomic<unsigned> m_nextQueue;
+    bool m_stopping;
+};
@@ -0,0 +1,478 @@
+#include "TokenCounter.h"
+#include "ContentHash.h"
+#include "ContentSniffer.h"
+#include "TextNormalizer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+    enum class CharClass : uint8_t { Letter, Number, Space, Newline, Other };
+
+    struct CharInfo
+    {
+        CharClass cls;
+        size_t length; // bytes
+    };
+
+    CharClass ClassifyAscii(unsigned char c)
+    {
+        if (c == '\r' || c == '\n')
+            return CharClass::Newline;
+        if (c == ' ' || (c >= '\t' && c <= '\r'))
+            return CharClass::Space;
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+            return CharClass::Letter;
+        if (c >= '0' && c <= '9')
+            return CharClass::Number;
+        return CharClass::Other;
+    }
+
+    // \p{L}, \p{N} and \s as the cl100k pattern sees them, for the blocks that show up in source files
+    CharClass ClassifyWide(uint32_t c)
+    {
+        if (c < 0x100)
+        {
+            if (c == 0x85 || c == 0xA0)
+                return CharClass::Space;
+            if (c == 0xAA || c == 0xB5 || c == 0xBA)
+                return CharClass::Letter;
+            if (c == 0xB2 || c == 0xB3 || c == 0xB9 || (c >= 0xBC && c <= 0xBE))
+                return CharClass::Number;
+            if (c < 0xC0 || c == 0xD7 || c == 0xF7)
+                return CharClass::Other;
+            return CharClass::Letter;
+        }
+        if (c == 0x1680 || (c >= 0x2000 && c <= 0x200A) || c == 0x2028 || c == 0x2029 || c == 0x202F ||
+            c == 0x205F || c == 0x3000)
+            return CharClass::Space;
+        if ((c >= 0x2460 && c <= 0x249B) || (c >= 0x2776 && c <= 0x2793) || (c >= 0xFF10 && c <= 0xFF19))
+            return CharClass::Number;
+        if ((c >= 0x0300 && c <= 0x036F) ||                   // combining marks
+            (c >= 0x2000 && c <= 0x206F) ||                   // general punctuation
+            (c >= 0x20A0 && c <= 0x20CF) ||                   // currency
+            (c >= 0x2190 && c <= 0x2BFF) ||                   // arrows, math, box drawing, shapes, dingbats
+            (c >= 0x3001 && c <= 0x3004) || (c >= 0x3008 && c <= 0x3020) ||
+            (c >= 0xE000 && c <= 0xF8FF) ||                   // private use
+            (c >= 0xFE00 && c <= 0xFE0F) || (c >= 0xFE30 && c <= 0xFE4F) ||
+            (c >= 0xFF01 && c <= 0xFF0F) || (c >= 0xFF1A && c <= 0xFF20) ||
+            (c >= 0xFF3B && c <= 0xFF40) || (c >= 0xFF5B && c <= 0xFF65) ||
+            (c >= 0x1F000 && c <= 0x1FAFF))                   // emoji
+            return CharClass::Other;
+        return CharClass::Letter;
+    }
+
+    CharInfo CharAt(std::string_view text, size_t pos)
+    {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data()) + pos;
+        if (p[0] < 0x80)
+            return { ClassifyAscii(p[0]), 1 };
+
+        // The text comes out of TextNormalizer, so it is valid UTF-8; stray bytes still advance by one
+        size_t length = p[0] >= 0xF0 ? 4 : p[0] >= 0xE0 ? 3 : p[0] >= 0xC0 ? 2 : 1;
+        if (length > text.size() - pos)
+            return { CharClass::Letter, 1 };
+        uint32_t c = length == 2 ? (p[0] & 0x1F) : length == 3 ? (p[0] & 0x0F) : (p[0] & 0x07);
+        for (size_t k = 1; k < length; ++k)
+            c = c << 6 | (p[k] & 0x3F);
+        return { ClassifyWide(c), length };
+    }
+
+    size_t SkipClass(std::string_view text, size_t pos, CharClass cls)
+    {
+        while (pos < text.size())
+        {
+            CharInfo info = CharAt(text, pos);
+            if (info.cls != cls)
+                break;
+            pos += info.length;
+        }
+        return pos;
+    }
+
+    // End of a contraction ('s 't 're 've 'm 'll 'd, any case) starting at pos, or 0
+    size_t MatchContraction(std::string_view text, size_t pos)
+    {
+        if (pos + 1 >= text.size())
+            return 0;
+        char a = text[pos + 1] | 0x20;
+        if (a == 's' || a == 'd' || a == 'm' || a == 't')
+            return pos + 2;
+        if (pos + 2 >= text.size())
+            return 0;
+        char b = text[pos + 2] | 0x20;
+        if ((a == 'l' && b == 'l') || (a == 'v' && b == 'e') || (a == 'r' && b == 'e'))
+            return pos + 3;
+        return 0;
+    }
+
+    // Splits text like the cl100k pattern, trying its alternatives in order:
+    //   '(?i:[sdmt]|ll|ve|re) | [^\r\n\p{L}\p{N}]?\p{L}+ | \p{N}{1,3} | ?[^\s\p{L}\p{N}]+[\r\n]*
+    //   | \s*[\r\n] | \s+(?!\S) | \s+
+    template <typename Callback>
+    void Pretokenize(std::string_view text, Callback&& emit)
+    {
+        const size_t size = text.size();
+        size_t i = 0;
+        while (i < size)
+        {
+            const CharInfo first = CharAt(text, i);
+            const size_t next = i + first.length;
+            const size_t contraction = text[i] == '\'' ? MatchContraction(text, i) : 0;
+            size_t end;
+
+            if (contraction != 0)
+            {
+                end = contraction;
+            }
+            else if (first.cls == CharClass::Letter)
+            {
+                end = SkipClass(text, next, CharClass::Letter);
+            }
+            else if ((first.cls == CharClass::Space || first.cls == CharClass::Other) && next < size &&
+                     CharAt(text, next).cls == CharClass::Letter)
+            {
+                end = SkipClass(text, next, CharClass::Letter);
+            }
+            else if (first.cls == CharClass::Number)
+            {
+                end = next;
+                for (int k = 1; k < 3 && end < size; ++k)
+                {
+                    CharInfo info = CharAt(text, end);
+                    if (info.cls != CharClass::Number)
+                        break;
+                    end += info.length;
+                }
+            }
+            else if (first.cls == CharClass::Other ||
+                     (text[i] == ' ' && next < size && CharAt(text, next).cls == CharClass::Other))
+            {
+                end = SkipClass(text, first.cls == CharClass::Other ? i : next, CharClass::Other);
+                while (end < size && (text[end] == '\r' || text[end] == '\n'))
+                    ++end;
+            }
+            else
+            {
+                // A whitespace run: up to its last line break, else all of it but the
+                // character in front of the next word, which that word takes as its prefix
+                size_t runEnd = i;
+                size_t lastBreak = std::string_view::npos;
+                size_t lastStart = i;
+                while (runEnd < size)
+                {
+                    CharInfo info = CharAt(text, runEnd);
+                    if (info.cls != CharClass::Space && info.cls != CharClass::Newline)
+                        break;
+                    if (info.cls == CharClass::Newline)
+                        lastBreak = runEnd;
+                    lastStart = runEnd;
+                    runEnd += info.length;
+                }
+                if (lastBreak != std::string_view::npos)
+                    end = lastBreak + 1;
+                else if (runEnd == size || lastStart == i)
+                    end = runEnd;
+                else
+                    end = lastStart;
+            }
+
+            emit(text.substr(i, end - i));
+            i = end;
+        }
+    }
+
+    // Rough BPE behaviour on code and prose: short words and numbers are one
+    // token, long identifiers about one per six letters, punctuation about one
+    // per two characters, and other scripts about one per character
+    size_t EstimatePiece(std::string_view piece)
+    {
+        size_t letters = 0, wide = 0, symbols = 0;
+        for (size_t pos = 0; pos < piece.size();)
+        {
+            CharInfo info = CharAt(piece, pos);
+            if (info.cls == CharClass::Letter)
+                ++(info.length == 1 ? letters : wide);
+            else if (info.cls == CharClass::Other)
+                ++symbols;
+            pos += info.length;
+        }
+        size_t tokens = (letters > 0 ? std::max<size_t>(1, (letters + 2) / 6) : 0) + wide + symbols / 2;
+        return std::max<size_t>(tokens, 1);
+    }
+
+    // Position after the last line break that is followed by a non-blank character.
+    // No pre-token crosses it, so the text before it can be counted on its own.
+    size_t FindPieceBoundary(const std::string& text)
+    {
+        for (size_t pos = text.rfind('\n'); pos != std::string::npos && pos > 0; pos = text.rfind('\n', pos - 1))
+        {
+            if (pos + 1 < text.size() && text[pos + 1] > ' ' && text[pos + 1] < 0x7F)
+                return pos + 1;
+        }
+        return 0;
+    }
+
+    int DecodeBase64Char(char c)
+    {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+') return 62;
+        if (c == '/') return 63;
+        return -1;
+    }
+
+    bool DecodeBase64(std::string_view text, std::string& output)
+    {
+        uint32_t bits = 0;
+        int bitCount = 0;
+        for (char c : text)
+        {
+            if (c == '=')
+                break;
+            int value = DecodeBase64Char(c);
+            if (value < 0)
+                return false;
+            bits = bits << 6 | (uint32_t)value;
+            bitCount += 6;
+            if (bitCount >= 8)
+            {
+                bitCount -= 8;
+                output += (char)((bits >> bitCount) & 0xFF);
+            }
+        }
+        return true;
+    }
+}
+
+bool TokenCounter::LoadVocabulary(const std::string& path)
+{
+    std::ifstream file(std::filesystem::u8path(path), std::ios::binary);
+    if (!file)
+        return false;
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Tokens are decoded back to back first; the map is built once the buffer stops moving
+    std::string vocabulary;
+    vocabulary.reserve(content.size());
+    std::vector<std::pair<size_t, uint32_t>> ends; // end offset, rank
+    size_t lineStart = 0;
+    while (lineStart < content.size())
+    {
+        size_t lineEnd = content.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+            lineEnd = content.size();
+        std::string_view line(content.data() + lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (line.empty())
+            continue;
+
+        size_t space = line.find(' ');
+        if (space == std::string_view::npos || !DecodeBase64(line.substr(0, space), vocabulary))
+            return false;
+        uint32_t rank = (uint32_t)std::strtoul(std::string(line.substr(space + 1)).c_str(), nullptr, 10);
+        ends.emplace_back(vocabulary.size(), rank);
+    }
+    if (ends.empty())
+        return false;
+
+    m_vocabulary = std::move(vocabulary);
+    m_ranks.clear();
+    m_ranks.reserve(ends.size());
+    size_t begin = 0;
+    for (const auto& [end, rank] : ends)
+    {
+        m_ranks.emplace(std::string_view(m_vocabulary.data() + begin, end - begin), rank);
+        begin = end;
+    }
+    return true;
+}
+
+size_t TokenCounter::Count(std::string_view text, Mode mode) const
+{
+    if (mode == Mode::Exact && !HasVocabulary())
+        mode = Mode::Approximate;
+
+    size_t tokens = 0;
+    Pretokenize(text, [this, mode, &tokens](std::string_view piece) { tokens += CountPiece(piece, mode); });
+    return tokens;
+}
+
+size_t TokenCounter::CountPiece(std::string_view piece, Mode mode) const
+{
+    if (mode == Mode::Approximate)
+        return EstimatePiece(piece);
+    if (piece.size() == 1 || m_ranks.count(piece))
+        return 1;
+    return MergePiece(piece);
+}
+
+size_t TokenCounter::MergePiece(std::string_view piece) const
+{
+    // Byte-level BPE as tiktoken does it: repeatedly merge the adjacent pair whose
+    // combined bytes have the lowest rank. parts[k] = (start offset, rank of parts k and k+1 merged).
+    const uint32_t none = UINT32_MAX;
+    auto rankOf = [this, none](std::string_view bytes) {
+        auto it = m_ranks.find(bytes);
+        return it == m_ranks.end() ? none : it->second;
+    };
+
+    thread_local std::vector<std::pair<size_t, uint32_t>> parts;
+    parts.clear();
+    for (size_t i = 0; i + 1 < piece.size(); ++i)
+        parts.emplace_back(i, rankOf(piece.substr(i, 2)));
+    parts.emplace_back(piece.size() - 1, none);
+    parts.emplace_back(piece.size(), none);
+
+    // Rank of parts k and k+1 merged, given that k+1 and k+2 are about to become one part
+    auto mergedRank = [&](size_t k) {
+        if (k + 3 >= parts.size())
+            return none;
+        return rankOf(piece.substr(parts[k].first, parts[k + 3].first - parts[k].first));
+    };
+
+    for (;;)
+    {
+        size_t best = 0;
+        uint32_t bestRank = none;
+        for (size_t k = 0; k + 1 < parts.size(); ++k)
+        {
+            if (parts[k].second < bestRank)
+            {
+                bestRank = parts[k].second;
+                best = k;
+            }
+        }
+        if (bestRank == none)
+            break;
+
+        if (best > 0)
+            parts[best - 1].second = mergedRank(best - 1);
+        parts[best].second = mergedRank(best);
+        parts.erase(parts.begin() + best + 1);
+    }
+    return parts.size() - 1;
+}
+
+std::vector<uint32_t> TokenCounter::CountFiles(const std::vector<File>& files, Mode mode, const std::atomic<bool>& cancel)
+{
+    if (mode == Mode::Exact && !HasVocabulary())
+        mode = Mode::Approximate;
+
+    std::vector<uint32_t> counts(files.size(), kFailed);
+    const size_t batchSize = 16;
+    for (size_t begin = 0; begin < files.size(); begin += batchSize)
+    {
+        size_t end = std::min(begin + batchSize, files.size());
+        m_pool.Submit([this, &files, &counts, &cancel, mode, begin, end] {
+            for (size_t i = begin; i < end && !cancel; ++i)
+                counts[i] = CountFile(files[i], mode);
+        });
+    }
+    m_pool.Wait();
+    return counts;
+}
+
+uint32_t TokenCounter::CountFile(const File& file, Mode mode)
+{
+    std::ifstream in(std::filesystem::u8path(file.fullPath), std::ios::binary | std::ios::ate);
+    if (!in)
+        return kFailed;
+    if (file.binary)
+        return (uint32_t)Count(ContentSniffer::GetPlaceholder(), mode);
+
+    // The cache needs the hash before counting: small files are held in memory for both,
+    // large ones are hashed in a first pass rather than held
+    const size_t wholeFileLimit = 16 * 1024 * 1024;
+    const size_t chunkSize = 256 * 1024;
+    std::streamoff size = in.tellg();
+    in.seekg(0);
+
+    std::string data;
+    uint64_t hash = 0;
+    bool binary;
+    if (size >= 0 && (size_t)size <= wholeFileLimit)
+    {
+        data.resize((size_t)size);
+        in.read(&data[0], size);
+        data.resize((size_t)in.gcount());
+        hash = ContentHash::Hash(data.data(), data.size(), hash);
+        binary = ContentSniffer::IsBinary(data.data(), data.size());
+    }
+    else
+    {
+        data.resize(chunkSize);
+        in.read(&data[0], (std::streamsize)chunkSize);
+        binary = ContentSniffer::IsBinary(data.data(), (size_t)in.gcount());
+        while (in.gcount() > 0)
+        {
+            hash = ContentHash::Hash(data.data(), (size_t)in.gcount(), hash);
+            in.read(&data[0], (std::streamsize)chunkSize);
+        }
+        data.clear();
+        in.clear();
+        in.seekg(0);
+    }
+    if (binary)
+        return (uint32_t)Count(ContentSniffer::GetPlaceholder(), mode);
+
+    std::unordered_map<uint64_t, uint32_t>& cache = m_cache[(int)mode];
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        auto it = cache.find(hash);
+        if (it != cache.end())
+            return it->second;
+    }
+
+    // Counted as exported. Normalized text is counted up to the last pre-token boundary and the rest carried over.
+    TextNormalizer normalizer;
+    std::string text;
+    size_t tokens = 0;
+    auto countUpTo = [&](size_t cut) {
+        tokens += Count(std::string_view(text.data(), cut), mode);
+        text.erase(0, cut);
+    };
+
+    if (!data.empty())
+    {
+        normalizer.Feed(data.data(), data.size(), text);
+    }
+    else
+    {
+        std::vector<char> chunk(chunkSize);
+        while (in.read(chunk.data(), (std::streamsize)chunk.size()) || in.gcount() > 0)
+        {
+            normalizer.Feed(chunk.data(), (size_t)in.gcount(), text);
+            // A single line longer than this is split at an arbitrary point
+            size_t cut = FindPieceBoundary(text);
+            countUpTo(cut > 0 || text.size() < 4 * chunkSize ? cut : text.size());
+        }
+    }
+    normalizer.Finish(text);
+    countUpTo(text.size());
+
+    uint32_t result = (uint32_t)std::min<size_t>(tokens, kFailed - 1);
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    cache.emplace(hash, result);
+    return result;
+}
+
+std::string TokenCounter::FormatCount(uint64_t tokens)
+{
+    char text[32];
+    if (tokens < 1000)
+        std::snprintf(text, sizeof(text), "%llu", (unsigned long long)tokens);
+    else if (tokens < 1000000)
+        std::snprintf(text, sizeof(text), tokens < 10000 ? "%.2fk" : tokens < 100000 ? "%.1fk" : "%.0fk", tokens / 1e3);
+    else
+        std::snprintf(text, sizeof(text), tokens < 10000000 ? "%.2fM" : tokens < 100000000 ? "%.1fM" : "%.0fM", tokens / 1e6);
+    return text;
+}
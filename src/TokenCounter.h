@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Counts the tokens an LLM sees for the exported text of a file.
+//   - Exact: byte-level BPE with a vocabulary in the tiktoken format, e.g.
+//     cl100k_base.tiktoken (one "base64-token rank" pair per line). Text is
+//     split with the cl100k pre-tokenizer rules before the merges.
+//   - Approximate: the same pre-tokenizer with a per-piece estimate instead of
+//     the merges; needs no vocabulary and is several times faster.
+// The pre-tokenizer knows the character classes of ASCII, Latin-1 and the
+// common punctuation and symbol blocks; any other non-ASCII character counts
+// as a letter.
+class TokenCounter
+{
+public:
+    enum class Mode { Approximate, Exact };
+
+    struct File
+    {
+        std::string fullPath;
+        bool binary = false; // counted as the export placeholder, without reading the file
+    };
+
+    static constexpr uint32_t kFailed = UINT32_MAX;
+
+    bool LoadVocabulary(const std::string& path);
+    bool HasVocabulary() const { return !m_ranks.empty(); }
+
+    // Tokens in UTF-8 text; Exact falls back to Approximate without a vocabulary
+    size_t Count(std::string_view text, Mode mode) const;
+
+    // Counts files on the thread pool, reading them through the same text
+    // normalization as the export. Files whose contents were counted before (in
+    // any project) are answered from a cache keyed by a hash of their bytes.
+    // Returns one count per file, kFailed if it could not be read or the count
+    // was cancelled.
+    std::vector<uint32_t> CountFiles(const std::vector<File>& files, Mode mode, const std::atomic<bool>& cancel);
+
+    // "950", "12.3k", "4.56M"
+    static std::string FormatCount(uint64_t tokens);
+
+private:
+    uint32_t CountFile(const File& file, Mode mode);
+    size_t CountPiece(std::string_view piece, Mode mode) const;
+    size_t MergePiece(std::string_view piece) const;
+
+    std::string m_vocabulary; // all token bytes back to back; m_ranks points into it
+    std::unordered_map<std::string_view, uint32_t> m_ranks;
+
+    std::mutex m_cacheMutex;
+    std::unordered_map<uint64_t, uint32_t> m_cache[2]; // content hash -> tokens, per mode
+
+    ThreadPool m_pool;
+};
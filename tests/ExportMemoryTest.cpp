@@ -0,0 +1,104 @@
+// export-memory-test: exports a generated project and fails if the peak RSS of
+// the process went over a fixed bound. It runs once per output size with the
+// same bound, and every output is larger than the bound: only the pipeline's
+// read-ahead budget may be held in memory, never the export itself.
+//
+// Usage: export-memory-test <mean file size in KiB> <peak RSS bound in MiB>
+
+#include "SyntheticRepo.h"
+
+#include "CombinedExport.h"
+#include "DirectoryScanner.h"
+#include "EntryRules.h"
+#include "ExportWriter.h"
+#include "FileTypeRegistry.h"
+#include "ProjectFilter.h"
+#include "ProjectPresets.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace
+{
+    double GetPeakRssMiB()
+    {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+        return usage.ru_maxrss / 1024.0; // KiB
+#endif
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        std::fprintf(stderr, "Usage: export-memory-test <mean file size in KiB> <peak RSS bound in MiB>\n");
+        return 2;
+    }
+    size_t fileSize = (size_t)std::strtoul(argv[1], nullptr, 10) * 1024;
+    double bound = std::strtod(argv[2], nullptr);
+
+    // The same files for every size, so only the output grows and not the model
+    std::filesystem::path workDir = std::filesystem::temp_directory_path() /
+                                    ("scriptcombiner-memory-test-" + std::to_string(getpid()));
+    std::string root = (workDir / "project").u8string();
+    SyntheticRepo::Options repo;
+    repo.depth = 3;
+    repo.fanOut = 4;
+    repo.filesPerDir = 16;
+    repo.meanFileSize = fileSize;
+    SyntheticRepo::Stats stats;
+    if (!SyntheticRepo::Generate(root, repo, stats))
+    {
+        std::fprintf(stderr, "cannot generate a project in %s\n", root.c_str());
+        return 1;
+    }
+
+    // The settings the app would pick for it
+    ProjectType type = ProjectPresets::Detect(root);
+    FileTypeRegistry fileTypes = FileTypeRegistry::CreateDefault();
+    std::vector<bool> enabledTypes(fileTypes.GetTypes().size(), false);
+    for (size_t i = 0; i < enabledTypes.size(); ++i)
+        enabledTypes[i] = fileTypes.GetTypes()[i].filter && fileTypes.IsInPreset(i, ProjectPresets::GetName(type));
+    EntryRules rules;
+    rules.SetIgnorePatterns(ProjectPresets::GetIgnorePatterns(type));
+    rules.SetEnabledExtensions(fileTypes.BuildExtensionTable(enabledTypes));
+
+    DirectoryScanner scanner;
+    scanner.SetDescendFilter(rules.GetDescendFilter());
+    ProjectModel model = scanner.Scan(root);
+    ProjectFilter filter;
+    filter.ApplyAndScan(model, scanner, rules.GetVisibilityFilter());
+
+    // A small read-ahead budget keeps the bound tight; the outputs are many times larger than it
+    ExportPipeline::Options exportOptions;
+    exportOptions.maxInFlightBytes = 8 * 1024 * 1024;
+    ExportWriter writer;
+    std::string output = (workDir / "export.txt").u8string();
+    bool written = writer.Open(output);
+    size_t files = written ? CombinedExport::Write(model, filter, writer, exportOptions).files : 0;
+    uint64_t bytes = writer.GetBytesWritten();
+    written = written && writer.Commit();
+
+    double peak = GetPeakRssMiB();
+    std::error_code ec;
+    std::filesystem::remove_all(workDir, ec);
+
+    if (!written)
+    {
+        std::fprintf(stderr, "cannot write %s\n", output.c_str());
+        return 1;
+    }
+    std::printf("%zu files, %.1f MB exported, peak RSS %.1f MiB (bound %.0f MiB)\n", files, bytes / 1e6, peak, bound);
+    return peak <= bound ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+// ignore-conformance-test: builds the tree of an ignore fixture, scans it with
+// the project's .gitignore handling and compares the entries found ignored with
+// what `git check-ignore` reported for the same tree (tests/ignore/*.txt, see
+// update-expected.sh there for the format and for regenerating the answers).
+//
+// Usage: ignore-conformance-test <fixture>...
+
+#include "DirectoryScanner.h"
+#include "EntryRules.h"
+#include "ProjectModel.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    struct Fixture
+    {
+        std::map<std::string, std::string> ignoreFiles; // path in the tree, contents
+        std::vector<std::string> entries;               // directories end in '/'
+        std::set<std::string> ignored;                  // directories without the '/'
+    };
+
+    bool LoadFixture(const std::string& path, Fixture& fixture)
+    {
+        std::ifstream file(fs::u8path(path), std::ios::binary);
+        if (!file)
+            return false;
+
+        std::string section;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.compare(0, 4, "=== ") == 0)
+            {
+                section = line.substr(4);
+                if (section != "files" && section != "ignored")
+                    fixture.ignoreFiles[section];
+                continue;
+            }
+            if (section == "files")
+                fixture.entries.push_back(line);
+            else if (section == "ignored")
+                fixture.ignored.insert(line);
+            else if (!section.empty())
+                fixture.ignoreFiles[section] += line + '\n';
+        }
+        return !fixture.entries.empty();
+    }
+
+    bool WriteFile(const fs::path& path, const std::string& contents)
+    {
+        std::error_code ec;
+        fs::create_directories(path.parent_path(), ec);
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << contents;
+        return (bool)file;
+    }
+
+    bool BuildTree(const fs::path& root, const Fixture& fixture)
+    {
+        for (const auto& ignoreFile : fixture.ignoreFiles)
+        {
+            if (!WriteFile(root / fs::u8path(ignoreFile.first), ignoreFile.second))
+                return false;
+        }
+        for (const std::string& entry : fixture.entries)
+        {
+            std::error_code ec;
+            if (!entry.empty() && entry.back() == '/')
+                fs::create_directories(root / fs::u8path(entry.substr(0, entry.size() - 1)), ec);
+            else if (!WriteFile(root / fs::u8path(entry), std::string()))
+                return false;
+        }
+        return true;
+    }
+
+    // As git sees it: an entry is ignored by its own rules or by lying below an ignored directory,
+    // which the scanner never reads
+    bool IsIgnored(const ProjectModel& model, const EntryRules& rules, const std::string& entry)
+    {
+        bool isDir = !entry.empty() && entry.back() == '/';
+        std::string relativePath = isDir ? entry.substr(0, entry.size() - 1) : entry;
+
+        uint32_t parent = model.GetRoot();
+        size_t start = 0;
+        for (;;)
+        {
+            if (!model.GetNode(parent).scanned)
+                return true;
+
+            size_t slash = relativePath.find('/', start);
+            std::string name = relativePath.substr(start, slash == std::string::npos ? std::string::npos : slash - start);
+            uint32_t index = model.FindChild(parent, name);
+            if (index == ProjectModel::npos)
+                return false;
+
+            const ProjectNode& node = model.GetNode(index);
+            std::string path = relativePath.substr(0, slash);
+            if (rules.ShouldIgnore(path, name, node.isDir, model.GetNode(parent).ignoreScope.get()))
+                return true;
+            if (slash == std::string::npos)
+                return false;
+            parent = index;
+            start = slash + 1;
+        }
+    }
+
+    bool RunFixture(const std::string& fixturePath)
+    {
+        Fixture fixture;
+        if (!LoadFixture(fixturePath, fixture))
+        {
+            std::fprintf(stderr, "%s: cannot read the fixture\n", fixturePath.c_str());
+            return false;
+        }
+
+        fs::path root = fs::temp_directory_path() / ("scriptcombiner-ignore-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+        std::error_code ec;
+        fs::remove_all(root, ec);
+        if (!BuildTree(root, fixture))
+        {
+            std::fprintf(stderr, "%s: cannot build the tree in %s\n", fixturePath.c_str(), root.u8string().c_str());
+            fs::remove_all(root, ec);
+            return false;
+        }
+
+        // Only the .gitignore rules: no typed patterns, hidden entries shown
+        EntryRules rules;
+        rules.SetShowHidden(true);
+        rules.SetUseGitignore(true);
+        DirectoryScanner scanner;
+        scanner.SetDescendFilter(rules.GetDescendFilter());
+        ProjectModel model = scanner.Scan(root.u8string());
+
+        unsigned failures = 0;
+        for (const std::string& entry : fixture.entries)
+        {
+            bool isDir = !entry.empty() && entry.back() == '/';
+            bool expected = fixture.ignored.count(isDir ? entry.substr(0, entry.size() - 1) : entry) > 0;
+            if (IsIgnored(model, rules, entry) != expected)
+            {
+                std::fprintf(stderr, "%s: %s should %sbe ignored\n", fixturePath.c_str(), entry.c_str(), expected ? "" : "not ");
+                ++failures;
+            }
+        }
+        fs::remove_all(root, ec);
+
+        std::printf("%s: %zu entries, %u wrong\n", fixturePath.c_str(), fixture.entries.size(), failures);
+        return failures == 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "Usage: ignore-conformance-test <fixture>...\n");
+        return 2;
+    }
+
+    bool passed = true;
+    for (int i = 1; i < argc; ++i)
+        passed = RunFixture(argv[i]) && passed;
+    return passed ? 0 : 1;
+}
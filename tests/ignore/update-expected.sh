@@ -0,0 +1,63 @@
+#!/usr/bin/env bash
+# Rewrites the "=== ignored" section of the fixtures (all of them, or the ones
+# given) with what `git check-ignore` reports for their trees, so the expected
+# results of ignore-conformance-test come from git itself.
+#
+# A fixture is a list of sections: every "=== <path>" section is an ignore file
+# of the tree (.gitignore files, .git/info/exclude), "=== files" lists the
+# entries to check (directories end in "/"), and "=== ignored" is the answer,
+# with directories named without the "/".
+set -euo pipefail
+cd "$(dirname "$0")"
+
+fixtures=("$@")
+if [ ${#fixtures[@]} -eq 0 ]; then
+    fixtures=(*.txt)
+fi
+
+for fixture in "${fixtures[@]}"; do
+    tree=$(mktemp -d)
+    git -C "$tree" init -q
+
+    section=
+    : > "$tree.paths"
+    while IFS= read -r line; do
+        case "$line" in
+            "=== "*)
+                section=${line#=== }
+                if [ "$section" != files ] && [ "$section" != ignored ]; then
+                    mkdir -p "$tree/$(dirname "$section")"
+                    : > "$tree/$section"
+                fi
+                continue
+                ;;
+        esac
+        case "$section" in
+            "" | ignored) ;;
+            files)
+                if [[ $line == */ ]]; then
+                    mkdir -p "$tree/$line"
+                else
+                    mkdir -p "$tree/$(dirname "$line")"
+                    : > "$tree/$line"
+                fi
+                # Asked without the "/": git looks the type up on disk, and "abc/**" would match "abc/" itself
+                printf '%s\n' "${line%/}" >> "$tree.paths"
+                ;;
+            *) printf '%s\n' "$line" >> "$tree/$section" ;;
+        esac
+    done < "$fixture"
+
+    # Exits with 1 when nothing is ignored
+    ignored=$(cd "$tree" && git -c core.quotePath=false check-ignore --stdin < "$tree.paths" || true)
+
+    sed '/^=== ignored$/,$d' "$fixture" > "$tree.fixture"
+    {
+        cat "$tree.fixture"
+        echo "=== ignored"
+        if [ -n "$ignored" ]; then
+            printf '%s\n' "$ignored"
+        fi
+    } > "$fixture"
+    rm -rf "$tree" "$tree.paths" "$tree.fixture"
+done